@@ -131,6 +131,10 @@ PluginEditor::PluginEditor (PluginProcessor& p)
     /* handle to object */
     hCroPaC = processor.getFXHandle();
 
+    /* processing time statistics are only gathered while the editor is open */
+    hcropaclib_setEnableProfiling(hCroPaC, 1);
+    hcropaclib_resetProfile(hCroPaC);
+
     /* init OpenGL */
 #ifndef PLUGIN_EDITOR_DISABLE_OPENGL
     openGLContext.setMultisamplingEnabled(true);
@@ -218,6 +222,7 @@ PluginEditor::PluginEditor (PluginProcessor& p)
 
 PluginEditor::~PluginEditor()
 {
+    hcropaclib_setEnableProfiling(hCroPaC, 0);
     TBuseDefaultHRIRs = nullptr;
     CBchFormat = nullptr;
     CBnormScheme = nullptr;
@@ -727,21 +732,14 @@ void PluginEditor::paint (juce::Graphics& g)
     g.setFont(juce::FontOptions (11.00f, Font::plain));
     switch (currentWarning){
         case k_warning_none:
-            break;
-        case k_warning_frameSize:
-            g.drawText(TRANS("Set frame size to multiple of ") + String(hcropaclib_getFrameSize()),
-                       getBounds().getWidth()-225, 16, 530, 11,
-                       Justification::centredLeft, true);
-            break;
-        case k_warning_supported_fs:
-            g.drawText(TRANS("Sample rate (") + String(hcropaclib_getDAWsamplerate(hCroPaC)) + TRANS(") is unsupported"),
-                       getBounds().getWidth()-225, 16, 530, 11,
-                       Justification::centredLeft, true);
-            break;
-        case k_warning_mismatch_fs:
-            g.drawText(TRANS("Sample rate mismatch between DAW/HRIRs"),
-                       getBounds().getWidth()-225, 16, 530, 11,
-                       Justification::centredLeft, true);
+            /* otherwise, display the processing time statistics */
+            if(profile.nFrames > 0){
+                g.setColour(Colours::white);
+                g.drawText(TRANS("CPU: ") + String(100.0f*profile.cpuLoad, 1) + TRANS("% (") + String(profile.frameMean_us, 0) +
+                           TRANS("/") + String(profile.frameMax_us, 0) + TRANS(" us per frame, mean/max)"),
+                           getBounds().getWidth()-225, 16, 530, 11,
+                           Justification::centredLeft, true);
+            }
             break;
         case k_warning_NinputCH:
             g.drawText(TRANS("Insufficient number of input channels (") + String(processor.getTotalNumInputChannels()) +
@@ -821,26 +819,26 @@ void PluginEditor::timerCallback()
             TBmaxRE->setEnabled(true);
     }
 
+    /* CroPaC is disabled by the convolution (FIR) linear decoder */
+    TBenableCroPaC->setEnabled(hcropaclib_getLinearDecoderMode(hCroPaC) != LINEAR_DECODER_FIR);
+
     /* refresh 2d slider */
     if (balance2dSlider->getRefreshValuesFLAG()){
         balance2dSlider->repaint();
         balance2dSlider->setRefreshValuesFLAG(false);
     }
 
-    /* display warning message, if needed */
-    if ((processor.getCurrentBlockSize() % hcropaclib_getFrameSize()) != 0){
-        currentWarning = k_warning_frameSize;
-        repaint(0,0,getWidth(),32);
-    }
-    else if ( !((hcropaclib_getDAWsamplerate(hCroPaC) == 44.1e3) || (hcropaclib_getDAWsamplerate(hCroPaC) == 48e3)) ){
-        currentWarning = k_warning_supported_fs;
-        repaint(0,0,getWidth(),32);
+    /* refresh the processing time statistics, which are displayed over the last refresh interval */
+    if(++profileRefreshCounter >= 25){
+        profileRefreshCounter = 0;
+        hcropaclib_getProfile(hCroPaC, &profile);
+        hcropaclib_resetProfile(hCroPaC);
+        if(currentWarning == k_warning_none)
+            repaint(0,0,getWidth(),32);
     }
-    else if (hcropaclib_getDAWsamplerate(hCroPaC) != hcropaclib_getHRIRsamplerate(hCroPaC)){
-        currentWarning = k_warning_mismatch_fs;
-        repaint(0,0,getWidth(),32);
-    }
-    else if ((processor.getCurrentNumInputs() < hcropaclib_getNSHrequired())){
+
+    /* display warning message, if needed */
+    if ((processor.getCurrentNumInputs() < hcropaclib_getNSHrequired())){
         currentWarning = k_warning_NinputCH;
         repaint(0,0,getWidth(),32);
     }
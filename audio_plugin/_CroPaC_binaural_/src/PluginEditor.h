@@ -29,9 +29,6 @@
 
 typedef enum _CroPaC_WARNINGS{
     k_warning_none,
-    k_warning_frameSize,
-    k_warning_supported_fs,
-    k_warning_mismatch_fs,
     k_warning_NinputCH,
     k_warning_NoutputCH,
     k_warning_osc_connection_fail
@@ -84,6 +81,10 @@ private:
     /* warnings */
     CroPaC_WARNINGS currentWarning;
 
+    /* processing time statistics */
+    hcropaclib_profile profile {};
+    int profileRefreshCounter = 0;
+
     /* tooltips */
     SharedResourcePointer<TooltipWindow> tipWindow;
     std::unique_ptr<juce::ComboBox> pluginDescription; /* Dummy combo box to provide plugin description tooltip */
@@ -30,8 +30,16 @@ juce::AudioProcessorValueTreeState::ParameterLayout PluginProcessor::createParam
     params.push_back(std::make_unique<juce::AudioParameterChoice>("channelOrder", "ChannelOrder", juce::StringArray{"ACN", "FuMa"}, 0));
     params.push_back(std::make_unique<juce::AudioParameterChoice>("normType", "NormType", juce::StringArray{"N3D", "SN3D", "FuMa"}, 1));
     params.push_back(std::make_unique<juce::AudioParameterBool>("enableCroPaC", "EnableCroPaC", true));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("linearDecoder", "LinearDecoder", juce::StringArray{"Filterbank","Convolution"}, 0,
+                                                                  AudioParameterChoiceAttributes().withAutomatable(false)));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("tftBackend", "TFTBackend", juce::StringArray{"Hybrid afSTFT","STFT"}, 0,
+                                                                  AudioParameterChoiceAttributes().withAutomatable(false)));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("frameSize", "FrameSize", juce::StringArray{"128","256","512","1024"}, 2,
+                                                                  AudioParameterChoiceAttributes().withAutomatable(false)));
     params.push_back(std::make_unique<juce::AudioParameterFloat>("anaLimit", "AnaLimit", juce::NormalisableRange<float>(HCROPAC_ANA_LIMIT_MIN_VALUE, HCROPAC_ANA_LIMIT_MAX_VALUE, 1.0f), 18e3f, AudioParameterFloatAttributes().withLabel(" Hz")));
     params.push_back(std::make_unique<juce::AudioParameterFloat>("covAvgCoeff", "CovAvgCoeff", juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f), 0.75f));
+    params.push_back(std::make_unique<juce::AudioParameterInt>("scanGridDensity", "ScanGridDensity", HCROPAC_GRID_DENSITY_MIN_VALUE, HCROPAC_GRID_DENSITY_MAX_VALUE, HCROPAC_GRID_DENSITY_DEFAULT_VALUE,
+                                                               AudioParameterIntAttributes().withAutomatable(false)));
     params.push_back(std::make_unique<juce::AudioParameterFloat>("streamBalance", "StreamBalance", juce::NormalisableRange<float>(0.0f, 2.0f, 0.01f), 1.0f));
     params.push_back(std::make_unique<juce::AudioParameterBool>("enableDiffCorrection", "EnableDiffCorrection", true, AudioParameterBoolAttributes().withAutomatable(false)));
     params.push_back(std::make_unique<juce::AudioParameterChoice>("hrirPreproc", "HRIRPreproc",
@@ -63,12 +71,24 @@ void PluginProcessor::parameterChanged(const juce::String& parameterID, float ne
     else if (parameterID == "enableCroPaC"){
         hcropaclib_setEnableCroPaC(hCroPaC, static_cast<int>(newValue+0.5f));
     }
+    else if (parameterID == "linearDecoder"){
+        hcropaclib_setLinearDecoderMode(hCroPaC, static_cast<int>(newValue+1.001f));
+    }
+    else if (parameterID == "tftBackend"){
+        hcropaclib_setTransformBackend(hCroPaC, static_cast<int>(newValue+1.001f));
+    }
+    else if (parameterID == "frameSize"){
+        hcropaclib_setFrameSize(hCroPaC, HCROPAC_MIN_FRAME_SIZE << static_cast<int>(newValue+0.5f));
+    }
     else if(parameterID == "anaLimit"){
         hcropaclib_setAnaLimit(hCroPaC, newValue);
     }
     else if(parameterID == "covAvgCoeff"){
         hcropaclib_setCovAvg(hCroPaC, newValue);
     }
+    else if(parameterID == "scanGridDensity"){
+        hcropaclib_setScanningGridDensity(hCroPaC, static_cast<int>(newValue+0.5f));
+    }
     else if(parameterID == "streamBalance"){
         hcropaclib_setBalanceAllBands(hCroPaC, newValue);
     }
@@ -109,8 +129,12 @@ void PluginProcessor::setParameterValuesUsingInternalState()
     setParameterValue("channelOrder", hcropaclib_getChOrder(hCroPaC)-1);
     setParameterValue("normType", hcropaclib_getNormType(hCroPaC)-1);
     setParameterValue("enableCroPaC", hcropaclib_getEnableCroPaC(hCroPaC));
+    setParameterValue("linearDecoder", hcropaclib_getLinearDecoderMode(hCroPaC)-1);
+    setParameterValue("tftBackend", hcropaclib_getTransformBackend(hCroPaC)-1);
+    setParameterValue("frameSize", log2(hcropaclib_getFrameSize(hCroPaC)/HCROPAC_MIN_FRAME_SIZE));
     setParameterValue("anaLimit", hcropaclib_getAnaLimit(hCroPaC));
     setParameterValue("covAvgCoeff", hcropaclib_getCovAvg(hCroPaC));
+    setParameterValue("scanGridDensity", hcropaclib_getScanningGridDensity(hCroPaC));
     setParameterValue("streamBalance", hcropaclib_getBalanceAllBands(hCroPaC));
     setParameterValue("enableDiffCorrection", hcropaclib_getEnableDiffCorrection(hCroPaC));
     setParameterValue("hrirPreproc", hcropaclib_getHRIRsPreProc(hCroPaC)-1);
@@ -129,8 +153,12 @@ void PluginProcessor::setInternalStateUsingParameterValues()
     hcropaclib_setChOrder(hCroPaC, getParameterChoice("channelOrder")+1);
     hcropaclib_setNormType(hCroPaC, getParameterChoice("normType")+1);
     hcropaclib_setEnableCroPaC(hCroPaC, getParameterBool("enableCroPaC"));
+    hcropaclib_setLinearDecoderMode(hCroPaC, getParameterChoice("linearDecoder")+1);
+    hcropaclib_setTransformBackend(hCroPaC, getParameterChoice("tftBackend")+1);
+    hcropaclib_setFrameSize(hCroPaC, HCROPAC_MIN_FRAME_SIZE << getParameterChoice("frameSize"));
     hcropaclib_setAnaLimit(hCroPaC, getParameterFloat("anaLimit"));
     hcropaclib_setCovAvg(hCroPaC, getParameterFloat("covAvgCoeff"));
+    hcropaclib_setScanningGridDensity(hCroPaC, getParameterInt("scanGridDensity"));
     hcropaclib_setBalanceAllBands(hCroPaC, getParameterFloat("streamBalance"));
     hcropaclib_setEnableDiffCorrection(hCroPaC, getParameterBool("enableDiffCorrection"));
     hcropaclib_setHRIRsPreProc(hCroPaC, static_cast<HRIR_PREPROC_OPTIONS>(getParameterChoice("hrirPreproc")+1));
@@ -151,6 +179,12 @@ PluginProcessor::PluginProcessor():
     ParameterManager(*this, createParameterLayout())
 {
 	hcropaclib_create(&hCroPaC);
+    useFIFO = false;
+    fifo_idx = 0;
+    fifoFrameSize = 0;
+    processingDelay = 0;
+    fifoReconfigPending = false;
+    fifoReconfigEnable = false;
     
     /* Grab defaults */
     setParameterValuesUsingInternalState();
@@ -259,7 +293,24 @@ void PluginProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
     nSampleRate = (int)(sampleRate + 0.5);
 
 	hcropaclib_init(hCroPaC, nSampleRate);
-    AudioProcessor::setLatencySamples(hcropaclib_getProcessingDelay());
+    
+    /* blocks that are a multiple of the frame size may be processed in-place, otherwise they must go through the FIFO */
+    configureFIFO((samplesPerBlock % hcropaclib_getFrameSize(hCroPaC)) != 0);
+    fifoReconfigPending = false;
+}
+
+/* Not for the audio thread: reporting the latency calls the host synchronously */
+void PluginProcessor::configureFIFO(bool enableFIFO)
+{
+    useFIFO = enableFIFO;
+    fifo_idx = 0;
+    fifoFrameSize = hcropaclib_getFrameSize(hCroPaC);
+    processingDelay = hcropaclib_getProcessingDelay(hCroPaC);
+    memset(inFIFO, 0, sizeof(inFIFO));
+    memset(outFIFO, 0, sizeof(outFIFO));
+    
+    /* the FIFO delays the output by one frame */
+    AudioProcessor::setLatencySamples(processingDelay + (useFIFO ? fifoFrameSize : 0));
 }
 
 void PluginProcessor::releaseResources()
@@ -275,9 +326,27 @@ void PluginProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& /*mid
     nNumOutputs = jmin(getTotalNumOutputChannels(), buffer.getNumChannels(), 256);
     float* const* bufferData = buffer.getArrayOfWritePointers();
     float* pFrameData[256];
-    int framesize = hcropaclib_getFrameSize();
+    float* pInFrame[MAX_NUM_CHANNELS];
+    float* pOutFrame[MAX_NUM_CHANNELS];
+    int framesize = hcropaclib_getFrameSize(hCroPaC);
+    
+    /* the FIFO is being reconfigured by timerCallback(), and may not be touched until it is done */
+    if(fifoReconfigPending){
+        buffer.clear();
+        return;
+    }
     
-    if(nCurrentBlockSize % framesize == 0) { /* divisible by frame size */
+    /* the frame size may have been changed by the user, or hosts with variable block sizes may send a block that is not
+     * divisible by the frame size (from then on, use the FIFO); either way, the FIFO and the reported latency must be
+     * reconfigured on the message thread */
+    if(framesize != fifoFrameSize || (!useFIFO && (nCurrentBlockSize % framesize) != 0)){
+        fifoReconfigEnable = (nCurrentBlockSize % framesize) != 0;
+        fifoReconfigPending = true;
+        buffer.clear();
+        return;
+    }
+    
+    if(!useFIFO) { /* divisible by frame size */
         for(int frame = 0; frame < nCurrentBlockSize/framesize; frame++) {
             for(int ch = 0; ch < jmin(buffer.getNumChannels(), 256); ch++)
                 pFrameData[ch] = &bufferData[ch][frame*framesize];
@@ -286,8 +355,33 @@ void PluginProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& /*mid
             hcropaclib_process(hCroPaC, pFrameData, pFrameData, nNumInputs, nNumOutputs, framesize);
         }
     }
-    else
-        buffer.clear();
+    else {
+        int nFIFOinputs = jmin(nNumInputs.load(), MAX_NUM_CHANNELS);
+        int nFIFOoutputs = jmin(nNumOutputs.load(), MAX_NUM_CHANNELS);
+        for(int s = 0; s < nCurrentBlockSize; s++) {
+            /* Load input signals into inFIFO buffer */
+            for(int ch = 0; ch < nFIFOinputs; ch++)
+                inFIFO[ch][fifo_idx] = bufferData[ch][s];
+            
+            /* Pull output signals from outFIFO buffer */
+            for(int ch = 0; ch < nFIFOoutputs; ch++)
+                bufferData[ch][s] = outFIFO[ch][fifo_idx];
+            
+            /* Process frame once inFIFO is full */
+            if(++fifo_idx >= framesize) {
+                fifo_idx = 0;
+                for(int ch = 0; ch < MAX_NUM_CHANNELS; ch++) {
+                    pInFrame[ch] = inFIFO[ch];
+                    pOutFrame[ch] = outFIFO[ch];
+                }
+                hcropaclib_process(hCroPaC, pInFrame, pOutFrame, nFIFOinputs, nFIFOoutputs, framesize);
+            }
+        }
+        
+        /* clear any channels that were not written to */
+        for(int ch = nFIFOoutputs; ch < buffer.getNumChannels(); ch++)
+            buffer.clear(ch, 0, nCurrentBlockSize);
+    }
 }
 
 //==============================================================================
@@ -310,8 +404,9 @@ void PluginProcessor::getStateInformation (MemoryBlock& destData)
     xml->setAttribute("VersionCode", JucePlugin_VersionCode); // added since 0x10405
     
     /* Now for the other DSP object parameters (that have no JUCE parameter counterpart) */
-    for(int band=0; band<hcropaclib_getNumberOfBands(); band++){
+    for(int band=0; band<hcropaclib_getNumberOfBands(hCroPaC); band++){
         xml->setAttribute("Balance"+String(band), hcropaclib_getBalance(hCroPaC, band));
+        xml->setAttribute("EQ"+String(band), hcropaclib_getEQ(hCroPaC, band));
     }
     xml->setAttribute("UseDefaultHRIRset", hcropaclib_getUseDefaultHRIRsflag(hCroPaC));
     if(!hcropaclib_getUseDefaultHRIRsflag(hCroPaC))
@@ -333,7 +428,7 @@ void PluginProcessor::setStateInformation (const void* data, int sizeInBytes)
             if(xmlState->hasAttribute("EnableCroPaC"))
                 hcropaclib_setEnableCroPaC(hCroPaC, xmlState->getIntAttribute("EnableCroPaC", 1));
             
-            for(int band=0; band<hcropaclib_getNumberOfBands(); band++){
+            for(int band=0; band<hcropaclib_getNumberOfBands(hCroPaC); band++){
                 if(xmlState->hasAttribute("Balance"+String(band)))
                     hcropaclib_setBalance(hCroPaC, (float)xmlState->getDoubleAttribute("Balance"+String(band),0), band);
             }
@@ -385,6 +480,10 @@ void PluginProcessor::setStateInformation (const void* data, int sizeInBytes)
             parameters.replaceState(juce::ValueTree::fromXml(*xmlState));
 
             /* Now for the other DSP object parameters (that have no JUCE parameter counterpart) */
+            for(int band=0; band<hcropaclib_getNumberOfBands(hCroPaC); band++){
+                if(xmlState->hasAttribute("EQ"+String(band)))
+                    hcropaclib_setEQ(hCroPaC, (float)xmlState->getDoubleAttribute("EQ"+String(band), 1.0), band);
+            }
             if(xmlState->hasAttribute("UseDefaultHRIRset"))
                 hcropaclib_setUseDefaultHRIRsflag(hCroPaC, xmlState->getIntAttribute("UseDefaultHRIRset", 1));
             if(xmlState->hasAttribute("SofaFilePath")){
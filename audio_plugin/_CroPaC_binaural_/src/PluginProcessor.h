@@ -79,6 +79,14 @@ private:
     std::atomic<int> nNumOutputs;     /* current number of output channels */
     int nSampleRate;                  /* current host sample rate */
     std::atomic<int> nHostBlockSize;  /* typical host block size to expect, in samples */
+    bool useFIFO;                     /* true: host blocks are passed through the FIFO, false: processed in-place */
+    int fifo_idx;                     /* current FIFO read/write position */
+    int fifoFrameSize;                /* frame size that the FIFO/latency were configured for */
+    int processingDelay;              /* processing delay that the latency was configured for */
+    std::atomic<bool> fifoReconfigPending; /* true: the audio thread has requested configureFIFO(), and outputs silence until it is done */
+    std::atomic<bool> fifoReconfigEnable;  /* argument of the requested configureFIFO() */
+    float inFIFO[MAX_NUM_CHANNELS][HCROPAC_MAX_FRAME_SIZE];  /* input FIFO (preallocated; no locks or allocations on the audio thread) */
+    float outFIFO[MAX_NUM_CHANNELS][HCROPAC_MAX_FRAME_SIZE]; /* output FIFO */
     OSCReceiver osc;
     int osc_port_ID;
     
@@ -86,10 +94,23 @@ private:
     void parameterChanged(const juce::String& parameterID, float newValue) override;
     void setParameterValuesUsingInternalState();
     void setInternalStateUsingParameterValues();
+    void configureFIFO(bool enableFIFO);
 
     void timerCallback() override {
-        /* reinitialise codec if needed */
-        if(hcropaclib_getCodecStatus(hCroPaC) == CODEC_STATUS_NOT_INITIALISED){
+        /* reconfigure the FIFO, if requested by the audio thread */
+        if(fifoReconfigPending){
+            configureFIFO(fifoReconfigEnable);
+            fifoReconfigPending = false; /* hands the FIFO back to the audio thread */
+        }
+        
+        /* the processing delay depends on the linear decoding mode, transform and HRIR length (none of which are automatable) */
+        if(hcropaclib_getProcessingDelay(hCroPaC) != processingDelay){
+            processingDelay = hcropaclib_getProcessingDelay(hCroPaC);
+            AudioProcessor::setLatencySamples(processingDelay + (useFIFO ? fifoFrameSize : 0));
+        }
+        
+        /* reinitialise codec (or rebuild the FIR decoder, while processing continues) if needed */
+        if(hcropaclib_getCodecStatus(hCroPaC) == CODEC_STATUS_NOT_INITIALISED || hcropaclib_getFIRDecoderRebuildPending(hCroPaC)){
             try{
                 std::thread threadInit(hcropaclib_initCodec, hCroPaC);
                 threadInit.detach();
@@ -0,0 +1,171 @@
+/*
+ ==============================================================================
+
+ This file is part of the CroPaC-Binaural
+ Copyright (c) 2018 - Leo McCormack.
+
+ CroPaC-Binaural is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ CroPaC-Binaural is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with CroPaC-Binaural.  If not, see <http://www.gnu.org/licenses/>.
+
+ ==============================================================================
+*/
+
+/**
+ * @file bench_common.c
+ * @brief Utilities shared by the hcropaclib benchmarks: a monotonic clock,
+ *        and deterministic synthetic first-order Ambisonic (ACN/SN3D) scenes
+ *
+ * @author Leo McCormack
+ * @date 12.01.2018
+ */
+
+#include <math.h>
+#include <string.h>
+#include "bench_common.h"
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <time.h>
+#endif
+
+#define BENCH_PI ( 3.14159265358979323846f )
+#define BENCH_NOISE_GAIN ( 0.25f )             /* peak amplitude of the noise signals */
+#define BENCH_PLANE_WAVE_AZI_DEG ( 45.0f )
+#define BENCH_PLANE_WAVE_ELEV_DEG ( 10.0f )
+#define BENCH_MOVING_RATE_DEG_PER_S ( 90.0f )
+#define BENCH_MOVING_ELEV_DEG ( 20.0f )        /* elevation excursion of the moving source */
+
+/* xorshift32; uniformly distributed in [-1, 1] */
+static float bench_noise(unsigned int* state)
+{
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return (float)x/2147483647.5f - 1.0f;
+}
+
+/* encodes a plane wave into ACN/SN3D */
+static void bench_encode(float s, float azi_deg, float elev_deg, float* foa)
+{
+    float azi, elev;
+
+    azi = azi_deg*BENCH_PI/180.0f;
+    elev = elev_deg*BENCH_PI/180.0f;
+    foa[0] = s;
+    foa[1] = s * sinf(azi) * cosf(elev);
+    foa[2] = s * sinf(elev);
+    foa[3] = s * cosf(azi) * cosf(elev);
+}
+
+double bench_now_ns(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double)count.QuadPart * 1e9 / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+#endif
+}
+
+const char* bench_sceneName(BENCH_SCENES type)
+{
+    switch(type){
+        case BENCH_SCENE_PLANE_WAVE: return "plane_wave";
+        case BENCH_SCENE_DIFFUSE:    return "diffuse";
+        case BENCH_SCENE_MOVING:     return "moving";
+        case BENCH_SCENE_SILENCE:    return "silence";
+        default:                     return "unknown";
+    }
+}
+
+void bench_scene_init
+(
+    bench_scene* scene,
+    BENCH_SCENES type,
+    int fs,
+    unsigned int seed
+)
+{
+    scene->type = type;
+    scene->fs = fs;
+    scene->seed = seed != 0 ? seed : 1; /* xorshift must not be seeded with zero */
+    scene->sampleIdx = 0;
+}
+
+void bench_scene_render
+(
+    bench_scene* scene,
+    float** foa,
+    int nSamples
+)
+{
+    int ch, n;
+    float azi, elev, foa_n[BENCH_NUM_FOA_CHANNELS];
+
+    for(n=0; n<nSamples; n++, scene->sampleIdx++){
+        switch(scene->type){
+            case BENCH_SCENE_PLANE_WAVE:
+                bench_encode(BENCH_NOISE_GAIN*bench_noise(&scene->seed), BENCH_PLANE_WAVE_AZI_DEG, BENCH_PLANE_WAVE_ELEV_DEG, foa_n);
+                break;
+            case BENCH_SCENE_DIFFUSE:
+                /* equal energy in all N3D components; i.e. the dipoles are scaled by 1/sqrt(3) in SN3D */
+                for(ch=0; ch<BENCH_NUM_FOA_CHANNELS; ch++)
+                    foa_n[ch] = BENCH_NOISE_GAIN*bench_noise(&scene->seed) * (ch==0 ? 1.0f : 1.0f/sqrtf(3.0f));
+                break;
+            case BENCH_SCENE_MOVING:
+                bench_scene_direction(scene, scene->sampleIdx, &azi, &elev);
+                bench_encode(BENCH_NOISE_GAIN*bench_noise(&scene->seed), azi, elev, foa_n);
+                break;
+            case BENCH_SCENE_SILENCE:
+            default:
+                memset(foa_n, 0, BENCH_NUM_FOA_CHANNELS*sizeof(float));
+                break;
+        }
+        for(ch=0; ch<BENCH_NUM_FOA_CHANNELS; ch++)
+            foa[ch][n] = foa_n[ch];
+    }
+}
+
+int bench_scene_direction
+(
+    const bench_scene* scene,
+    long long sampleIdx,
+    float* azi_deg,
+    float* elev_deg
+)
+{
+    float t;
+
+    switch(scene->type){
+        case BENCH_SCENE_PLANE_WAVE:
+            *azi_deg = BENCH_PLANE_WAVE_AZI_DEG;
+            *elev_deg = BENCH_PLANE_WAVE_ELEV_DEG;
+            return 1;
+        case BENCH_SCENE_MOVING:
+            t = (float)((double)sampleIdx/(double)scene->fs);
+            *azi_deg = fmodf(BENCH_MOVING_RATE_DEG_PER_S*t, 360.0f) - 180.0f;
+            *elev_deg = BENCH_MOVING_ELEV_DEG*sinf(2.0f*BENCH_PI*t/8.0f);
+            return 1;
+        case BENCH_SCENE_DIFFUSE:
+        case BENCH_SCENE_SILENCE:
+        default:
+            *azi_deg = *elev_deg = 0.0f;
+            return 0;
+    }
+}
@@ -0,0 +1,125 @@
+/*
+ ==============================================================================
+
+ This file is part of the CroPaC-Binaural
+ Copyright (c) 2018 - Leo McCormack.
+
+ CroPaC-Binaural is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ CroPaC-Binaural is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with CroPaC-Binaural.  If not, see <http://www.gnu.org/licenses/>.
+
+ ==============================================================================
+*/
+
+/**
+ * @file bench_common.h
+ * @brief Utilities shared by the hcropaclib benchmarks: a monotonic clock,
+ *        and deterministic synthetic first-order Ambisonic (ACN/SN3D) scenes
+ *
+ * @author Leo McCormack
+ * @date 12.01.2018
+ */
+
+#ifndef __BENCH_COMMON_H_INCLUDED__
+#define __BENCH_COMMON_H_INCLUDED__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* ========================================================================== */
+/*                             Presets + Constants                            */
+/* ========================================================================== */
+
+#define BENCH_NUM_FOA_CHANNELS ( 4 )
+
+/** Available synthetic scenes */
+typedef enum {
+    BENCH_SCENE_PLANE_WAVE = 0, /**< White noise plane wave from a fixed
+                                 *   direction */
+    BENCH_SCENE_DIFFUSE,        /**< Uncorrelated (diffuse) noise */
+    BENCH_SCENE_MOVING,         /**< White noise plane wave, circling the
+                                 *   listener at 90 degrees per second */
+    BENCH_SCENE_SILENCE,        /**< Digital silence */
+
+    BENCH_NUM_SCENES
+}BENCH_SCENES;
+
+/** State of a synthetic scene */
+typedef struct _bench_scene {
+    BENCH_SCENES type;   /**< see 'BENCH_SCENES' enum */
+    int fs;              /**< sampling rate, Hz */
+    unsigned int seed;   /**< noise generator state */
+    long long sampleIdx; /**< number of samples rendered so far */
+} bench_scene;
+
+
+/* ========================================================================== */
+/*                               Main Functions                               */
+/* ========================================================================== */
+
+/**
+ * Returns the time of a monotonic clock, in nanoseconds
+ */
+double bench_now_ns(void);
+
+/**
+ * Returns the name of a scene (see 'BENCH_SCENES' enum), as used in the JSON
+ * output
+ */
+const char* bench_sceneName(BENCH_SCENES type);
+
+/**
+ * Initialises a scene; the same seed always renders the same signals
+ *
+ * @param[in] scene Scene
+ * @param[in] type  See 'BENCH_SCENES' enum
+ * @param[in] fs    Sampling rate, Hz
+ * @param[in] seed  Noise generator seed (non-zero)
+ */
+void bench_scene_init(bench_scene* scene,
+                      BENCH_SCENES type,
+                      int fs,
+                      unsigned int seed);
+
+/**
+ * Renders the next block of the scene
+ *
+ * @param[in]  scene    Scene
+ * @param[out] foa      FOA signals, ACN/SN3D; BENCH_NUM_FOA_CHANNELS x nSamples
+ * @param[in]  nSamples Number of samples to render
+ */
+void bench_scene_render(bench_scene* scene,
+                        float** foa,
+                        int nSamples);
+
+/**
+ * Returns the true direction of the source of a scene at a given sample, for
+ * evaluating DoA estimates
+ *
+ * @param[in]  scene     Scene
+ * @param[in]  sampleIdx Sample index (as counted from the initialisation)
+ * @param[out] azi_deg   Source azimuth, degrees
+ * @param[out] elev_deg  Source elevation, degrees
+ * @returns 1 if the scene has a single source direction, 0 otherwise
+ */
+int bench_scene_direction(const bench_scene* scene,
+                          long long sampleIdx,
+                          float* azi_deg,
+                          float* elev_deg);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif /* __cplusplus */
+
+#endif /* __BENCH_COMMON_H_INCLUDED__ */
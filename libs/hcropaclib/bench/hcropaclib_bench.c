@@ -0,0 +1,228 @@
+/*
+ ==============================================================================
+
+ This file is part of the CroPaC-Binaural
+ Copyright (c) 2018 - Leo McCormack.
+
+ CroPaC-Binaural is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ CroPaC-Binaural is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with CroPaC-Binaural.  If not, see <http://www.gnu.org/licenses/>.
+
+ ==============================================================================
+*/
+
+/**
+ * @file hcropaclib_bench.c
+ * @brief End-to-end benchmark of hcropaclib_process()
+ *
+ * Every combination of HRIR set (default, and optionally a SOFA file),
+ * rotation, CroPaC, and analysis limit is timed for each of the synthetic
+ * scenes (see bench_common.h). The real-time factor, nanoseconds per frame and
+ * frames per second are written as JSON, e.g.:
+ *
+ *   hcropaclib_bench --frames 2000 --sofa path/to/hrirs.sofa --out bench.json
+ *
+ * Optionally, a Chrome trace of the codec initialisation and of the most recent
+ * frames of the default HRIR set may also be written (see
+ * hcropaclib_writeTrace()).
+ *
+ * @author Leo McCormack
+ * @date 12.01.2018
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hcropaclib.h"
+#include "bench_common.h"
+
+#define BENCH_DEFAULT_FRAMES ( 1000 )
+#define BENCH_DEFAULT_WARMUP_FRAMES ( 50 )
+#define BENCH_DEFAULT_SAMPLERATE ( 48000 )
+#define BENCH_SEED ( 12345 )
+#define BENCH_YAW_RATE_DEG_PER_FRAME ( 0.5f ) /* head-tracking update with every frame */
+
+static const float bench_anaLimits[] = { HCROPAC_ANA_LIMIT_MIN_VALUE, 12000.0f, HCROPAC_ANA_LIMIT_MAX_VALUE };
+#define BENCH_NUM_ANA_LIMITS ( (int)(sizeof(bench_anaLimits)/sizeof(bench_anaLimits[0])) )
+
+typedef struct _bench_options {
+    int nFrames;
+    int nWarmupFrames;
+    int fs;
+    int frameSize;
+    const char* sofaPath;
+    const char* outPath;
+    const char* tracePath;
+} bench_options;
+
+static void bench_usage(const char* name)
+{
+    printf("Usage: %s [options]\n"
+           "  --frames N      timed frames per configuration (default %d)\n"
+           "  --warmup N      untimed frames per configuration (default %d)\n"
+           "  --fs N          sampling rate, Hz (default %d)\n"
+           "  --framesize N   processing frame size, samples (default %d)\n"
+           "  --sofa PATH     also benchmark with the HRIRs of this SOFA file\n"
+           "  --out PATH      write the JSON results to PATH (default stdout)\n"
+           "  --trace PATH    write a Chrome trace of the default HRIR set to PATH\n",
+           name, BENCH_DEFAULT_FRAMES, BENCH_DEFAULT_WARMUP_FRAMES, BENCH_DEFAULT_SAMPLERATE, HCROPAC_FRAME_SIZE_DEFAULT);
+}
+
+static int bench_parseOptions(int argc, char** argv, bench_options* opts)
+{
+    int i;
+
+    opts->nFrames = BENCH_DEFAULT_FRAMES;
+    opts->nWarmupFrames = BENCH_DEFAULT_WARMUP_FRAMES;
+    opts->fs = BENCH_DEFAULT_SAMPLERATE;
+    opts->frameSize = HCROPAC_FRAME_SIZE_DEFAULT;
+    opts->sofaPath = NULL;
+    opts->outPath = NULL;
+    opts->tracePath = NULL;
+    for(i=1; i<argc; i++){
+        if(i+1 < argc && !strcmp(argv[i], "--frames"))
+            opts->nFrames = atoi(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--warmup"))
+            opts->nWarmupFrames = atoi(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--fs"))
+            opts->fs = atoi(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--framesize"))
+            opts->frameSize = atoi(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--sofa"))
+            opts->sofaPath = argv[++i];
+        else if(i+1 < argc && !strcmp(argv[i], "--out"))
+            opts->outPath = argv[++i];
+        else if(i+1 < argc && !strcmp(argv[i], "--trace"))
+            opts->tracePath = argv[++i];
+        else
+            return 0;
+    }
+    return opts->nFrames > 0 && opts->nWarmupFrames >= 0 && opts->fs > 0;
+}
+
+/* Processes one scene with the current configuration; returns the total processing time, in nanoseconds */
+static double bench_run
+(
+    void* hCroPaC,
+    BENCH_SCENES sceneType,
+    int enableRotation,
+    const bench_options* opts,
+    float** inputs,
+    float** outputs
+)
+{
+    bench_scene scene;
+    int frame, frameSize;
+    double start, total;
+
+    frameSize = hcropaclib_getFrameSize(hCroPaC);
+    hcropaclib_init(hCroPaC, opts->fs); /* resets the processing state */
+    bench_scene_init(&scene, sceneType, opts->fs, BENCH_SEED);
+    total = 0.0;
+    for(frame=0; frame<opts->nWarmupFrames+opts->nFrames; frame++){
+        bench_scene_render(&scene, inputs, frameSize);
+        if(enableRotation)
+            hcropaclib_setYaw(hCroPaC, (float)(frame % 720) * BENCH_YAW_RATE_DEG_PER_FRAME - 180.0f);
+        start = bench_now_ns();
+        hcropaclib_process(hCroPaC, inputs, outputs, BENCH_NUM_FOA_CHANNELS, hcropaclib_getNumEars(), frameSize);
+        if(frame >= opts->nWarmupFrames)
+            total += bench_now_ns() - start;
+    }
+    return total;
+}
+
+int main(int argc, char** argv)
+{
+    bench_options opts;
+    void* hCroPaC;
+    FILE* out;
+    float **inputs, **outputs;
+    int hrirSet, nHrirSets, rot, cropac, ana, scene, frameSize, ch, first;
+    double total_ns, ns_per_frame, audio_ns;
+
+    if(!bench_parseOptions(argc, argv, &opts)){
+        bench_usage(argv[0]);
+        return 1;
+    }
+    out = opts.outPath != NULL ? fopen(opts.outPath, "w") : stdout;
+    if(out == NULL){
+        fprintf(stderr, "Unable to open '%s'\n", opts.outPath);
+        return 1;
+    }
+    inputs = malloc(BENCH_NUM_FOA_CHANNELS*sizeof(float*));
+    outputs = malloc(hcropaclib_getNumEars()*sizeof(float*));
+    for(ch=0; ch<BENCH_NUM_FOA_CHANNELS; ch++)
+        inputs[ch] = malloc(HCROPAC_MAX_FRAME_SIZE*sizeof(float));
+    for(ch=0; ch<hcropaclib_getNumEars(); ch++)
+        outputs[ch] = malloc(HCROPAC_MAX_FRAME_SIZE*sizeof(float));
+
+    fprintf(out, "{\n  \"benchmark\": \"hcropaclib_bench\",\n  \"sampleRate\": %d,\n  \"frames\": %d,\n  \"warmupFrames\": %d,\n",
+            opts.fs, opts.nFrames, opts.nWarmupFrames);
+    nHrirSets = opts.sofaPath != NULL ? 2 : 1;
+    first = 1;
+    for(hrirSet=0; hrirSet<nHrirSets; hrirSet++){
+        /* the codec is only initialised once per HRIR set, as the remaining parameters do not require it */
+        hcropaclib_create(&hCroPaC);
+        hcropaclib_setFrameSize(hCroPaC, opts.frameSize);
+        if(hrirSet == 1)
+            hcropaclib_setSofaFilePath(hCroPaC, opts.sofaPath);
+        else if(opts.tracePath != NULL)
+            hcropaclib_setEnableTracing(hCroPaC, 1);
+        hcropaclib_init(hCroPaC, opts.fs);
+        hcropaclib_initCodec(hCroPaC);
+        if(hcropaclib_getCodecStatus(hCroPaC) != CODEC_STATUS_INITIALISED){
+            fprintf(stderr, "Unable to initialise the codec\n");
+            hcropaclib_destroy(&hCroPaC);
+            continue;
+        }
+        frameSize = hcropaclib_getFrameSize(hCroPaC);
+        audio_ns = 1e9 * (double)frameSize * (double)opts.nFrames / (double)opts.fs;
+        if(first){
+            fprintf(out, "  \"frameSize\": %d,\n  \"nBands\": %d,\n  \"results\": [\n", frameSize, hcropaclib_getNumberOfBands(hCroPaC));
+        }
+
+        for(rot=0; rot<2; rot++){
+            hcropaclib_setEnableRotation(hCroPaC, rot);
+            for(cropac=0; cropac<2; cropac++){
+                hcropaclib_setEnableCroPaC(hCroPaC, cropac);
+                for(ana=0; ana<BENCH_NUM_ANA_LIMITS; ana++){
+                    hcropaclib_setAnaLimit(hCroPaC, bench_anaLimits[ana]);
+                    for(scene=0; scene<BENCH_NUM_SCENES; scene++){
+                        total_ns = bench_run(hCroPaC, (BENCH_SCENES)scene, rot, &opts, inputs, outputs);
+                        ns_per_frame = total_ns/(double)opts.nFrames;
+                        fprintf(out, "%s    {\"hrirs\": \"%s\", \"scene\": \"%s\", \"rotation\": %d, \"cropac\": %d, \"anaLimit_hz\": %.0f, "
+                                "\"ns_per_frame\": %.1f, \"frames_per_second\": %.1f, \"rtf\": %.6f}",
+                                first ? "" : ",\n", hrirSet == 0 ? "default" : "sofa", bench_sceneName((BENCH_SCENES)scene),
+                                rot, cropac, bench_anaLimits[ana], ns_per_frame, 1e9/ns_per_frame, total_ns/audio_ns);
+                        first = 0;
+                    }
+                }
+            }
+        }
+        if(hcropaclib_getEnableTracing(hCroPaC) && hcropaclib_writeTrace(hCroPaC, opts.tracePath) < 0)
+            fprintf(stderr, "Unable to write '%s'\n", opts.tracePath);
+        hcropaclib_destroy(&hCroPaC);
+    }
+    if(first)
+        fprintf(out, "  \"results\": [\n");
+    fprintf(out, "\n  ]\n}\n");
+
+    for(ch=0; ch<BENCH_NUM_FOA_CHANNELS; ch++)
+        free(inputs[ch]);
+    for(ch=0; ch<hcropaclib_getNumEars(); ch++)
+        free(outputs[ch]);
+    free(inputs);
+    free(outputs);
+    if(out != stdout)
+        fclose(out);
+    return first ? 1 : 0;
+}
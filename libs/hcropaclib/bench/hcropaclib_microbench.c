@@ -0,0 +1,294 @@
+/*
+ ==============================================================================
+
+ This file is part of the CroPaC-Binaural
+ Copyright (c) 2018 - Leo McCormack.
+
+ CroPaC-Binaural is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ CroPaC-Binaural is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with CroPaC-Binaural.  If not, see <http://www.gnu.org/licenses/>.
+
+ ==============================================================================
+*/
+
+/**
+ * @file hcropaclib_microbench.c
+ * @brief Per-stage micro-benchmark of the hcropaclib processing loop
+ *
+ * The codec is first warmed up by processing a synthetic scene (see
+ * bench_common.h), after which each stage of the processing loop is timed in
+ * isolation on the resulting state, by calling the same internal kernels as
+ * hcropaclib_processFrame()/hcropaclib_processFrameTF(). Stages that would
+ * otherwise drift from the warmed state (the in-place rotation, and the
+ * transient detector) have their inputs restored, untimed, before every call.
+ * The mean and minimum nanoseconds per call of each stage are written as JSON.
+ *
+ * @author Leo McCormack
+ * @date 12.01.2018
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hcropac_internal.h"
+#include "bench_common.h"
+
+#define MICROBENCH_DEFAULT_ITERATIONS ( 2000 )
+#define MICROBENCH_DEFAULT_WARMUP_FRAMES ( 200 )
+#define MICROBENCH_DEFAULT_SAMPLERATE ( 48000 )
+#define MICROBENCH_SEED ( 12345 )
+
+/** Processing loop stages */
+typedef enum {
+    STAGE_TIME_DOMAIN_CONVERSION = 0,
+    STAGE_TFT_FORWARD,
+    STAGE_ROTATION,
+    STAGE_DECODING,
+    STAGE_COVARIANCES,
+    STAGE_POWERMAP_ARGMAX,
+    STAGE_CROPAC_GAINS,
+    STAGE_INTERP_HRTFS,
+    STAGE_FORMULATE_M,
+    STAGE_TRANSIENT_DETECTOR,
+    STAGE_MIXING,
+    STAGE_TFT_BACKWARD,
+
+    NUM_STAGES
+}MICROBENCH_STAGES;
+
+static const char* stageNames[NUM_STAGES] = {
+    "time_domain_conversion", "tft_forward", "rotation", "decoding", "covariances", "powermap_argmax",
+    "cropac_gains", "interp_hrtfs", "formulate_mixing_matrices", "transient_detector", "mixing", "tft_backward"
+};
+
+/** Warmed state shared by the stages */
+typedef struct _microbench_ctx {
+    hcropaclib_data* pData;
+    int frameSize, nSlots, nBands, nAudibleBands, nAnalysedBands;
+    float* interleavedInput;                            /* last input frame; frameSize x NUM_SH_SIGNALS */
+    float_complex* SHframeTF_snapshot;                  /* warmed (rotated) SHframeTF; flattened */
+    float_complex* circBufferFrames_snapshot;           /* warmed decorrelator delay lines */
+    float transientDetector_snapshot[2][MAX_NUM_BANDS][NUM_EARS];
+    int dir_max_idx[MAX_NUM_BANDS][MAX_TIME_SLOTS];
+    float azi[MAX_NUM_BANDS][MAX_TIME_SLOTS], elev[MAX_NUM_BANDS][MAX_TIME_SLOTS];
+    float bandEnergy[MAX_NUM_BANDS];
+    float eq[MAX_NUM_BANDS];
+} microbench_ctx;
+
+static void microbench_restore(microbench_ctx* ctx, MICROBENCH_STAGES stage)
+{
+    hcropaclib_data* pData = ctx->pData;
+
+    switch(stage){
+        case STAGE_ROTATION:
+            memcpy(FLATTEN3D(pData->SHframeTF), ctx->SHframeTF_snapshot, MAX_NUM_BANDS*NUM_SH_SIGNALS*MAX_TIME_SLOTS*sizeof(float_complex));
+            break;
+#ifdef ENABLE_RESIDUAL_STREAM
+        case STAGE_TRANSIENT_DETECTOR:
+            memcpy(pData->circBufferFrames, ctx->circBufferFrames_snapshot, sizeof(pData->circBufferFrames));
+            memcpy(pData->transientDetector1, ctx->transientDetector_snapshot[0], sizeof(pData->transientDetector1));
+            memcpy(pData->transientDetector2, ctx->transientDetector_snapshot[1], sizeof(pData->transientDetector2));
+            break;
+#endif
+        default:
+            break;
+    }
+}
+
+static void microbench_run(microbench_ctx* ctx, MICROBENCH_STAGES stage)
+{
+    hcropaclib_data* pData = ctx->pData;
+    codecPars* pars = pData->pars;
+    int band, i, n;
+    float inputEnergy[MAX_TIME_SLOTS], G[MAX_TIME_SLOTS];
+    float_complex hrtf_interp[MAX_TIME_SLOTS][NUM_EARS];
+
+    switch(stage){
+        case STAGE_TIME_DOMAIN_CONVERSION:
+            /* interleaved input, as loaded by hcropaclib_processFrame() */
+            for(i=0; i<NUM_SH_SIGNALS; i++)
+                for(n=0; n<ctx->frameSize; n++)
+                    pData->SHFrameTD[i][n] = ctx->interleavedInput[n*NUM_SH_SIGNALS+i];
+            break;
+        case STAGE_TFT_FORWARD:
+            hcropaclib_tftForward(pData, pData->SHFrameTD, ctx->frameSize, pData->SHframeTF);
+            break;
+        case STAGE_ROTATION:
+            hcropaclib_rotateFrameTF(pData, ctx->nBands, ctx->nSlots);
+            break;
+        case STAGE_DECODING:
+            hcropaclib_decodeFrameTF(pData, ctx->nBands, ctx->nAudibleBands, ctx->nSlots, 1);
+            break;
+        case STAGE_COVARIANCES:
+            hcropaclib_updateCovariances(pData, ctx->nAudibleBands, ctx->nSlots, pData->covAvgCoeff, 1, ctx->bandEnergy);
+            break;
+        case STAGE_POWERMAP_ARGMAX:
+            for(band=0; band<ctx->nAnalysedBands; band++)
+                hcropaclib_powermapArgmax(FLATTEN2D(pData->SHframeTF[band]), ctx->nSlots, pars->Y_grid_fmt, pars->grid_nDirs, pars->pwdmap, ctx->dir_max_idx[band]);
+            break;
+        case STAGE_CROPAC_GAINS:
+            for(band=0; band<ctx->nAnalysedBands; band++){
+                hcropaclib_cropacGainsBand(pData, band, ctx->nSlots, ctx->dir_max_idx[band], inputEnergy, G);
+                ctx->bandEnergy[band] = G[0]; /* keeps the result alive */
+            }
+            break;
+        case STAGE_INTERP_HRTFS:
+            for(band=0; band<ctx->nAnalysedBands; band++)
+                hcropaclib_interpHRTFs(pData, band, ctx->nSlots, ctx->azi[band], ctx->elev[band], hrtf_interp);
+            break;
+        case STAGE_FORMULATE_M:
+            for(band=0; band<ctx->nAnalysedBands; band++)
+                hcropaclib_formulateMixingMatrices(pData, band);
+            break;
+        case STAGE_TRANSIENT_DETECTOR:
+#ifdef ENABLE_RESIDUAL_STREAM
+            hcropaclib_transientDetector(pData, ctx->nAudibleBands, ctx->nSlots);
+#endif
+            break;
+        case STAGE_MIXING:
+            hcropaclib_mixFrameTF(pData, ctx->nAudibleBands, ctx->nSlots, ctx->eq);
+            break;
+        case STAGE_TFT_BACKWARD:
+            hcropaclib_tftBackward(pData, pData->binframeTF, ctx->frameSize, pData->binFrameTD);
+            break;
+        default:
+            break;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    void* hCroPaC;
+    microbench_ctx ctx;
+    bench_scene scene;
+    hcropaclib_data* pData;
+    FILE* out;
+    const char* outPath;
+    float **inputs, **outputs;
+    int i, n, ch, stage, frame, nIterations, nWarmupFrames, fs, frameSize, band;
+    double start, elapsed, total, minimum;
+
+    /* options */
+    nIterations = MICROBENCH_DEFAULT_ITERATIONS;
+    nWarmupFrames = MICROBENCH_DEFAULT_WARMUP_FRAMES;
+    fs = MICROBENCH_DEFAULT_SAMPLERATE;
+    frameSize = HCROPAC_FRAME_SIZE_DEFAULT;
+    outPath = NULL;
+    for(i=1; i<argc; i++){
+        if(i+1 < argc && !strcmp(argv[i], "--iterations"))
+            nIterations = atoi(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--warmup"))
+            nWarmupFrames = atoi(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--fs"))
+            fs = atoi(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--framesize"))
+            frameSize = atoi(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--out"))
+            outPath = argv[++i];
+        else{
+            printf("Usage: %s [--iterations N] [--warmup N] [--fs N] [--framesize N] [--out PATH]\n", argv[0]);
+            return 1;
+        }
+    }
+    if(nIterations < 1 || nWarmupFrames < 1 || fs < 1){
+        fprintf(stderr, "Invalid options\n");
+        return 1;
+    }
+
+    /* warm up on a moving source, with rotation and CroPaC enabled */
+    hcropaclib_create(&hCroPaC);
+    hcropaclib_setFrameSize(hCroPaC, frameSize);
+    hcropaclib_setEnableRotation(hCroPaC, 1);
+    hcropaclib_setYaw(hCroPaC, 30.0f);
+    hcropaclib_init(hCroPaC, fs);
+    hcropaclib_initCodec(hCroPaC);
+    if(hcropaclib_getCodecStatus(hCroPaC) != CODEC_STATUS_INITIALISED){
+        fprintf(stderr, "Unable to initialise the codec\n");
+        hcropaclib_destroy(&hCroPaC);
+        return 1;
+    }
+    pData = (hcropaclib_data*)hCroPaC;
+    frameSize = pData->frameSize;
+    inputs = (float**)malloc2d(NUM_SH_SIGNALS, frameSize, sizeof(float));
+    outputs = (float**)malloc2d(NUM_EARS, frameSize, sizeof(float));
+    bench_scene_init(&scene, BENCH_SCENE_MOVING, fs, MICROBENCH_SEED);
+    for(frame=0; frame<nWarmupFrames; frame++){
+        bench_scene_render(&scene, inputs, frameSize);
+        hcropaclib_process(hCroPaC, inputs, outputs, NUM_SH_SIGNALS, NUM_EARS, frameSize);
+    }
+
+    /* snapshot of the warmed state */
+    memset(&ctx, 0, sizeof(microbench_ctx));
+    ctx.pData = pData;
+    ctx.frameSize = frameSize;
+    ctx.nSlots = pData->nSlots;
+    ctx.nBands = pData->nBands;
+    ctx.nAudibleBands = pData->nAudibleBands;
+    for(band=0; band<ctx.nAudibleBands && pData->freqVector[band] < pData->anaLimit_hz; band++)
+        ctx.nAnalysedBands++;
+    ctx.interleavedInput = malloc1d(frameSize*NUM_SH_SIGNALS*sizeof(float));
+    for(n=0; n<frameSize; n++)
+        for(ch=0; ch<NUM_SH_SIGNALS; ch++)
+            ctx.interleavedInput[n*NUM_SH_SIGNALS+ch] = inputs[ch][n];
+    ctx.SHframeTF_snapshot = malloc1d(MAX_NUM_BANDS*NUM_SH_SIGNALS*MAX_TIME_SLOTS*sizeof(float_complex));
+    memcpy(ctx.SHframeTF_snapshot, FLATTEN3D(pData->SHframeTF), MAX_NUM_BANDS*NUM_SH_SIGNALS*MAX_TIME_SLOTS*sizeof(float_complex));
+#ifdef ENABLE_RESIDUAL_STREAM
+    ctx.circBufferFrames_snapshot = malloc1d(sizeof(pData->circBufferFrames));
+    memcpy(ctx.circBufferFrames_snapshot, pData->circBufferFrames, sizeof(pData->circBufferFrames));
+    memcpy(ctx.transientDetector_snapshot[0], pData->transientDetector1, sizeof(pData->transientDetector1));
+    memcpy(ctx.transientDetector_snapshot[1], pData->transientDetector2, sizeof(pData->transientDetector2));
+#endif
+    for(band=0; band<MAX_NUM_BANDS; band++)
+        ctx.eq[band] = pData->EQ[band];
+    microbench_run(&ctx, STAGE_POWERMAP_ARGMAX); /* the DoAs of the warmed frame, for the HRTF interpolation */
+    for(band=0; band<ctx.nAnalysedBands; band++){
+        for(i=0; i<ctx.nSlots; i++){
+            ctx.azi[band][i] = pData->pars->grid_dirs_deg[ctx.dir_max_idx[band][i]*2];
+            ctx.elev[band][i] = pData->pars->grid_dirs_deg[ctx.dir_max_idx[band][i]*2+1];
+        }
+    }
+
+    /* time each stage */
+    out = outPath != NULL ? fopen(outPath, "w") : stdout;
+    if(out == NULL){
+        fprintf(stderr, "Unable to open '%s'\n", outPath);
+        return 1;
+    }
+    fprintf(out, "{\n  \"benchmark\": \"hcropaclib_microbench\",\n  \"sampleRate\": %d,\n  \"frameSize\": %d,\n  \"nBands\": %d,\n"
+            "  \"nAnalysedBands\": %d,\n  \"iterations\": %d,\n  \"stages\": [\n",
+            fs, frameSize, ctx.nBands, ctx.nAnalysedBands, nIterations);
+    for(stage=0; stage<NUM_STAGES; stage++){
+        total = 0.0;
+        minimum = 1e30;
+        for(i=0; i<nIterations; i++){
+            microbench_restore(&ctx, (MICROBENCH_STAGES)stage);
+            start = bench_now_ns();
+            microbench_run(&ctx, (MICROBENCH_STAGES)stage);
+            elapsed = bench_now_ns() - start;
+            total += elapsed;
+            minimum = elapsed < minimum ? elapsed : minimum;
+        }
+        fprintf(out, "    {\"stage\": \"%s\", \"ns_mean\": %.1f, \"ns_min\": %.1f}%s\n",
+                stageNames[stage], total/(double)nIterations, minimum, stage < NUM_STAGES-1 ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+
+    if(out != stdout)
+        fclose(out);
+    free(ctx.interleavedInput);
+    free(ctx.SHframeTF_snapshot);
+    free(ctx.circBufferFrames_snapshot);
+    free(inputs);
+    free(outputs);
+    hcropaclib_destroy(&hCroPaC);
+    return 0;
+}
@@ -0,0 +1,453 @@
+/*
+ ==============================================================================
+
+ This file is part of the CroPaC-Binaural
+ Copyright (c) 2018 - Leo McCormack.
+
+ CroPaC-Binaural is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ CroPaC-Binaural is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with CroPaC-Binaural.  If not, see <http://www.gnu.org/licenses/>.
+
+ ==============================================================================
+*/
+
+/**
+ * @file hcropaclib_replay.c
+ * @brief Replays a recording of hcropaclib_process() (see
+ *        hcropaclib_setEnableRecording()), and reports its timing
+ *
+ * The recorded input frames are processed in order, with each recorded
+ * parameter change and (re)initialisation applied before the frame during
+ * which it was made. The output of every frame is compared with the recorded
+ * output hash; any difference is reported, and the replay fails. The
+ * processing time of every frame is measured, and the mean, percentiles,
+ * deadline misses, and the slowest frames are reported, e.g.:
+ *
+ *   hcropaclib_replay session.hcrec --iterations 10 --out replay.json
+ *
+ * By default, the frames are processed back-to-back; with --realtime, each is
+ * instead started at its recorded time, so that the timing also reflects the
+ * recorded host scheduling.
+ *
+ * @author Leo McCormack
+ * @date 12.01.2018
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hcropaclib.h"
+#include "bench_common.h"
+
+#define REPLAY_NUM_SLOWEST ( 10 )
+
+typedef struct _replay_options {
+    const char* recordingPath;
+    const char* sofaPath;
+    const char* outPath;
+    int nIterations;
+    int realtime;
+} replay_options;
+
+/** A parameter event of a recording */
+typedef struct _replay_event {
+    int frame;
+    int param;
+    int index;
+    float value;
+    double ts_us;
+    int order;  /**< position in the file; events of the same frame are applied in this order */
+} replay_event;
+
+/** A frame of a recording */
+typedef struct _replay_frame {
+    double ts_us;
+    int nInputs;
+    int nOutputs;
+    int nSamples;
+    unsigned long long outputHash;
+    float* inputs; /**< nInputs x nSamples */
+} replay_frame;
+
+/** A recording (see hcropaclib_writeRecording()) */
+typedef struct _replay_recording {
+    int fs;
+    int full;
+    int nPaths;
+    int nEvents;
+    int nFrames;
+    char** paths;
+    replay_event* events;
+    replay_frame* frames;
+} replay_recording;
+
+static void replay_usage(const char* name)
+{
+    printf("Usage: %s RECORDING [options]\n"
+           "  --sofa PATH       use this SOFA file in place of any recorded SOFA file paths\n"
+           "  --iterations N    number of times to replay the recording (default 1)\n"
+           "  --realtime        start each frame at its recorded time\n"
+           "  --out PATH        write the JSON results to PATH\n",
+           name);
+}
+
+static int replay_parseOptions(int argc, char** argv, replay_options* opts)
+{
+    int i;
+
+    opts->recordingPath = NULL;
+    opts->sofaPath = NULL;
+    opts->outPath = NULL;
+    opts->nIterations = 1;
+    opts->realtime = 0;
+    for(i=1; i<argc; i++){
+        if(i+1 < argc && !strcmp(argv[i], "--sofa"))
+            opts->sofaPath = argv[++i];
+        else if(i+1 < argc && !strcmp(argv[i], "--iterations"))
+            opts->nIterations = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--realtime"))
+            opts->realtime = 1;
+        else if(i+1 < argc && !strcmp(argv[i], "--out"))
+            opts->outPath = argv[++i];
+        else if(argv[i][0] != '-' && opts->recordingPath == NULL)
+            opts->recordingPath = argv[i];
+        else
+            return 0;
+    }
+    return opts->recordingPath != NULL && opts->nIterations > 0;
+}
+
+static int replay_read(FILE* file, void* data, size_t size, size_t n)
+{
+    return fread(data, size, n, file) == n;
+}
+
+static int replay_compareEvents(const void* a, const void* b)
+{
+    const replay_event* ea = (const replay_event*)a;
+    const replay_event* eb = (const replay_event*)b;
+    if(ea->frame != eb->frame)
+        return ea->frame < eb->frame ? -1 : 1;
+    return ea->order < eb->order ? -1 : (ea->order > eb->order ? 1 : 0);
+}
+
+static int replay_compareDoubles(const void* a, const void* b)
+{
+    double da = *(const double*)a, db = *(const double*)b;
+    return da < db ? -1 : (da > db ? 1 : 0);
+}
+
+static void replay_free(replay_recording* rec)
+{
+    int i;
+
+    for(i=0; rec->paths != NULL && i<rec->nPaths; i++)
+        free(rec->paths[i]);
+    for(i=0; rec->frames != NULL && i<rec->nFrames; i++)
+        free(rec->frames[i].inputs);
+    free(rec->paths);
+    free(rec->events);
+    free(rec->frames);
+}
+
+/* Reads a recording; returns 0 if it could not be read */
+static int replay_load(const char* path, replay_recording* rec)
+{
+    FILE* file;
+    char magic[8];
+    int i, ok, len, version, header[5];
+    replay_event* event;
+    replay_frame* frame;
+
+    memset(rec, 0, sizeof(replay_recording));
+    file = fopen(path, "rb");
+    if(file == NULL)
+        return 0;
+    ok = replay_read(file, magic, 1, 8) && !memcmp(magic, HCROPAC_RECORDING_MAGIC, 8);
+    ok = ok && replay_read(file, &version, sizeof(int), 1) && version == HCROPAC_RECORDING_VERSION;
+    ok = ok && replay_read(file, header, sizeof(int), 5);
+    if(ok){
+        rec->fs = header[0];
+        rec->nPaths = header[1];
+        rec->nEvents = header[2];
+        rec->nFrames = header[3];
+        rec->full = header[4];
+        ok = rec->nPaths >= 0 && rec->nEvents >= 0 && rec->nFrames >= 0;
+    }
+    if(ok){
+        rec->paths = calloc(rec->nPaths > 0 ? rec->nPaths : 1, sizeof(char*));
+        rec->events = calloc(rec->nEvents > 0 ? rec->nEvents : 1, sizeof(replay_event));
+        rec->frames = calloc(rec->nFrames > 0 ? rec->nFrames : 1, sizeof(replay_frame));
+    }
+    for(i=0; ok && i<rec->nPaths; i++){
+        ok = replay_read(file, &len, sizeof(int), 1) && len >= 0;
+        if(ok){
+            rec->paths[i] = calloc(len+1, 1);
+            ok = len == 0 || replay_read(file, rec->paths[i], 1, len);
+        }
+    }
+    for(i=0; ok && i<rec->nEvents; i++){
+        event = &(rec->events[i]);
+        ok = replay_read(file, &(event->frame), sizeof(int), 1) && replay_read(file, &(event->param), sizeof(int), 1) &&
+             replay_read(file, &(event->index), sizeof(int), 1) && replay_read(file, &(event->value), sizeof(float), 1) &&
+             replay_read(file, &(event->ts_us), sizeof(double), 1);
+        event->order = i;
+    }
+    for(i=0; ok && i<rec->nFrames; i++){
+        frame = &(rec->frames[i]);
+        ok = replay_read(file, &(frame->ts_us), sizeof(double), 1) && replay_read(file, &(frame->nInputs), sizeof(int), 1) &&
+             replay_read(file, &(frame->nOutputs), sizeof(int), 1) && replay_read(file, &(frame->nSamples), sizeof(int), 1) &&
+             replay_read(file, &(frame->outputHash), sizeof(unsigned long long), 1);
+        ok = ok && frame->nInputs >= 0 && frame->nOutputs >= 0 && frame->nSamples >= 0;
+        if(ok){
+            frame->inputs = malloc((frame->nInputs*frame->nSamples > 0 ? frame->nInputs*frame->nSamples : 1)*sizeof(float));
+            ok = replay_read(file, frame->inputs, sizeof(float), frame->nInputs*frame->nSamples);
+        }
+    }
+    fclose(file);
+    if(!ok){
+        replay_free(rec);
+        return 0;
+    }
+
+    /* concurrent set functions may have claimed their slots out of order */
+    qsort(rec->events, rec->nEvents, sizeof(replay_event), replay_compareEvents);
+    return 1;
+}
+
+/* Applies a recorded event to the replay; returns 0 if the codec failed to initialise */
+static int replay_applyEvent
+(
+    void* hCroPaC,
+    const replay_recording* rec,
+    const replay_event* event,
+    const replay_options* opts
+)
+{
+    switch((HCROPAC_REC_PARAMS)event->param){
+        case HCROPAC_REC_INIT:                   hcropaclib_init(hCroPaC, (int)event->value); break;
+        case HCROPAC_REC_INIT_CODEC:
+            hcropaclib_initCodec(hCroPaC);
+            return hcropaclib_getCodecStatus(hCroPaC) == CODEC_STATUS_INITIALISED;
+        case HCROPAC_REC_SOFA_PATH:
+            if(opts->sofaPath != NULL)
+                hcropaclib_setSofaFilePath(hCroPaC, opts->sofaPath);
+            else if(event->index >= 0 && event->index < rec->nPaths)
+                hcropaclib_setSofaFilePath(hCroPaC, rec->paths[event->index]);
+            break;
+        case HCROPAC_REC_USE_DEFAULT_HRIRS:      hcropaclib_setUseDefaultHRIRsflag(hCroPaC, (int)event->value); break;
+        case HCROPAC_REC_FLIP_YAW:               hcropaclib_setFlipYaw(hCroPaC, (int)event->value); break;
+        case HCROPAC_REC_FLIP_PITCH:             hcropaclib_setFlipPitch(hCroPaC, (int)event->value); break;
+        case HCROPAC_REC_FLIP_ROLL:              hcropaclib_setFlipRoll(hCroPaC, (int)event->value); break;
+        case HCROPAC_REC_RPY_FLAG:               hcropaclib_setRPYflag(hCroPaC, (int)event->value); break;
+        case HCROPAC_REC_YAW:                    hcropaclib_setYaw(hCroPaC, event->value); break;
+        case HCROPAC_REC_PITCH:                  hcropaclib_setPitch(hCroPaC, event->value); break;
+        case HCROPAC_REC_ROLL:                   hcropaclib_setRoll(hCroPaC, event->value); break;
+        case HCROPAC_REC_ENABLE_ROTATION:        hcropaclib_setEnableRotation(hCroPaC, (int)event->value); break;
+        case HCROPAC_REC_ENABLE_CROPAC:          hcropaclib_setEnableCroPaC(hCroPaC, (int)event->value); break;
+        case HCROPAC_REC_BALANCE:
+            if(event->index < 0)
+                hcropaclib_setBalanceAllBands(hCroPaC, event->value);
+            else
+                hcropaclib_setBalance(hCroPaC, event->value, event->index);
+            break;
+        case HCROPAC_REC_EQ:
+            if(event->index < 0)
+                hcropaclib_setEQAllBands(hCroPaC, event->value);
+            else
+                hcropaclib_setEQ(hCroPaC, event->value, event->index);
+            break;
+        case HCROPAC_REC_COV_AVG:                hcropaclib_setCovAvg(hCroPaC, event->value); break;
+        case HCROPAC_REC_ANA_LIMIT:              hcropaclib_setAnaLimit(hCroPaC, event->value); break;
+        case HCROPAC_REC_CH_ORDER:               hcropaclib_setChOrder(hCroPaC, (int)event->value); break;
+        case HCROPAC_REC_NORM_TYPE:              hcropaclib_setNormType(hCroPaC, (int)event->value); break;
+        case HCROPAC_REC_FRAME_SIZE:             hcropaclib_setFrameSize(hCroPaC, (int)event->value); break;
+        case HCROPAC_REC_TRANSFORM_BACKEND:      hcropaclib_setTransformBackend(hCroPaC, (int)event->value); break;
+        case HCROPAC_REC_LINEAR_DECODER_MODE:    hcropaclib_setLinearDecoderMode(hCroPaC, (int)event->value); break;
+        case HCROPAC_REC_ENABLE_DIFF_CORRECTION: hcropaclib_setEnableDiffCorrection(hCroPaC, (int)event->value); break;
+        case HCROPAC_REC_HRIR_PREPROC:           hcropaclib_setHRIRsPreProc(hCroPaC, (HRIR_PREPROC_OPTIONS)(int)event->value); break;
+        case HCROPAC_REC_SCANNING_GRID_DENSITY:  hcropaclib_setScanningGridDensity(hCroPaC, (int)event->value); break;
+        case HCROPAC_REC_ENABLE_SILENCE_GATE:    hcropaclib_setEnableSilenceGate(hCroPaC, (int)event->value); break;
+        case HCROPAC_REC_SILENCE_GATE_THRESHOLD: hcropaclib_setSilenceGateThreshold(hCroPaC, event->value); break;
+        case HCROPAC_REC_SILENCE_GATE_HANGOVER:  hcropaclib_setSilenceGateHangover(hCroPaC, event->value); break;
+        case HCROPAC_REC_ENABLE_BAND_SKIPPING:   hcropaclib_setEnableBandSkipping(hCroPaC, (int)event->value); break;
+        case HCROPAC_REC_BAND_SKIP_FLOOR:        hcropaclib_setBandSkipFloor(hCroPaC, event->value); break;
+        case HCROPAC_REC_ENABLE_ANALYSIS_ONLY:   hcropaclib_setEnableAnalysisOnly(hCroPaC, (int)event->value); break;
+        case HCROPAC_REC_REFRESH_PARAMS:         hcropaclib_refreshParams(hCroPaC); break;
+        default: break;
+    }
+    return 1;
+}
+
+/* Same as the recorder (64-bit FNV-1a, over the first two output channels) */
+static unsigned long long replay_hash(float** outputs, int nOutputs, int nSamples)
+{
+    unsigned long long hash;
+    const unsigned char* bytes;
+    int ch, n, b;
+
+    hash = 14695981039346656037ULL;
+    for(ch=0; ch<(nOutputs < 2 ? nOutputs : 2); ch++){
+        for(n=0; n<nSamples; n++){
+            bytes = (const unsigned char*)&(outputs[ch][n]);
+            for(b=0; b<(int)sizeof(float); b++){
+                hash ^= (unsigned long long)bytes[b];
+                hash *= 1099511628211ULL;
+            }
+        }
+    }
+    return hash;
+}
+
+int main(int argc, char** argv)
+{
+    replay_options opts;
+    replay_recording rec;
+    replay_frame* frame;
+    void* hCroPaC;
+    FILE* out;
+    float *inputs[BENCH_NUM_FOA_CHANNELS], **outputs;
+    double *frame_ns, *all_ns, t_ns, start_ns, replayStart_ns, total_ns, period_ns, fs;
+    int it, i, j, ch, e, nTimed, maxOutputs, maxSamples, nMisses, nMismatches, firstMismatch, nInitFailures, slowest[REPLAY_NUM_SLOWEST], nSlowest;
+    int* mismatch;
+
+    if(!replay_parseOptions(argc, argv, &opts)){
+        replay_usage(argv[0]);
+        return 2;
+    }
+    if(!replay_load(opts.recordingPath, &rec)){
+        fprintf(stderr, "Unable to read the recording '%s'\n", opts.recordingPath);
+        return 2;
+    }
+    if(rec.nFrames == 0){
+        fprintf(stderr, "The recording '%s' has no frames\n", opts.recordingPath);
+        replay_free(&rec);
+        return 2;
+    }
+    maxOutputs = 1;
+    maxSamples = 1;
+    for(i=0; i<rec.nFrames; i++){
+        rec.frames[i].nInputs = rec.frames[i].nInputs < BENCH_NUM_FOA_CHANNELS ? rec.frames[i].nInputs : BENCH_NUM_FOA_CHANNELS;
+        maxOutputs = rec.frames[i].nOutputs > maxOutputs ? rec.frames[i].nOutputs : maxOutputs;
+        maxSamples = rec.frames[i].nSamples > maxSamples ? rec.frames[i].nSamples : maxSamples;
+    }
+    outputs = malloc(maxOutputs*sizeof(float*));
+    for(ch=0; ch<maxOutputs; ch++)
+        outputs[ch] = malloc(maxSamples*sizeof(float));
+    frame_ns = calloc(rec.nFrames, sizeof(double));   /* worst case over all iterations */
+    nTimed = rec.nFrames*opts.nIterations;
+    all_ns = malloc((size_t)nTimed*sizeof(double));
+    mismatch = calloc(rec.nFrames, sizeof(int));
+
+    /* every iteration starts from a new instance, as did the recording */
+    nInitFailures = 0;
+    total_ns = 0.0;
+    nMisses = 0;
+    for(it=0; it<opts.nIterations; it++){
+        hcropaclib_create(&hCroPaC);
+        e = 0;
+        fs = (double)rec.fs;
+        replayStart_ns = bench_now_ns();
+        for(i=0; i<rec.nFrames; i++){
+            frame = &(rec.frames[i]);
+            for(; e<rec.nEvents && rec.events[e].frame <= i; e++){
+                if(rec.events[e].param == HCROPAC_REC_INIT)
+                    fs = (double)rec.events[e].value;
+                if(!replay_applyEvent(hCroPaC, &rec, &(rec.events[e]), &opts))
+                    nInitFailures++;
+            }
+            for(ch=0; ch<frame->nInputs; ch++)
+                inputs[ch] = &(frame->inputs[ch*frame->nSamples]);
+            if(opts.realtime){
+                /* spins, rather than sleeps, to avoid the scheduler's wake-up latency */
+                while(bench_now_ns() - replayStart_ns < 1e3*frame->ts_us)
+                    ;
+            }
+            start_ns = bench_now_ns();
+            hcropaclib_process(hCroPaC, inputs, outputs, frame->nInputs, frame->nOutputs, frame->nSamples);
+            t_ns = bench_now_ns() - start_ns;
+            all_ns[it*rec.nFrames + i] = t_ns;
+            total_ns += t_ns;
+            frame_ns[i] = t_ns > frame_ns[i] ? t_ns : frame_ns[i];
+            period_ns = fs > 0.0 ? 1e9*(double)frame->nSamples/fs : 0.0;
+            if(period_ns > 0.0 && t_ns > period_ns)
+                nMisses++;
+            if(replay_hash(outputs, frame->nOutputs, frame->nSamples) != frame->outputHash)
+                mismatch[i] = 1;
+        }
+        hcropaclib_destroy(&hCroPaC);
+    }
+
+    /* summary */
+    nMismatches = 0;
+    firstMismatch = -1;
+    for(i=0; i<rec.nFrames; i++){
+        if(mismatch[i] && firstMismatch < 0)
+            firstMismatch = i;
+        nMismatches += mismatch[i];
+    }
+    nSlowest = 0; /* insertion into the list of the slowest frames, slowest first */
+    for(i=0; i<rec.nFrames; i++){
+        for(j=nSlowest; j>0 && frame_ns[i] > frame_ns[slowest[j-1]]; j--)
+            if(j < REPLAY_NUM_SLOWEST)
+                slowest[j] = slowest[j-1];
+        if(j < REPLAY_NUM_SLOWEST){
+            slowest[j] = i;
+            nSlowest = nSlowest < REPLAY_NUM_SLOWEST ? nSlowest + 1 : REPLAY_NUM_SLOWEST;
+        }
+    }
+    qsort(all_ns, nTimed, sizeof(double), replay_compareDoubles);
+#define REPLAY_PERCENTILE(p) ( all_ns[(int)((p)*(double)(nTimed - 1) + 0.5)] )
+    printf("%s: %d frames at %d Hz, %d events%s, %d iteration(s)%s\n", opts.recordingPath, rec.nFrames, rec.fs, rec.nEvents,
+           rec.full ? " (stopped early, as the recording buffer was full)" : "", opts.nIterations, opts.realtime ? ", real-time" : "");
+    printf("  mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us, %d deadline miss(es)\n",
+           1e-3*total_ns/(double)nTimed, 1e-3*REPLAY_PERCENTILE(0.5), 1e-3*REPLAY_PERCENTILE(0.99), 1e-3*all_ns[nTimed - 1], nMisses);
+    printf("  slowest frames:");
+    for(i=0; i<nSlowest; i++)
+        printf(" %d (%.1f us)", slowest[i], 1e-3*frame_ns[slowest[i]]);
+    printf("\n");
+    if(nInitFailures > 0)
+        fprintf(stderr, "  the codec failed to initialise %d time(s); are the recorded SOFA files available (see --sofa)?\n", nInitFailures);
+    if(nMismatches > 0)
+        printf("  MISMATCH: the output of %d frame(s) differs from the recording, first at frame %d\n", nMismatches, firstMismatch);
+    else
+        printf("  the output of every frame matches the recording\n");
+
+    if(opts.outPath != NULL){
+        out = fopen(opts.outPath, "w");
+        if(out == NULL)
+            fprintf(stderr, "Unable to open '%s'\n", opts.outPath);
+        else{
+            fprintf(out, "{\n  \"benchmark\": \"hcropaclib_replay\",\n  \"recording\": \"%s\",\n  \"sampleRate\": %d,\n  \"frames\": %d,\n"
+                    "  \"events\": %d,\n  \"iterations\": %d,\n  \"realtime\": %d,\n  \"mean_us\": %.3f,\n  \"p50_us\": %.3f,\n"
+                    "  \"p99_us\": %.3f,\n  \"max_us\": %.3f,\n  \"deadlineMisses\": %d,\n  \"mismatchedFrames\": %d,\n  \"firstMismatch\": %d,\n"
+                    "  \"slowestFrames\": [",
+                    opts.recordingPath, rec.fs, rec.nFrames, rec.nEvents, opts.nIterations, opts.realtime,
+                    1e-3*total_ns/(double)nTimed, 1e-3*REPLAY_PERCENTILE(0.5), 1e-3*REPLAY_PERCENTILE(0.99), 1e-3*all_ns[nTimed - 1],
+                    nMisses, nMismatches, firstMismatch);
+            for(i=0; i<nSlowest; i++)
+                fprintf(out, "%s{\"frame\": %d, \"max_us\": %.3f}", i == 0 ? "" : ", ", slowest[i], 1e-3*frame_ns[slowest[i]]);
+            fprintf(out, "]\n}\n");
+            fclose(out);
+        }
+    }
+#undef REPLAY_PERCENTILE
+
+    for(ch=0; ch<maxOutputs; ch++)
+        free(outputs[ch]);
+    free(outputs);
+    free(frame_ns);
+    free(all_ns);
+    free(mismatch);
+    replay_free(&rec);
+    return nMismatches > 0 ? 1 : 0;
+}
@@ -71,13 +71,13 @@ typedef enum _HCROPAC_CH_ORDER {
 /**
  * Available Ambisonic normalisation conventions
  *
- * @note NORM_FUMA only supported for 1st order input and does NOT have the
- *       1/sqrt(2) scaling on the omni.
+ * @note NORM_FUMA only supported for 1st order input, where it is the same as
+ *       NORM_SN3D, except for the 1/sqrt(2) scaling on the omni.
  */
 typedef enum _HCROPAC_NORM_TYPES {
     NORM_N3D = 1, /**< orthonormalised (N3D) */
     NORM_SN3D,    /**< Schmidt semi-normalisation (SN3D) */
-    NORM_FUMA     /**< (Obsolete) Same as NORM_SN3D for 1st order */
+    NORM_FUMA     /**< (Obsolete) NORM_SN3D with a -3dB omni, for 1st order */
     
 } HCROPAC_NORM_TYPES;
 
@@ -92,6 +92,29 @@ typedef enum {
     HRIR_PREPROC_ALL,         /**< Diffuse-field EQ AND phase-simplification */
 }HRIR_PREPROC_OPTIONS;
 
+/**
+ * Available time-frequency transforms
+ */
+typedef enum {
+    TFT_AFSTFT_HYBRID = 1, /**< Alias-free STFT with hybrid filtering; 133
+                            *   bands, with finer resolution at low
+                            *   frequencies */
+    TFT_STFT               /**< Windowed-FFT STFT with 50% overlap; 129
+                            *   uniformly spaced bands, lower latency */
+}HCROPAC_TFT_BACKENDS;
+
+/**
+ * Available linear decoding modes (used when CroPaC is disabled)
+ */
+typedef enum {
+    LINEAR_DECODER_STFT = 1, /**< Decoding matrices applied in the time-frequency
+                              *   domain */
+    LINEAR_DECODER_FIR       /**< Decoding filters applied via uniformly
+                              *   partitioned convolution; bypasses the
+                              *   time-frequency transform and its latency,
+                              *   and therefore also disables CroPaC */
+}HCROPAC_LINEAR_DECODER_MODES;
+
 /**
  * Current status of the codec.
  */
@@ -108,6 +131,165 @@ typedef enum _HCROPAC_CODEC_STATUS {
 #define HCROPAC_PROGRESSBARTEXT_CHAR_LENGTH ( 256 )
 #define HCROPAC_ANA_LIMIT_MIN_VALUE ( 4000.0f )
 #define HCROPAC_ANA_LIMIT_MAX_VALUE ( 20000.0f )
+#define HCROPAC_GATE_THRESHOLD_MIN_VALUE ( -140.0f )
+#define HCROPAC_GATE_THRESHOLD_MAX_VALUE ( -20.0f )
+#define HCROPAC_GATE_HANGOVER_MIN_VALUE ( 0.0f )
+#define HCROPAC_GATE_HANGOVER_MAX_VALUE ( 5000.0f )
+#define HCROPAC_BAND_FLOOR_MIN_VALUE ( -120.0f )
+#define HCROPAC_BAND_FLOOR_MAX_VALUE ( -10.0f )
+#define HCROPAC_DEADLINE_FRACTION_MIN_VALUE ( 0.05f )
+#define HCROPAC_DEADLINE_FRACTION_MAX_VALUE ( 1.0f )
+#define HCROPAC_RECORDING_LENGTH_MIN_VALUE ( 1.0f )
+#define HCROPAC_RECORDING_LENGTH_MAX_VALUE ( 600.0f )
+#define HCROPAC_RECORDING_LENGTH_DEFAULT ( 30.0f )
+#define HCROPAC_MIN_FRAME_SIZE ( 128 )
+#define HCROPAC_MAX_FRAME_SIZE ( 1024 )
+#define HCROPAC_FRAME_SIZE_DEFAULT ( 512 )
+#define HCROPAC_GRID_DENSITY_MIN_VALUE ( 0 )
+#define HCROPAC_GRID_DENSITY_MAX_VALUE ( 16 )
+#define HCROPAC_GRID_DENSITY_DEFAULT_VALUE ( 12 )
+#define HCROPAC_MAX_NUM_BANDS ( 133 )
+#define HCROPAC_MAX_TIME_SLOTS ( HCROPAC_MAX_FRAME_SIZE/128 )
+
+/**
+ * Per-frame CroPaC analysis metadata, for each band and time slot of the most
+ * recently processed frame (see hcropaclib_getMetadata())
+ *
+ * Only bands below 'nAnalysedBands' (i.e. those below the analysis limit) and
+ * time slots below 'nTimeSlots' hold valid data. Bands skipped by band-sparse
+ * processing have a 'dirIdx' of -1, and zero gain and energies. Directions are
+ * given after the scene rotation. Energies are omnidirectional-equivalent (N3D)
+ * signal powers, where 'directEnergy' is that of the CroPaC-weighted beamformer
+ * signal steered towards the DoA, and 'diffuseEnergy' is the remainder.
+ */
+typedef struct _hcropaclib_metadata {
+    int nBands;                                                               /**< number of bands of the current transform */
+    int nTimeSlots;                                                           /**< number of time slots per frame */
+    int nAnalysedBands;                                                       /**< number of bands with valid metadata */
+    float freqVector[HCROPAC_MAX_NUM_BANDS];                                  /**< band centre frequencies, Hz */
+    int dirIdx[HCROPAC_MAX_NUM_BANDS][HCROPAC_MAX_TIME_SLOTS];                /**< index of the scanning grid direction with the most energy */
+    float azi[HCROPAC_MAX_NUM_BANDS][HCROPAC_MAX_TIME_SLOTS];                 /**< DoA azimuth, degrees */
+    float elev[HCROPAC_MAX_NUM_BANDS][HCROPAC_MAX_TIME_SLOTS];                /**< DoA elevation, degrees */
+    float gain[HCROPAC_MAX_NUM_BANDS][HCROPAC_MAX_TIME_SLOTS];                /**< CroPaC gain, G (0: entirely diffuse) */
+    float directEnergy[HCROPAC_MAX_NUM_BANDS][HCROPAC_MAX_TIME_SLOTS];        /**< energy of the direct component */
+    float diffuseEnergy[HCROPAC_MAX_NUM_BANDS][HCROPAC_MAX_TIME_SLOTS];       /**< energy of the diffuse component */
+} hcropaclib_metadata;
+
+#define HCROPAC_METADATA_VERSION ( 1 )
+#define HCROPAC_METADATA_HEADER_BYTES ( 8 )
+#define HCROPAC_METADATA_BYTES_PER_TILE ( 3 )
+#define HCROPAC_METADATA_MAX_BYTES ( HCROPAC_METADATA_HEADER_BYTES + HCROPAC_METADATA_BYTES_PER_TILE*HCROPAC_MAX_NUM_BANDS*HCROPAC_MAX_TIME_SLOTS )
+
+/**
+ * Stages of the processing loop, as timed by the profiler (see
+ * hcropaclib_getProfile())
+ */
+typedef enum {
+    HCROPAC_PROFILE_INPUT = 0,    /**< Loading the input, the silence gate, and
+                                   *   the FIR linear decoder (if in use) */
+    HCROPAC_PROFILE_TFT_FORWARD,  /**< Forward time-frequency transform */
+    HCROPAC_PROFILE_ROTATION,     /**< Sound-field rotation */
+    HCROPAC_PROFILE_DECODING,     /**< Linear (prototype) decoding */
+    HCROPAC_PROFILE_COVARIANCES,  /**< Covariance matrix updates */
+    HCROPAC_PROFILE_ANALYSIS,     /**< Power-map, DoA estimation, CroPaC gains */
+    HCROPAC_PROFILE_SYNTHESIS,    /**< HRTF interpolation, target covariance
+                                   *   matrices, and the mixing matrices */
+    HCROPAC_PROFILE_MIXING,       /**< Transient detection and mixing */
+    HCROPAC_PROFILE_TFT_BACKWARD, /**< Inverse time-frequency transform */
+    HCROPAC_PROFILE_OUTPUT,       /**< Copying to the output */
+
+    HCROPAC_PROFILE_NUM_STAGES
+}HCROPAC_PROFILE_STAGES;
+
+/**
+ * Processing time statistics, accumulated over the frames processed since the
+ * profiler was last reset (see hcropaclib_getProfile())
+ */
+typedef struct _hcropaclib_profile {
+    int nFrames;                                    /**< number of profiled frames */
+    float frameMean_us;                             /**< mean processing time of a frame, microseconds */
+    float frameMax_us;                              /**< worst-case processing time of a frame, microseconds */
+    float cpuLoad;                                  /**< mean processing time relative to the duration of a frame (1: real-time limit) */
+    float stageMean_us[HCROPAC_PROFILE_NUM_STAGES]; /**< mean processing time of each stage per frame, microseconds */
+} hcropaclib_profile;
+
+/**
+ * Processing time distribution of the process calls, since the latency
+ * statistics were last reset (see hcropaclib_getLatencyStats())
+ *
+ * Percentiles are taken from a fixed-bucket (1/8 octave) histogram, and are
+ * therefore the upper edge of the bucket they fall into (i.e. they overestimate
+ * by at most 9%), although never more than 'max_us'.
+ */
+typedef struct _hcropaclib_latency {
+    int nFrames;         /**< number of timed process calls */
+    int nDeadlineMisses; /**< number of those calls that took longer than the deadline */
+    float deadline_us;   /**< current deadline, microseconds (see hcropaclib_setDeadlineFraction()) */
+    float p50_us;        /**< median processing time, microseconds */
+    float p99_us;        /**< 99th percentile processing time, microseconds */
+    float p999_us;       /**< 99.9th percentile processing time, microseconds */
+    float max_us;        /**< worst-case processing time, microseconds */
+} hcropaclib_latency;
+
+/** States of the recorder (see hcropaclib_setEnableRecording()) */
+typedef enum {
+    HCROPAC_RECORDER_OFF = 0,   /**< Not recording */
+    HCROPAC_RECORDER_ARMED,     /**< Recording starts with the next call to
+                                 *   hcropaclib_init() */
+    HCROPAC_RECORDER_RECORDING, /**< Recording */
+    HCROPAC_RECORDER_FULL       /**< Recording stopped, as the recording buffer
+                                 *   is full */
+}HCROPAC_RECORDER_STATES;
+
+/**
+ * Parameter events of a recording (see hcropaclib_writeRecording()); each
+ * corresponds to the set function of the same name, taking the event 'value'
+ * (and the 'index' as the band index, where applicable)
+ *
+ * @note These identifiers are part of the recording format, and therefore must
+ *       never be renumbered. They are listed in the order in which the start of
+ *       a recording re-applies them.
+ */
+typedef enum {
+    HCROPAC_REC_INIT = 0,             /**< hcropaclib_init(); value: sample rate */
+    HCROPAC_REC_INIT_CODEC,           /**< hcropaclib_initCodec() finished */
+    HCROPAC_REC_SOFA_PATH,            /**< index: path index of the recording */
+    HCROPAC_REC_USE_DEFAULT_HRIRS,
+    HCROPAC_REC_FLIP_YAW,
+    HCROPAC_REC_FLIP_PITCH,
+    HCROPAC_REC_FLIP_ROLL,
+    HCROPAC_REC_RPY_FLAG,
+    HCROPAC_REC_YAW,
+    HCROPAC_REC_PITCH,
+    HCROPAC_REC_ROLL,
+    HCROPAC_REC_ENABLE_ROTATION,
+    HCROPAC_REC_ENABLE_CROPAC,
+    HCROPAC_REC_BALANCE,              /**< index: band, or -1 for all bands */
+    HCROPAC_REC_EQ,                   /**< index: band, or -1 for all bands */
+    HCROPAC_REC_COV_AVG,
+    HCROPAC_REC_ANA_LIMIT,
+    HCROPAC_REC_CH_ORDER,
+    HCROPAC_REC_NORM_TYPE,
+    HCROPAC_REC_FRAME_SIZE,
+    HCROPAC_REC_TRANSFORM_BACKEND,
+    HCROPAC_REC_LINEAR_DECODER_MODE,
+    HCROPAC_REC_ENABLE_DIFF_CORRECTION,
+    HCROPAC_REC_HRIR_PREPROC,
+    HCROPAC_REC_SCANNING_GRID_DENSITY,
+    HCROPAC_REC_ENABLE_SILENCE_GATE,
+    HCROPAC_REC_SILENCE_GATE_THRESHOLD,
+    HCROPAC_REC_SILENCE_GATE_HANGOVER,
+    HCROPAC_REC_ENABLE_BAND_SKIPPING,
+    HCROPAC_REC_BAND_SKIP_FLOOR,
+    HCROPAC_REC_ENABLE_ANALYSIS_ONLY,
+    HCROPAC_REC_REFRESH_PARAMS,       /**< hcropaclib_refreshParams(), or
+                                       *   hcropaclib_setEQfromFIR() */
+
+    HCROPAC_REC_NUM_PARAMS
+}HCROPAC_REC_PARAMS;
+
+#define HCROPAC_RECORDING_MAGIC "HCRECORD"
+#define HCROPAC_RECORDING_VERSION ( 1 )
     
     
 /* ========================================================================== */
@@ -140,6 +322,11 @@ void hcropaclib_init(void* const hCroPaC,
 /**
  * Intialises the codec variables, based on current global/user parameters
  *
+ * If the codec is already initialised, but the FIR decoding filters are out of
+ * date (see hcropaclib_getFIRDecoderRebuildPending()), then only these are
+ * rebuilt; the processing continues with the previous filters meanwhile, and
+ * switches to the new ones at the start of the next frame.
+ *
  * @param[in] hCroPaC hcropaclib handle
  */
 void hcropaclib_initCodec(void* const hCroPaC);
@@ -155,6 +342,12 @@ void hcropaclib_initCodec(void* const hCroPaC);
  * @param[in] nOutputs Number of output channels
  * @param[in] nSamples Number of samples in 'inputs'/'output' matrices
  *
+ * @note The 'inputs' and 'outputs' buffers may be the same (in-place
+ *       processing). The input is passed to the time-frequency transform
+ *       without being copied or converted, whatever its channel order and
+ *       normalisation, and the binaural output is written directly to
+ *       'outputs'.
+ *
  * @ see [1] McCormack, L., Delikaris-Manias, S. (2019). "Parametric first-order
  *           ambisonic decoding for headphones utilising the Cross-Pattern
  *           Coherence algorithm". inProc 1st EAA Spatial Audio Signal
@@ -167,6 +360,74 @@ void hcropaclib_process(void* const hCroPaC,
                         int nOutputs,
                         int nSamples);
 
+/**
+ * Same as hcropaclib_process(), but for caller-owned buffers of any layout,
+ * where sample 'n' of channel 'ch' is located at:
+ * buffer[ch*channelStride + n*sampleStride]
+ *
+ * For example, planar buffers use channelStride=nSamples and sampleStride=1,
+ * whereas interleaved buffers use channelStride=1 and sampleStride=nChannels.
+ * The input and output buffers may be the same (in-place processing).
+ *
+ * @param[in] hCroPaC          hcropaclib handle
+ * @param[in] inputs           Input buffer
+ * @param[in] inChannelStride  Distance between channels in 'inputs'
+ * @param[in] inSampleStride   Distance between samples in 'inputs'
+ * @param[in] outputs          Output buffer
+ * @param[in] outChannelStride Distance between channels in 'outputs'
+ * @param[in] outSampleStride  Distance between samples in 'outputs'
+ * @param[in] nInputs          Number of input channels
+ * @param[in] nOutputs         Number of output channels
+ * @param[in] nSamples         Number of samples per channel
+ */
+void hcropaclib_processStrided(void* const hCroPaC,
+                               const float* inputs,
+                               int inChannelStride,
+                               int inSampleStride,
+                               float* outputs,
+                               int outChannelStride,
+                               int outSampleStride,
+                               int nInputs,
+                               int nOutputs,
+                               int nSamples);
+
+/**
+ * Performs CroPaC decoding of one time-frequency frame of input Ambisonic
+ * signals to the binaural channels, bypassing the library's own forward and
+ * inverse transforms
+ *
+ * This allows hcropaclib to be chained with other time-frequency processors
+ * sharing the same transform (see hcropaclib_setTransformBackend()), without
+ * transforming back and forth between them. Both frames are in the
+ * bands x channels x time-slots layout (i.e. SAF's AFSTFT_BANDS_CH_TIME), with
+ * complex values stored as interleaved real/imaginary float pairs; so a
+ * 'float_complex***' frame allocated with malloc3d() may be passed directly.
+ *
+ * @param[in]  hCroPaC    hcropaclib handle
+ * @param[in]  inputsTF   Input frame; nBands x nInputs x (2*nTimeSlots)
+ * @param[out] outputsTF  Output frame; nBands x nOutputs x (2*nTimeSlots)
+ * @param[in]  nInputs    Number of input channels
+ * @param[in]  nOutputs   Number of output channels
+ * @param[in]  nBands     Number of bands; must equal
+ *                        hcropaclib_getNumberOfBands()
+ * @param[in]  nTimeSlots Number of time slots; must equal
+ *                        hcropaclib_getNumberOfTimeSlots()
+ *
+ * @note The input is expected in the configured channel order and
+ *       normalisation, as with hcropaclib_process(). The frame is always
+ *       processed with the filterbank linear decoder, and the silence gate is
+ *       not applied. The 'inputsTF' and 'outputsTF' frames may be the same
+ *       (in-place processing). If the dimensions do not match, or the codec is
+ *       not initialised, the output is zeroed.
+ */
+void hcropaclib_processTF(void* const hCroPaC,
+                          float*** const inputsTF,
+                          float*** const outputsTF,
+                          int nInputs,
+                          int nOutputs,
+                          int nBands,
+                          int nTimeSlots);
+
     
 /* ========================================================================== */
 /*                                Set Functions                               */
@@ -183,9 +444,49 @@ void hcropaclib_refreshParams(void* const hCroPaC);
 /**
  * Enables/Disables CroPaC processing; if disabled, then the Magnitude least-
  * squares decoder is used instead.
+ *
+ * @note Has no effect on hcropaclib_process() while the linear decoding mode is
+ *       LINEAR_DECODER_FIR, such that the processing delay never changes with
+ *       this (automatable) parameter
  */
 void hcropaclib_setEnableCroPaC(void* const hCroPaC, int newState);
+
+/**
+ * Sets the processing frame size, in samples (default=512)
+ *
+ * Supported sizes are 128 (i.e. processing per hop), 256, 512 and 1024; other
+ * values are rounded down to the nearest supported size. Smaller frames reduce
+ * the block-size latency and allow head-tracking to respond sooner, at the
+ * cost of more frequent (per-frame) DoA analysis and mixing matrix updates.
+ * The covariance averaging and mixing matrix interpolation are scaled such
+ * that their time constants remain the same. Takes effect after the codec is
+ * reinitialised.
+ */
+void hcropaclib_setFrameSize(void* const hCroPaC, int newFrameSize);
     
+/**
+ * Sets the time-frequency transform (see 'HCROPAC_TFT_BACKENDS' enum)
+ *
+ * @note All band-dependent tables are rebuilt when the codec is next
+ *       reinitialised; the number of bands and the processing delay change
+ *       accordingly. Per-band parameters (EQ, balance) are kept by band index.
+ */
+void hcropaclib_setTransformBackend(void* const hCroPaC, int newBackend);
+
+/**
+ * Sets the linear decoding mode (see 'HCROPAC_LINEAR_DECODER_MODES' enum)
+ *
+ * LINEAR_DECODER_STFT is used when CroPaC is disabled. LINEAR_DECODER_FIR is a
+ * low-latency linear-only mode: the output of hcropaclib_process() is always
+ * the linear decoding, regardless of hcropaclib_setEnableCroPaC().
+ *
+ * @note LINEAR_DECODER_FIR converts the decoder into a bank of FIR filters,
+ *       which requires the codec to be reinitialised. The processing delay
+ *       changes with the mode (the FIRs are delayed by half their length, so
+ *       that they remain causal), see hcropaclib_getProcessingDelay().
+ */
+void hcropaclib_setLinearDecoderMode(void* const hCroPaC, int newMode);
+
 /**
  * Sets the balance between direct and ambient streams (default=1) for ONE
  * specific frequency band.
@@ -203,6 +504,41 @@ void hcropaclib_setBalance(void* const hCroPaC, float newValue, int bandIdx);
  */
 void hcropaclib_setBalanceAllBands(void* const hCroPaC, float newValue);
 
+/**
+ * Sets the EQ (linear gain, default=1) for ONE specific frequency band.
+ *
+ * The EQ is applied within the decoding/mixing matrices, and therefore adds no
+ * latency or per-sample processing.
+ *
+ * @param[in] hCroPaC  hcropaclib handle
+ * @param[in] newValue New EQ gain, linear
+ * @param[in] bandIdx  Frequency band index
+ */
+void hcropaclib_setEQ(void* const hCroPaC, float newValue, int bandIdx);
+
+/**
+ * Sets the EQ (linear gain, default=1) for ALL frequency bands
+ */
+void hcropaclib_setEQAllBands(void* const hCroPaC, float newValue);
+
+/**
+ * Sets the EQ from the magnitude response of an FIR filter (e.g. a headphone
+ * compensation filter), evaluated at the centre frequency of each band.
+ *
+ * The FIR is copied, and the EQ is derived from it when the codec is next
+ * initialised (and again whenever the host sampling rate changes). The phase
+ * response of the filter is discarded.
+ *
+ * @param[in] hCroPaC hcropaclib handle
+ * @param[in] fir     FIR filter; firLen x 1
+ * @param[in] firLen  Length of the FIR filter, in samples
+ * @param[in] fir_fs  Sampling rate of the FIR filter, in Hz
+ */
+void hcropaclib_setEQfromFIR(void* const hCroPaC,
+                             const float* fir,
+                             int firLen,
+                             int fir_fs);
+
 /**
  * Sets the covariance matrix averaging coefficient.
  *
@@ -268,6 +604,20 @@ void hcropaclib_setEnableDiffCorrection(void* const hCroPaC, int newState);
 /** See #HRIR_PREPROC_OPTIONS */
 void hcropaclib_setHRIRsPreProc(void* const hCroPaC, HRIR_PREPROC_OPTIONS newState);
 
+/**
+ * Sets the density of the scanning grid used for the DoA analysis, given as
+ * the frequency of the icosahedron-based geosphere (default=12, 1442 points)
+ *
+ * Denser grids reduce the DoA quantisation error, at the cost of a more
+ * expensive power-map per time-frequency tile. Only the grid dependent tables
+ * are rebuilt (the HRIRs are not reloaded).
+ *
+ * @param[in] hCroPaC  hcropaclib handle
+ * @param[in] newValue Geosphere frequency; #HCROPAC_GRID_DENSITY_MIN_VALUE to
+ *                     #HCROPAC_GRID_DENSITY_MAX_VALUE
+ */
+void hcropaclib_setScanningGridDensity(void* const hCroPaC, int newValue);
+
 /**
  * Sets the flag to enable/disable sound-field rotation.
  */
@@ -312,6 +662,145 @@ void hcropaclib_setFlipRoll(void* const hCroPaC, int newState);
  */
 void hcropaclib_setRPYflag(void* const hCroPaC, int newState);
 
+/**
+ * Enables/Disables the silence gate (default=0).
+ *
+ * When enabled, frames whose input energy has remained below the gate
+ * threshold for longer than the hangover time bypass the analysis, mixing and
+ * time-frequency transforms entirely, and silence is output instead. The
+ * hangover is always extended by the time required to flush the filterbank and
+ * decorrelator tails (or, with LINEAR_DECODER_FIR, the FIR decoder tails), so
+ * that the gate does not truncate the output.
+ */
+void hcropaclib_setEnableSilenceGate(void* const hCroPaC, int newState);
+
+/**
+ * Sets the silence gate threshold, in dB (mean input energy per sample and
+ * channel, N3D)
+ */
+void hcropaclib_setSilenceGateThreshold(void* const hCroPaC, float newValue);
+
+/**
+ * Sets the silence gate hangover time, in miliseconds
+ */
+void hcropaclib_setSilenceGateHangover(void* const hCroPaC, float newValue);
+
+/**
+ * Enables/Disables band-sparse processing (default=0).
+ *
+ * When enabled, bands (below the analysis limit) whose instantaneous energy
+ * falls below the band floor, relative to the most energetic band of the
+ * current frame, skip the CroPaC analysis and keep their previous mixing
+ * matrices.
+ */
+void hcropaclib_setEnableBandSkipping(void* const hCroPaC, int newState);
+
+/**
+ * Enables/Disables the analysis-only mode (default=0).
+ *
+ * When enabled, only the CroPaC analysis is performed, and its results are
+ * made available via hcropaclib_getMetadata(). The linear decoding, mixing
+ * matrix solves, decorrelation and inverse transform are all skipped, and the
+ * output is zeroed. The synthesis restarts from silence once disabled again.
+ */
+void hcropaclib_setEnableAnalysisOnly(void* const hCroPaC, int newState);
+
+/**
+ * Sets the band floor, in dB relative to the most energetic band of the frame
+ */
+void hcropaclib_setBandSkipFloor(void* const hCroPaC, float newValue);
+
+/**
+ * Resets all of the processing counters (gated frames, processed frames,
+ * skipped bands)
+ */
+void hcropaclib_resetProcessingCounters(void* const hCroPaC);
+
+/**
+ * Enables/Disables the profiler, which accumulates the processing time of each
+ * stage of the processing loop (see hcropaclib_getProfile())
+ *
+ * @note Takes effect from the next frame. When disabled, the processing loop
+ *       only checks a flag per stage; the profiler may also be compiled out
+ *       entirely, by defining HCROPAC_DISABLE_PROFILING.
+ */
+void hcropaclib_setEnableProfiling(void* const hCroPaC, int newState);
+
+/**
+ * Resets the profiler statistics; takes effect from the next frame
+ */
+void hcropaclib_resetProfile(void* const hCroPaC);
+
+/**
+ * Enables/Disables the latency statistics, which time every process call (see
+ * hcropaclib_getLatencyStats())
+ *
+ * @note Takes effect from the next frame. This only reads the clock twice per
+ *       frame, and so is cheap enough to be left enabled in production. It is
+ *       compiled out along with the profiler by HCROPAC_DISABLE_PROFILING.
+ */
+void hcropaclib_setEnableLatencyStats(void* const hCroPaC, int newState);
+
+/**
+ * Sets the fraction of the frame period (frame size / sampling rate) beyond
+ * which a process call is counted as a deadline miss
+ */
+void hcropaclib_setDeadlineFraction(void* const hCroPaC, float newValue);
+
+/**
+ * Resets the latency statistics; takes effect from the next frame
+ */
+void hcropaclib_resetLatencyStats(void* const hCroPaC);
+
+/**
+ * Enables/Disables tracing, which records timestamped events for the stages of
+ * hcropaclib_initCodec() and of the processing loop, and for the codec status
+ * transitions, into a ring buffer (see hcropaclib_writeTrace())
+ *
+ * @note The ring buffer is allocated by the first call enabling tracing, so
+ *       this should not be called from the audio thread; recording itself is
+ *       lock-free and never allocates. Once full, the oldest events are
+ *       overwritten. Tracing is compiled out along with the profiler by
+ *       HCROPAC_DISABLE_PROFILING (except for the initialisation stages and
+ *       status transitions).
+ */
+void hcropaclib_setEnableTracing(void* const hCroPaC, int newState);
+
+/**
+ * Discards all of the events recorded so far
+ */
+void hcropaclib_clearTrace(void* const hCroPaC);
+
+/**
+ * Arms/Stops the recorder, which captures the input frames, the sample rate,
+ * and the timestamped parameter changes and codec initialisations, such that
+ * they may be replayed exactly (see hcropaclib_writeRecording())
+ *
+ * Once armed, the recording starts with the next call to hcropaclib_init(),
+ * which also clears the transform and FIR decoder buffers; i.e. the recording
+ * starts from a state that may be reproduced. The current parameters are
+ * recorded first, followed by every subsequent call of the set functions that
+ * affect the output.
+ *
+ * @note The recording buffer is allocated by hcropaclib_init(), and is only
+ *       freed by hcropaclib_destroy(); the processing loop only copies into
+ *       it. Recording stops once the buffer is full (see
+ *       hcropaclib_setRecordingLength()). Parameter changes are applied to the
+ *       replay before the frame during which they were made; a change made
+ *       while a frame is being processed may therefore take effect one frame
+ *       earlier or later in the replay. hcropaclib_processTF(),
+ *       hcropaclib_setEQfromFIR() (other than the EQ it results in), and
+ *       hcropaclib_setRenderMetadata() are not recorded.
+ */
+void hcropaclib_setEnableRecording(void* const hCroPaC, int newState);
+
+/**
+ * Sets the capacity of the recording buffer, in seconds of audio at the sample
+ * rate passed to hcropaclib_init() (default=30); takes effect with the next
+ * recording
+ */
+void hcropaclib_setRecordingLength(void* const hCroPaC, float newValue);
+
 
 /* ========================================================================== */
 /*                                Get Functions                               */
@@ -321,13 +810,21 @@ void hcropaclib_setRPYflag(void* const hCroPaC, int newState);
  * Returns the processing framesize (i.e., number of samples processed with
  * every _process() call )
  */
-int hcropaclib_getFrameSize(void);
+int hcropaclib_getFrameSize(void* const hCroPaC);
 
 /**
  * Returns current codec status (see #_HCROPAC_CODEC_STATUS enum)
  */
 HCROPAC_CODEC_STATUS hcropaclib_getCodecStatus(void* const hCroPaC);
 
+/**
+ * Returns 1 if the FIR decoding filters are out of date (e.g. after
+ * hcropaclib_setEQ(), or a change of input format, in LINEAR_DECODER_FIR mode),
+ * while the codec remains initialised. hcropaclib_initCodec() should then be
+ * called from a background thread, to rebuild them; 0: not required
+ */
+int hcropaclib_getFIRDecoderRebuildPending(void* const hCroPaC);
+
 /**
  * (Optional) Returns current intialisation/processing progress, between 0..1
  *  - 0: intialisation/processing has started
@@ -349,6 +846,16 @@ void hcropaclib_getProgressBarText(void* const hCroPaC, char* text);
  */
 int hcropaclib_getEnableCroPaC(void* const hCroPaC);
 
+/**
+ * Returns the time-frequency transform (see 'HCROPAC_TFT_BACKENDS' enum)
+ */
+int hcropaclib_getTransformBackend(void* const hCroPaC);
+
+/**
+ * Returns the linear decoding mode (see 'HCROPAC_LINEAR_DECODER_MODES' enum)
+ */
+int hcropaclib_getLinearDecoderMode(void* const hCroPaC);
+
 /**
  * Returns the balance between direct and ambient streams (default=1, 50%/50%)
  * for ONE specific frequency band.
@@ -374,6 +881,29 @@ void hcropaclib_getBalanceHandle(void* const hCroPaC,
                                   float** pX_vector,
                                   float** pY_values,
                                   int* pNpoints);
+
+/**
+ * Returns the EQ (linear gain, default=1) for ONE specific frequency band
+ */
+float hcropaclib_getEQ(void* const hCroPaC, int bandIdx);
+
+/**
+ * Returns the EQ (linear gain, default=1) for the FIRST frequency band
+ */
+float hcropaclib_getEQAllBands(void* const hCroPaC);
+
+/**
+ * Returns a handle for the EQ (linear gain, default=1) for ALL frequency bands
+ *
+ * @param[in]  hCroPaC   hcropaclib handle
+ * @param[out] pX_vector (&) frequency vector; pNpoints x 1
+ * @param[out] pY_values (&) EQ values per frequency; pNpoints x 1
+ * @param[out] pNpoints  (&) number of frequencies/EQ values
+ */
+void hcropaclib_getEQHandle(void* const hCroPaC,
+                            float** pX_vector,
+                            float** pY_values,
+                            int* pNpoints);
     
 /**
  * Returns the covariance matrix averaging coefficient.
@@ -388,6 +918,30 @@ float hcropaclib_getCovAvg(void* const hCroPaC);
  */
 float hcropaclib_getAnaLimit(void* const hCroPaC);
 
+/**
+ * Returns the density of the scanning grid, given as the frequency of the
+ * icosahedron-based geosphere
+ */
+int hcropaclib_getScanningGridDensity(void* const hCroPaC);
+
+/**
+ * Returns the number of directions in the current scanning grid (0 if the
+ * codec is not yet initialised)
+ */
+int hcropaclib_getNumScanningGridDirs(void* const hCroPaC);
+
+/**
+ * Returns the worst-case DoA quantisation error of the current scanning grid,
+ * in degrees
+ */
+float hcropaclib_getScanningGridMaxError(void* const hCroPaC);
+
+/**
+ * Returns the mean DoA quantisation error of the current scanning grid, in
+ * degrees
+ */
+float hcropaclib_getScanningGridMeanError(void* const hCroPaC);
+
 /**
  * Returns the value of a flag used to dictate whether the default HRIRs in the
  * Spatial_Audio_Framework should be used, or a custom HRIR set loaded via a
@@ -440,7 +994,13 @@ int hcropaclib_getNumEars(void);
 /**
  * Returns the number of frequency bands employed by hcropaclib
  */
-int hcropaclib_getNumberOfBands(void);
+int hcropaclib_getNumberOfBands(void* const hCroPaC);
+
+/**
+ * Returns the number of time slots per processing frame (i.e., the frame size
+ * divided by the hop size)
+ */
+int hcropaclib_getNumberOfTimeSlots(void* const hCroPaC);
 
 /*
  *
@@ -493,6 +1053,236 @@ int hcropaclib_getFlipRoll(void* const hCroPaC);
  */
 int hcropaclib_getRPYflag(void* const hCroPaC);
 
+/**
+ * Returns the flag value which dictates whether the silence gate is enabled (1)
+ * or disabled (0)
+ */
+int hcropaclib_getEnableSilenceGate(void* const hCroPaC);
+
+/**
+ * Returns the silence gate threshold, in dB
+ */
+float hcropaclib_getSilenceGateThreshold(void* const hCroPaC);
+
+/**
+ * Returns the silence gate hangover time, in miliseconds
+ */
+float hcropaclib_getSilenceGateHangover(void* const hCroPaC);
+
+/**
+ * Returns the number of frames that were skipped by the silence gate, since the
+ * last call to hcropaclib_resetProcessingCounters()
+ */
+int hcropaclib_getNumGatedFrames(void* const hCroPaC);
+
+/**
+ * Returns the number of frames that were passed to the processing loop, since
+ * the last call to hcropaclib_resetProcessingCounters()
+ */
+int hcropaclib_getNumProcessedFrames(void* const hCroPaC);
+
+/**
+ * Returns the flag value which dictates whether band-sparse processing is
+ * enabled (1) or disabled (0)
+ */
+int hcropaclib_getEnableBandSkipping(void* const hCroPaC);
+
+/**
+ * Returns the flag value which dictates whether the analysis-only mode is
+ * enabled (1) or disabled (0)
+ */
+int hcropaclib_getEnableAnalysisOnly(void* const hCroPaC);
+
+/**
+ * Returns the CroPaC analysis metadata of the most recently processed frame
+ * (see 'hcropaclib_metadata'); filled in every frame, regardless of the mode
+ *
+ * @note The metadata is overwritten by the next process call, so it should be
+ *       read from the processing thread, in between process calls.
+ */
+const hcropaclib_metadata* hcropaclib_getMetadata(void* const hCroPaC);
+
+/**
+ * Serialises the CroPaC analysis metadata of the most recently processed frame
+ * into a compact binary frame, for transmission alongside the FOA signals
+ *
+ * Together with hcropaclib_setRenderMetadata(), this splits the decoder into an
+ * encoder (typically in analysis-only mode) and any number of renderers, which
+ * then skip the power-map scan. The frame comprises an 8 byte header:
+ * 'H','C','P','M', version, nTimeSlots, nBands, nAnalysedBands; followed by
+ * 3 bytes per analysed band and time slot (band-major): the azimuth
+ * (360/256 degree steps), elevation (180/254 degree steps; 255: band skipped)
+ * and CroPaC gain (1/255 steps).
+ *
+ * @param[in]  hCroPaC    hcropaclib handle
+ * @param[out] buffer     Metadata frame; at most HCROPAC_METADATA_MAX_BYTES
+ * @param[in]  bufferSize Size of 'buffer', in bytes
+ * @returns Number of bytes written, or 0 if 'buffer' is too small
+ */
+int hcropaclib_encodeMetadata(void* const hCroPaC,
+                              unsigned char* buffer,
+                              int bufferSize);
+
+/**
+ * Passes a metadata frame, produced by hcropaclib_encodeMetadata(), to be used
+ * by the next processed frame in place of the CroPaC analysis
+ *
+ * The directions and CroPaC gains are taken from the metadata, while the
+ * covariance matrices and mixing matrices are derived as usual. The scene
+ * rotation is applied to the transmitted directions, so the encoder should
+ * operate without rotation. Bands above those analysed by the encoder are
+ * treated as though they were above the analysis limit.
+ *
+ * @param[in] hCroPaC hcropaclib handle
+ * @param[in] buffer  Metadata frame
+ * @param[in] nBytes  Size of the metadata frame, in bytes
+ * @returns 1 if the frame was accepted, or 0 if it is malformed or does not
+ *          match the current transform and frame size
+ *
+ * @note Must be called from the processing thread, before the process call of
+ *       the frame it belongs to.
+ */
+int hcropaclib_setRenderMetadata(void* const hCroPaC,
+                                 const unsigned char* buffer,
+                                 int nBytes);
+
+/**
+ * Returns the band floor, in dB relative to the most energetic band
+ */
+float hcropaclib_getBandSkipFloor(void* const hCroPaC);
+
+/**
+ * Returns the fraction of bands (below the analysis limit) that skipped the
+ * CroPaC analysis, since the last call to hcropaclib_resetProcessingCounters()
+ * (0: none were skipped, 1: all were skipped)
+ */
+float hcropaclib_getBandSkipRatio(void* const hCroPaC);
+
+/**
+ * Returns the fraction of analysed time-frequency tiles for which the CroPaC
+ * gain was zero (i.e. entirely diffuse), since the last call to
+ * hcropaclib_resetProcessingCounters()
+ */
+float hcropaclib_getDiffuseSlotRatio(void* const hCroPaC);
+
+/**
+ * Returns the fraction of analysed bands for which the CroPaC gain was zero for
+ * all time slots of the frame, since the last call to
+ * hcropaclib_resetProcessingCounters()
+ */
+float hcropaclib_getDiffuseBandRatio(void* const hCroPaC);
+
+/**
+ * Returns 1: if the profiler is enabled, 0: if disabled
+ */
+int hcropaclib_getEnableProfiling(void* const hCroPaC);
+
+/**
+ * Returns the processing time statistics since the profiler was last reset
+ *
+ * May be called from any thread while processing. The statistics are published
+ * after every profiled frame, one value at a time, and so the values of a
+ * single call may straddle two consecutive frames.
+ *
+ * @param[in]  hCroPaC hcropaclib handle
+ * @param[out] profile Processing time statistics
+ */
+void hcropaclib_getProfile(void* const hCroPaC,
+                           hcropaclib_profile* profile);
+
+/**
+ * Returns the name of a stage of the processing loop (see
+ * 'HCROPAC_PROFILE_STAGES' enum)
+ */
+const char* hcropaclib_getProfileStageName(int stage);
+
+/**
+ * Returns 1: if the latency statistics are enabled, 0: if disabled
+ */
+int hcropaclib_getEnableLatencyStats(void* const hCroPaC);
+
+/**
+ * Returns the fraction of the frame period beyond which a process call is
+ * counted as a deadline miss
+ */
+float hcropaclib_getDeadlineFraction(void* const hCroPaC);
+
+/**
+ * Returns the processing time distribution of the process calls since the
+ * latency statistics were last reset
+ *
+ * May be called from any thread while processing; although the values of a
+ * single call may straddle two consecutive frames.
+ *
+ * @param[in]  hCroPaC hcropaclib handle
+ * @param[out] stats   Processing time distribution
+ */
+void hcropaclib_getLatencyStats(void* const hCroPaC,
+                                hcropaclib_latency* stats);
+
+/**
+ * Returns a percentile of the processing time of the process calls since the
+ * latency statistics were last reset, in microseconds (see
+ * 'hcropaclib_latency' struct)
+ *
+ * @param[in] hCroPaC    hcropaclib handle
+ * @param[in] percentile Percentile, 0..100
+ * @returns Processing time, microseconds; 0 if no calls have been timed
+ */
+float hcropaclib_getLatencyPercentile(void* const hCroPaC,
+                                      float percentile);
+
+/**
+ * Returns 1: if tracing is enabled, 0: if disabled
+ */
+int hcropaclib_getEnableTracing(void* const hCroPaC);
+
+/**
+ * Writes the recorded events as a Chrome trace (JSON), which may be opened
+ * with chrome://tracing or https://ui.perfetto.dev
+ *
+ * Events are placed on one track per thread of origin: the processing loop,
+ * the codec initialisation, and the codec status transitions. Should be
+ * called once processing has stopped, or tracing has been disabled, as events
+ * recorded during the call may otherwise be written partially.
+ *
+ * @param[in] hCroPaC hcropaclib handle
+ * @param[in] path    File path to write to
+ * @returns Number of events written, or -1 if the file could not be written
+ */
+int hcropaclib_writeTrace(void* const hCroPaC,
+                          const char* path);
+
+/** Returns the state of the recorder (see 'HCROPAC_RECORDER_STATES' enum) */
+HCROPAC_RECORDER_STATES hcropaclib_getRecorderState(void* const hCroPaC);
+
+/** Returns the capacity of the recording buffer, in seconds */
+float hcropaclib_getRecordingLength(void* const hCroPaC);
+
+/**
+ * Writes the recording to a compact binary file, for replaying with the
+ * hcropaclib_replay benchmark. Should be called once recording has stopped.
+ *
+ * The file is in the byte order of the machine that wrote it, with no padding:
+ *  - header: HCROPAC_RECORDING_MAGIC (8 chars), then the int32 version,
+ *    sample rate, number of paths, number of events, number of frames, and
+ *    1 if recording stopped as the buffer was full
+ *  - paths: int32 length, followed by that many chars (no terminator)
+ *  - events: int32 frame (the event applies before this frame), int32 param
+ *    (see 'HCROPAC_REC_PARAMS' enum), int32 index, float32 value, float64
+ *    time since the start of the recording, microseconds
+ *  - frames: float64 time, microseconds, int32 nInputs, nOutputs, nSamples,
+ *    uint64 output hash (64-bit FNV-1a over the bytes of the first
+ *    min(nOutputs,2) output channels, in turn), followed by the nInputs x
+ *    nSamples float32 input signals
+ *
+ * @param[in] hCroPaC hcropaclib handle
+ * @param[in] path    File path to write to
+ * @returns Number of frames written, or -1 if the file could not be written
+ */
+int hcropaclib_writeRecording(void* const hCroPaC,
+                              const char* path);
+
 /**
  * Returns the number of directions in the currently used HRIR set
  */
@@ -519,10 +1309,23 @@ int hcropaclib_getHRIRsamplerate(void* const hCroPaC);
 int hcropaclib_getDAWsamplerate(void* const hCroPaC);
 
 /**
- * Returns the processing delay in samples; may be used for delay compensation
- * features
+ * Returns the processing delay in samples of the current processing mode; may
+ * be used for delay compensation features
+ *
+ * @note This is the delay of the time-frequency transform or, when the linear
+ *       decoding mode is LINEAR_DECODER_FIR, the modelling delay of the FIR
+ *       decoder (half its length, which depends on the HRIR length; zero until
+ *       it is first built by hcropaclib_initCodec()). It therefore only changes
+ *       with parameters that require the codec to be reinitialised.
+ */
+int hcropaclib_getProcessingDelay(void* const hCroPaC);
+
+/**
+ * Returns 1 if this build of hcropaclib renders the residual (decorrelated)
+ * stream, 0: if it was built without it (see the
+ * HCROPAC_ENABLE_RESIDUAL_STREAM build option)
  */
-int hcropaclib_getProcessingDelay(void);
+int hcropaclib_getResidualStreamEnabled(void);
     
     
 #ifdef __cplusplus
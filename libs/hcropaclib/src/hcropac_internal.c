@@ -44,6 +44,14 @@
  */
 
 #include "hcropac_internal.h"
+#ifdef HCROPAC_C11_ATOMICS
+# include <stdatomic.h>
+#endif
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <time.h>
+#endif
 
 void hcropaclib_setCodecStatus(void* const hCroPaC, HCROPAC_CODEC_STATUS newStatus)
 {
@@ -54,37 +62,750 @@ void hcropaclib_setCodecStatus(void* const hCroPaC, HCROPAC_CODEC_STATUS newStat
             SAF_SLEEP(10);
     }
     pData->codecStatus = newStatus;
+    hcropaclib_traceEvent(hCroPaC, TRACE_TRACK_STATUS, newStatus == CODEC_STATUS_INITIALISED ? "codec_initialised" :
+                          newStatus == CODEC_STATUS_INITIALISING ? "codec_initialising" : "codec_not_initialised", hcropaclib_profileClock_us(), -1.0f);
+}
+
+char* hcropaclib_exchangePath(_Atomic_HCROPAC_PATH* path, char* newPath)
+{
+#ifdef HCROPAC_C11_ATOMICS
+    return atomic_exchange(path, newPath);
+#else
+    char* oldPath;
+    oldPath = *path;
+    *path = newPath;
+    return oldPath;
+#endif
+}
+ 
+void hcropaclib_getInputConversion
+(
+    HCROPAC_CH_ORDER chOrdering,
+    HCROPAC_NORM_TYPES norm,
+    int perm[NUM_SH_SIGNALS],
+    float gain[NUM_SH_SIGNALS]
+)
+{
+    int i;
+    
+    /* channel order convention */
+    for(i=0; i<NUM_SH_SIGNALS; i++)
+        perm[i] = i;
+    if(chOrdering == CH_FUMA){
+        /* FuMa: W X Y Z; ACN: W Y Z X */
+        perm[1] = 2;
+        perm[2] = 3;
+        perm[3] = 1;
+    }
+    
+    /* normalisation scheme (first-order only) */
+    for(i=0; i<NUM_SH_SIGNALS; i++)
+        gain[i] = 1.0f;
+    switch(norm){
+        case NORM_N3D:  /* already in N3D, do nothing */
+            break;
+        case NORM_SN3D: /* convert to N3D */
+            for(i=1; i<NUM_SH_SIGNALS; i++)
+                gain[i] = sqrtf(3.0f);
+            break;
+        case NORM_FUMA: /* SN3D, but with the omni attenuated by 3dB */
+            gain[0] = sqrtf(2.0f);
+            for(i=1; i<NUM_SH_SIGNALS; i++)
+                gain[i] = sqrtf(3.0f);
+            break;
+    }
+}
+
+void hcropaclib_initInputFormat(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    codecPars* pars = pData->pars;
+    int i, j, band, dir, *perm;
+    float* gain;
+    
+    perm = pData->fmtPerm;
+    gain = pData->fmtGain;
+    hcropaclib_getInputConversion(pData->chOrdering, pData->norm, perm, gain);
+    
+    /* ACN/N3D channel j is gain[j] times input channel perm[j]; so the columns of anything applied to the ACN/N3D
+     * signals are scaled and moved to the corresponding input channel */
+    for(band=0; band<pData->nBands; band++)
+        for(i=0; i<NUM_EARS; i++)
+            for(j=0; j<NUM_SH_SIGNALS; j++)
+                pars->M_dec_fmt[band][i][perm[j]] = crmulf(pars->M_dec[band][i][j], gain[j]);
+    for(j=0; j<NUM_SH_SIGNALS; j++)
+        for(dir=0; dir<pars->grid_nDirs; dir++)
+            pars->Y_grid_fmt[perm[j]*(pars->grid_nDirs) + dir] = gain[j] * pars->Y_grid[j*(pars->grid_nDirs) + dir];
+    for(dir=0; dir<pars->grid_nDirs; dir++)
+        for(i=0; i<NUM_M_ROT_ROWS; i++)
+            for(j=0; j<NUM_SH_SIGNALS; j++)
+                pars->M_rot_fmt[dir*NUM_M_ROT_ROWS*NUM_SH_SIGNALS + i*NUM_SH_SIGNALS + perm[j]] =
+                    gain[j] * pars->M_rot[dir*NUM_M_ROT_ROWS*NUM_SH_SIGNALS + i*NUM_SH_SIGNALS + j];
+    
+    /* energies are taken over the N3D signals; the CroPaC normalisation additionally scales the dipoles by 1/sqrt(3) */
+    for(j=0; j<NUM_SH_SIGNALS; j++){
+        pData->energyWeights[perm[j]] = gain[j]*gain[j];
+        pData->cropacEnergyWeights[perm[j]] = j==0 ? gain[j]*gain[j] : gain[j]*gain[j]/3.0f;
+    }
+    pData->recalc_M_rotFLAG = 1;
+    pData->recalc_EQFLAG = 1;
+}
+
+void hcropaclib_tftCreate(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    
+    switch(pData->tftBackend){
+        case TFT_AFSTFT_HYBRID:
+            afSTFT_create(&(pData->hSTFT), NUM_SH_SIGNALS, NUM_EARS, HOP_SIZE, 0, 1, AFSTFT_BANDS_CH_TIME);
+            pData->nBands = HYBRID_BANDS;
+            break;
+        case TFT_STFT:
+            saf_stft_create(&(pData->hSTFT), STFT_WIN_SIZE, HOP_SIZE, NUM_SH_SIGNALS, NUM_EARS, SAF_STFT_BANDS_CH_TIME);
+            pData->nBands = STFT_BANDS;
+            break;
+    }
+}
+
+void hcropaclib_tftDestroy(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    
+    if(pData->hSTFT == NULL)
+        return;
+    switch(pData->tftBackend){
+        case TFT_AFSTFT_HYBRID: afSTFT_destroy(&(pData->hSTFT));    break;
+        case TFT_STFT:          saf_stft_destroy(&(pData->hSTFT)); break;
+    }
+}
+
+void hcropaclib_tftForward
+(
+    void* const hCroPaC,
+    float** inTD,
+    int frameSize,
+    float_complex*** outTF
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    
+    switch(pData->tftBackend){
+        case TFT_AFSTFT_HYBRID: afSTFT_forward(pData->hSTFT, inTD, frameSize, outTF);   break;
+        case TFT_STFT:          saf_stft_forward(pData->hSTFT, inTD, frameSize, outTF); break;
+    }
+}
+
+void hcropaclib_tftBackward
+(
+    void* const hCroPaC,
+    float_complex*** inTF,
+    int frameSize,
+    float** outTD
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    
+    switch(pData->tftBackend){
+        case TFT_AFSTFT_HYBRID: afSTFT_backward(pData->hSTFT, inTF, frameSize, outTD);   break;
+        case TFT_STFT:          saf_stft_backward(pData->hSTFT, inTF, frameSize, outTD); break;
+    }
+}
+
+void hcropaclib_tftClearBuffers(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    
+    switch(pData->tftBackend){
+        case TFT_AFSTFT_HYBRID: afSTFT_clearBuffers(pData->hSTFT);   break;
+        case TFT_STFT:          saf_stft_flushBuffers(pData->hSTFT); break;
+    }
+}
+
+void hcropaclib_tftGetCentreFreqs
+(
+    void* const hCroPaC,
+    float fs,
+    float* freqVector
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    
+    switch(pData->tftBackend){
+        case TFT_AFSTFT_HYBRID: afSTFT_getCentreFreqs(pData->hSTFT, fs, HYBRID_BANDS, freqVector); break;
+        case TFT_STFT:          getUniformFreqVector(STFT_WIN_SIZE, fs, freqVector);              break;
+    }
+}
+
+int hcropaclib_tftGetDelay(HCROPAC_TFT_BACKENDS tftBackend)
+{
+    switch(tftBackend){
+        default:
+        case TFT_AFSTFT_HYBRID: return AFSTFT_DELAY;
+        case TFT_STFT:          return STFT_DELAY;
+    }
+}
+
+void hcropaclib_tftHRIRs2HRTFs
+(
+    void* const hCroPaC,
+    float* hrirs,
+    int N_dirs,
+    int hrir_len,
+    float_complex* hrtfs
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    int band, fftSize, decimation;
+    float_complex* hrtfs_fft;
+    
+    switch(pData->tftBackend){
+        case TFT_AFSTFT_HYBRID:
+            HRIRs2HRTFs_afSTFT(hrirs, N_dirs, hrir_len, HOP_SIZE, 0, 1, hrtfs);
+            break;
+        case TFT_STFT:
+            /* the full HRIRs are transformed, and then sampled at the STFT bin frequencies */
+            fftSize = SAF_MAX(STFT_WIN_SIZE, nextpow2(hrir_len));
+            decimation = fftSize/STFT_WIN_SIZE;
+            hrtfs_fft = malloc1d((fftSize/2+1)*NUM_EARS*N_dirs*sizeof(float_complex));
+            HRIRs2HRTFs(hrirs, N_dirs, hrir_len, fftSize, hrtfs_fft);
+            for(band=0; band<STFT_BANDS; band++)
+                memcpy(&hrtfs[band*NUM_EARS*N_dirs], &hrtfs_fft[band*decimation*NUM_EARS*N_dirs], NUM_EARS*N_dirs*sizeof(float_complex));
+            free(hrtfs_fft);
+            break;
+    }
+}
+
+void hcropaclib_initFrequencies(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    
+    hcropaclib_tftGetCentreFreqs(hCroPaC, (float)pData->fs, pData->freqVector);
+    for(pData->nAudibleBands = 0; pData->nAudibleBands < pData->nBands; pData->nAudibleBands++)
+        if(pData->freqVector[pData->nAudibleBands] > MAX_AUDIBLE_FREQ)
+            break;
+}
+
+void hcropaclib_resetProcessingState(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    
+    memset(pData->Cx, 0, MAX_NUM_BANDS*NUM_SH_SIGNALS*NUM_SH_SIGNALS*sizeof(float_complex));
+    memset(pData->Cy, 0, MAX_NUM_BANDS*NUM_EARS*NUM_EARS*sizeof(float_complex));
+    memset(pData->Cambi, 0, MAX_NUM_BANDS*NUM_EARS*NUM_EARS*sizeof(float_complex));
+    memset(pData->current_M, 0, MAX_NUM_BANDS*NUM_EARS*NUM_EARS*sizeof(float_complex));
+#ifdef ENABLE_RESIDUAL_STREAM
+    memset(pData->current_Mr, 0, MAX_NUM_BANDS*NUM_EARS*NUM_EARS*sizeof(float));
+    memset(pData->transientDetector1, 0, MAX_NUM_BANDS*NUM_EARS*sizeof(float));
+    memset(pData->transientDetector2, 0, MAX_NUM_BANDS*NUM_EARS*sizeof(float));
+    memset(pData->circBufferFrames, 0, MAX_NUM_BANDS*NUM_EARS*(NUM_DECOR_SLOTS+MAX_TIME_SLOTS)*sizeof(float_complex));
+#endif
+}
+
+void hcropaclib_updateAnalysisOnlyState
+(
+    void* const hCroPaC,
+    int analysisOnly,
+    int clearTFT
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    
+    if(pData->analysisActive && !analysisOnly){
+        hcropaclib_resetProcessingState(hCroPaC);
+        if(clearTFT)
+            hcropaclib_tftClearBuffers(hCroPaC); /* start again from silence */
+    }
+    pData->analysisActive = analysisOnly;
+}
+
+void hcropaclib_calcRotationMatrix(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    int i, j;
+    float Rxyz[3][3];
+    const int yzx[3] = {1, 2, 0}; /* ACN order of the dipoles */
+    
+    /* first-order real SH rotation; the dipoles are rotated as the (y,z,x) axes. Built directly, rather than with
+     * getSHrotMtxReal(), as that allocates its workspace and this is called from the processing loop */
+    yawPitchRoll2Rzyx(pData->yaw, pData->pitch, pData->roll, pData->useRollPitchYawFlag, Rxyz);
+    memset(pData->M_rot_acn, 0, NUM_SH_SIGNALS*NUM_SH_SIGNALS*sizeof(float));
+    pData->M_rot_acn[0][0] = 1.0f;
+    for(i=0; i<3; i++)
+        for(j=0; j<3; j++)
+            pData->M_rot_acn[i+1][j+1] = Rxyz[yzx[i]][yzx[j]];
+    
+    /* R is applied to the ACN/N3D signals; conjugate it with the input conversion */
+    for(i=0; i<NUM_SH_SIGNALS; i++)
+        for(j=0; j<NUM_SH_SIGNALS; j++)
+            pData->M_rot[pData->fmtPerm[i]][pData->fmtPerm[j]] = pData->M_rot_acn[i][j] * pData->fmtGain[j]/pData->fmtGain[i];
+}
+
+void hcropaclib_getSteeringVectors
+(
+    void* const hCroPaC,
+    int applyRotation,
+    float* azi_deg,
+    float* elev_deg,
+    float* y,
+    float* y_fmt
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    int i, j;
+    float azi, elev, y_rot[NUM_SH_SIGNALS];
+    
+    /* first-order real SHs, ACN/N3D */
+    azi = *azi_deg * SAF_PI/180.0f;
+    elev = *elev_deg * SAF_PI/180.0f;
+    y[0] = 1.0f;
+    y[1] = sqrtf(3.0f) * sinf(azi) * cosf(elev);
+    y[2] = sqrtf(3.0f) * sinf(elev);
+    y[3] = sqrtf(3.0f) * cosf(azi) * cosf(elev);
+    
+    /* the dipoles of the rotated steering vector give the rotated direction */
+    if(applyRotation){
+        for(i=0; i<NUM_SH_SIGNALS; i++){
+            y_rot[i] = 0.0f;
+            for(j=0; j<NUM_SH_SIGNALS; j++)
+                y_rot[i] += pData->M_rot_acn[i][j] * y[j];
+        }
+        memcpy(y, y_rot, NUM_SH_SIGNALS*sizeof(float));
+        *azi_deg = atan2f(y[1], y[3]) * 180.0f/SAF_PI;
+        *elev_deg = asinf(SAF_CLAMP(y[2]/sqrtf(3.0f), -1.0f, 1.0f)) * 180.0f/SAF_PI;
+    }
+    for(j=0; j<NUM_SH_SIGNALS; j++)
+        y_fmt[pData->fmtPerm[j]] = pData->fmtGain[j] * y[j];
+}
+
+void hcropaclib_requestFIRDecoderRebuild(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    pData->reinitFIRFLAG = 1;
+}
+
+void hcropaclib_initFIRDecoder(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    codecPars* pars = pData->pars;
+    int i, j, k, n, band, fftSize, nBins, perm[NUM_SH_SIGNALS];
+    float gain[NUM_SH_SIGNALS], frac, eq, taper;
+    float *freqVector, *weights, *filters, *win;
+    float_complex *hrtfs, *decMtx, *H;
+    void* hFFT;
+    
+    /* HRTFs at uniformly spaced frequencies, with the same pre-processing as the filterbank HRTFs */
+    fftSize = 2*nextpow2(pars->hrir_runtime_len);
+    nBins = fftSize/2+1;
+    freqVector = malloc1d(nBins*sizeof(float));
+    getUniformFreqVector(fftSize, (float)pData->fs, freqVector);
+    hrtfs = malloc1d(nBins*NUM_EARS*(pars->N_hrir_dirs)*sizeof(float_complex));
+    HRIRs2HRTFs(pars->hrirs_runtime, pars->N_hrir_dirs, pars->hrir_runtime_len, fftSize, hrtfs);
+    diffuseFieldEqualiseHRTFs(pars->N_hrir_dirs, pars->itds_s, freqVector, nBins, NULL,
+                              pData->hrirProcMode == HRIR_PREPROC_ALL || pData->hrirProcMode == HRIR_PREPROC_EQ ? 1 : 0,
+                              pData->hrirProcMode == HRIR_PREPROC_ALL || pData->hrirProcMode == HRIR_PREPROC_PHASE ? 1 : 0,
+                              hrtfs);
+    
+    /* MagLS decoder per frequency */
+    if(pars->N_hrir_dirs<1800){
+        weights = malloc1d(pars->N_hrir_dirs*sizeof(float));
+        getVoronoiWeights(pars->hrir_dirs_deg, pars->N_hrir_dirs, 0, weights);
+    }
+    else
+        weights = NULL;
+    decMtx = malloc1d(nBins*NUM_EARS*NUM_SH_SIGNALS*sizeof(float_complex));
+    getBinauralAmbiDecoderMtx(hrtfs, pars->hrir_dirs_deg, pars->N_hrir_dirs, nBins, BINAURAL_DECODER_MAGLS, SH_ORDER, freqVector, pars->itds_s, weights, pData->diffCorrection, 1, decMtx);
+    
+    /* fold in the input format and the EQ (interpolated between the band centre frequencies), and convert to FIRs;
+     * the MagLS decoder (and the linear-phase ITDs of the pre-processed HRTFs) are centred on t=0, so they are delayed
+     * by half the filter length (a sign flip of every other bin) to keep the negative-time half from wrapping around */
+    hcropaclib_getInputConversion(pData->chOrdering, pData->norm, perm, gain);
+    H = malloc1d(nBins*sizeof(float_complex));
+    filters = malloc1d(NUM_EARS*NUM_SH_SIGNALS*fftSize*sizeof(float));
+    saf_rfft_create(&hFFT, fftSize);
+    for(i=0; i<NUM_EARS; i++){
+        for(j=0; j<NUM_SH_SIGNALS; j++){
+            for(k=0, band=0; k<nBins; k++){
+                while(band < pData->nBands-2 && pData->freqVector[band+1] < freqVector[k])
+                    band++;
+                frac = SAF_CLAMP((freqVector[k]-pData->freqVector[band])/(pData->freqVector[band+1]-pData->freqVector[band]), 0.0f, 1.0f);
+                eq = (1.0f-frac)*pData->EQ[band] + frac*pData->EQ[band+1];
+                H[k] = crmulf(decMtx[k*NUM_EARS*NUM_SH_SIGNALS + i*NUM_SH_SIGNALS + j], gain[j]*eq*(k % 2 ? -1.0f : 1.0f));
+            }
+            saf_rfft_backward(hFFT, H, &filters[i*NUM_SH_SIGNALS*fftSize + perm[j]*fftSize]);
+        }
+    }
+    
+    /* taper the outer quarter of the filters at either end (Tukey window), which holds little more than the
+     * time-aliasing of the frequency-domain design */
+    win = malloc1d(fftSize*sizeof(float));
+    for(n=0; n<fftSize; n++){
+        taper = (float)SAF_MIN(n, fftSize-1-n)/(float)(fftSize/4);
+        win[n] = taper < 1.0f ? 0.5f - 0.5f*cosf(SAF_PI*taper) : 1.0f;
+    }
+    for(i=0; i<NUM_EARS*NUM_SH_SIGNALS; i++)
+        for(n=0; n<fftSize; n++)
+            filters[i*fftSize+n] *= win[n];
+    
+    /* new convolver (this also frees the one that the previous hand-over replaced) */
+    if(pData->hMatrixConv_new != NULL)
+        saf_matrixConv_destroy(&(pData->hMatrixConv_new));
+    saf_matrixConv_create(&(pData->hMatrixConv_new), pData->frameSize, filters, fftSize, NUM_SH_SIGNALS, NUM_EARS, 1);
+    pData->firLength = fftSize;
+    
+    saf_rfft_destroy(&hFFT);
+    free(freqVector);
+    free(hrtfs);
+    free(weights);
+    free(decMtx);
+    free(H);
+    free(filters);
+    free(win);
+}
+
+void hcropaclib_rebuildFIRDecoder(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    
+    pData->firRebuildingFLAG = 1; /* hcropaclib_initCodec() waits for this, before a full initialisation */
+    if(pData->codecStatus == CODEC_STATUS_INITIALISED && !pData->firSwapFLAG){
+        pData->reinitFIRFLAG = 0; /* changes made from here on request another rebuild */
+        hcropaclib_initFIRDecoder(hCroPaC);
+        hcropaclib_recordParam(hCroPaC, HCROPAC_REC_INIT_CODEC, -1, 0.0f); /* the replay rebuilds the filters before the same frame */
+        pData->firSwapFLAG = 1;
+    }
+    pData->firRebuildingFLAG = 0;
+}
+
+void hcropaclib_initEQDecoder(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    codecPars* pars = pData->pars;
+    int i, j, band;
+    float eq;
+    
+    for(band=0; band<pData->nBands; band++){
+        eq = pData->EQ[band];
+        for(i=0; i<NUM_EARS; i++)
+            for(j=0; j<NUM_SH_SIGNALS; j++)
+                pars->M_dec_eq_fmt[band][i][j] = crmulf(pars->M_dec_fmt[band][i][j], eq);
+    }
+}
+
+void hcropaclib_getEQfromFIR
+(
+    const float* fir,
+    int firLen,
+    int fir_fs,
+    const float* freqVector,
+    int nBands,
+    float* eq
+)
+{
+    int band, n;
+    double omega, re, im;
+    
+    for(band=0; band<nBands; band++){
+        /* bands above the Nyquist frequency of the FIR take its response at Nyquist */
+        omega = 2.0*SAF_PI*(double)SAF_MIN(freqVector[band], (float)fir_fs/2.0f)/(double)fir_fs;
+        re = im = 0.0;
+        for(n=0; n<firLen; n++){
+            re += (double)fir[n]*cos(omega*(double)n);
+            im -= (double)fir[n]*sin(omega*(double)n);
+        }
+        eq[band] = (float)sqrt(re*re + im*im);
+    }
+}
+
+void hcropaclib_zeroOutputs
+(
+    float* const* outputs,
+    int outSampleStride,
+    int nOutputs,
+    int nSamples
+)
+{
+    int ch, n;
+    
+    for(ch=0; ch<nOutputs; ch++){
+        if(outSampleStride == 1)
+            memset(outputs[ch], 0, nSamples*sizeof(float));
+        else
+            for(n=0; n<nSamples; n++)
+                outputs[ch][n*outSampleStride] = 0.0f;
+    }
+}
+
+void hcropaclib_loadHRIRs(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    codecPars* pars = pData->pars;
+    int i;
+#ifdef SAF_ENABLE_SOFA_READER_MODULE
+    SAF_SOFA_ERROR_CODES error;
+    saf_sofa_container sofa;
+#endif
+    
+    /* load sofa file or load default hrir data */
+#ifdef SAF_ENABLE_SOFA_READER_MODULE
+    if(!pData->useDefaultHRIRsFLAG && pars->sofa_filepath!=NULL){
+        /* Load SOFA file */
+        error = saf_sofa_open(&sofa, pars->sofa_filepath, SAF_SOFA_READER_OPTION_DEFAULT);
+
+        /* Load defaults instead */
+        if(error!=SAF_SOFA_OK || sofa.nReceivers!=NUM_EARS){
+            pData->useDefaultHRIRsFLAG = 1;
+            saf_print_warning("Unable to load the specified SOFA file, or it contained something other than 2 channels. Using default HRIR data instead.");
+        }
+        else{
+            /* Copy SOFA data */
+            pars->hrir_fs = (int)sofa.DataSamplingRate;
+            pars->hrir_len = sofa.DataLengthIR;
+            pars->N_hrir_dirs = sofa.nSources;
+            pars->hrirs = realloc1d(pars->hrirs, pars->N_hrir_dirs*NUM_EARS*(pars->hrir_len)*sizeof(float));
+            memcpy(pars->hrirs, sofa.DataIR, pars->N_hrir_dirs*NUM_EARS*(pars->hrir_len)*sizeof(float));
+            pars->hrir_dirs_deg = realloc1d(pars->hrir_dirs_deg, pars->N_hrir_dirs*2*sizeof(float));
+            cblas_scopy(pars->N_hrir_dirs, sofa.SourcePosition, 3, pars->hrir_dirs_deg, 2); /* azi */
+            cblas_scopy(pars->N_hrir_dirs, &sofa.SourcePosition[1], 3, &pars->hrir_dirs_deg[1], 2); /* elev */
+        }
+
+        /* Clean-up */
+        saf_sofa_close(&sofa);
+    }
+#else
+    pData->useDefaultHRIRsFLAG = 1; /* Can only load the default HRIR data */
+#endif
+    if(pData->useDefaultHRIRsFLAG){
+        /* Copy default HRIR data */
+        pars->hrir_fs = __default_hrir_fs;
+        pars->hrir_len = __default_hrir_len;
+        pars->N_hrir_dirs = __default_N_hrir_dirs;
+        pars->hrirs = realloc1d(pars->hrirs, pars->N_hrir_dirs*NUM_EARS*(pars->hrir_len)*sizeof(float));
+        memcpy(pars->hrirs, (float*)__default_hrirs, pars->N_hrir_dirs*NUM_EARS*(pars->hrir_len)*sizeof(float));
+        pars->hrir_dirs_deg = realloc1d(pars->hrir_dirs_deg, pars->N_hrir_dirs*2*sizeof(float));
+        memcpy(pars->hrir_dirs_deg, (float*)__default_hrir_dirs_deg, pars->N_hrir_dirs*2*sizeof(float));
+    }
+    
+    /* previously resampled sets are no longer valid */
+    for(i=0; i<HRIR_CACHE_SIZE; i++){
+        free(pars->hrirCache[i].hrirs);
+        pars->hrirCache[i].hrirs = NULL;
+        pars->hrirCache[i].fs = 0;
+        pars->hrirCache[i].len = 0;
+    }
+    pars->hrirCacheNext = 0;
+}
+
+void hcropaclib_resampleHRIRs(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    codecPars* pars = pData->pars;
+    hrirCacheEntry* entry;
+    int i;
+    
+    /* no resampling required */
+    if(pars->hrir_fs == pData->fs){
+        pars->hrirs_runtime = pars->hrirs;
+        pars->hrir_runtime_len = pars->hrir_len;
+        pars->hrir_runtime_fs = pars->hrir_fs;
+        return;
+    }
+    
+    /* look for a set that has already been resampled to this rate */
+    entry = NULL;
+    for(i=0; i<HRIR_CACHE_SIZE; i++){
+        if(pars->hrirCache[i].hrirs!=NULL && pars->hrirCache[i].fs == pData->fs){
+            entry = &(pars->hrirCache[i]);
+            break;
+        }
+    }
+    
+    /* otherwise, resample and replace the oldest set */
+    if(entry==NULL){
+        entry = &(pars->hrirCache[pars->hrirCacheNext]);
+        pars->hrirCacheNext = (pars->hrirCacheNext + 1) % HRIR_CACHE_SIZE;
+        free(entry->hrirs);
+        entry->hrirs = NULL;
+        resampleHRIRs(pars->hrirs, pars->N_hrir_dirs, pars->hrir_len, pars->hrir_fs, pData->fs, 0, &(entry->hrirs), &(entry->len));
+        entry->fs = pData->fs;
+    }
+    pars->hrirs_runtime = entry->hrirs;
+    pars->hrir_runtime_len = entry->len;
+    pars->hrir_runtime_fs = entry->fs;
+}
+
+void hcropaclib_initHRTFsAndDecoder(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    codecPars* pars = pData->pars;
+    int i, j, band;
+    
+    /* HRIRs at the host sampling rate */
+    hcropaclib_resampleHRIRs(hCroPaC);
+    
+    /* estimate the ITDs for each HRIR */
+    pars->itds_s = realloc1d(pars->itds_s, pars->N_hrir_dirs*sizeof(float));
+    estimateITDs(pars->hrirs_runtime, pars->N_hrir_dirs, pars->hrir_runtime_len, pars->hrir_runtime_fs, pars->itds_s);
+    
+    pData->progressBar0_1 = 0.4f;
+    
+    /* convert hrirs to filterbank coefficients */
+    pars->hrtf_fb = realloc1d(pars->hrtf_fb, pData->nBands * NUM_EARS * (pars->N_hrir_dirs)*sizeof(float_complex));
+    hcropaclib_tftHRIRs2HRTFs(hCroPaC, pars->hrirs_runtime, pars->N_hrir_dirs, pars->hrir_runtime_len, pars->hrtf_fb);
+    diffuseFieldEqualiseHRTFs(pars->N_hrir_dirs, pars->itds_s, pData->freqVector, pData->nBands, NULL,
+                              pData->hrirProcMode == HRIR_PREPROC_ALL || pData->hrirProcMode == HRIR_PREPROC_EQ ? 1 : 0,
+                              pData->hrirProcMode == HRIR_PREPROC_ALL || pData->hrirProcMode == HRIR_PREPROC_PHASE ? 1 : 0,
+                              pars->hrtf_fb);
+    pars->hrtf_fb_mag = realloc1d(pars->hrtf_fb_mag, pData->nBands*NUM_EARS* (pars->N_hrir_dirs)*sizeof(float));
+    for(i=0; i<pData->nBands*NUM_EARS* (pars->N_hrir_dirs); i++)
+        pars->hrtf_fb_mag[i] = cabsf(pars->hrtf_fb[i]);
+#ifdef ENABLE_BINAURAL_DIFF_COH
+    binauralDiffuseCoherence(pars->hrtf_fb, pars->itds_s, pData->freqVector, pars->N_hrir_dirs, pData->nBands, (float*)pars->binDiffuseCoh);
+#endif
+    
+    /* compressed HRTF interpolation table */
+    strcpy(pData->progressBarText,"Computing interpolation table");
+    pData->progressBar0_1 = 0.85f;
+    float* hrtf_vbap_gtable = NULL;
+    pars->az_res = 1;
+    pars->el_res = 4;
+    generateVBAPgainTable3D(pars->hrir_dirs_deg,  pars->N_hrir_dirs, pars->az_res, pars->el_res, 0, 0, 0.0f,
+                            &hrtf_vbap_gtable, &(pars->N_hrtf_vbap_gtable), &(pars->hrtf_nTriangles));
+    pars->vbap_gtableComp = realloc1d(pars->vbap_gtableComp, pars->N_hrtf_vbap_gtable*3*sizeof(float));
+    pars->vbap_gtableIdx = realloc1d(pars->vbap_gtableIdx, pars->N_hrtf_vbap_gtable*3*sizeof(int));
+    compressVBAPgainTable3D(hrtf_vbap_gtable, pars->N_hrtf_vbap_gtable, pars->N_hrir_dirs, pars->vbap_gtableComp, pars->vbap_gtableIdx);
+    free(hrtf_vbap_gtable);
+
+    /* get integration weights */
+    float* weights;
+    if(pars->N_hrir_dirs<1800){
+        weights = malloc1d(pars->N_hrir_dirs*sizeof(float));
+        getVoronoiWeights(pars->hrir_dirs_deg, pars->N_hrir_dirs, 0, weights);
+    }
+    else
+        weights = NULL;
+    
+    /* ----- COMPUTE PROTO DECODER ----- */
+    float_complex* decMtx;
+    decMtx = calloc1d(pData->nBands*NUM_EARS*NUM_SH_SIGNALS, sizeof(float_complex));
+    getBinauralAmbiDecoderMtx(pars->hrtf_fb, pars->hrir_dirs_deg, pars->N_hrir_dirs, pData->nBands, BINAURAL_DECODER_MAGLS, SH_ORDER, pData->freqVector, pars->itds_s, weights, pData->diffCorrection, 1, decMtx);
+    
+    /* replace current decoder */
+    memset(pars->M_dec, 0, MAX_NUM_BANDS*NUM_EARS*NUM_SH_SIGNALS*sizeof(float_complex));
+    for(band=0; band<pData->nBands; band++)
+        for(i=0; i<NUM_EARS; i++)
+            for(j=0; j<NUM_SH_SIGNALS; j++)
+                pars->M_dec[band][i][j] = decMtx[band*NUM_EARS*NUM_SH_SIGNALS + i*NUM_SH_SIGNALS + j];
+    free(decMtx);
+    free(weights);
+}
+
+void hcropaclib_initScanningGrid(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    codecPars* pars = pData->pars;
+    int i, k;
+    float maxError_deg, meanError_deg;
+    float Rxyz[3][3];
+    float* M_rot_tmp;
+
+    pars->grid_icoFreq = pData->gridIcoFreq;
+    pars->grid_dirs_deg = (float*)__HANDLES_geosphere_ico_dirs_deg[pars->grid_icoFreq];
+    pars->grid_nDirs = __geosphere_ico_nPoints[pars->grid_icoFreq];
+    pars->Y_grid = realloc1d(pars->Y_grid, NUM_SH_SIGNALS*(pars->grid_nDirs)*sizeof(float));
+    getRSH(SH_ORDER, pars->grid_dirs_deg, pars->grid_nDirs, pars->Y_grid);
+    pars->pwdmap = realloc1d(pars->pwdmap, 2*MAX_TIME_SLOTS*(pars->grid_nDirs)*sizeof(float));
+    pars->M_rot = realloc1d(pars->M_rot, pars->grid_nDirs*NUM_M_ROT_ROWS*NUM_SH_SIGNALS*sizeof(float));
+    pars->Y_grid_fmt = realloc1d(pars->Y_grid_fmt, NUM_SH_SIGNALS*(pars->grid_nDirs)*sizeof(float));
+    pars->M_rot_fmt = realloc1d(pars->M_rot_fmt, pars->grid_nDirs*NUM_M_ROT_ROWS*NUM_SH_SIGNALS*sizeof(float));
+    
+    /* rotation matrices for each grid direction (only the rows required for the CroPaC gains are kept) */
+    M_rot_tmp = malloc1d(NUM_SH_SIGNALS*NUM_SH_SIGNALS * sizeof(float));
+    for(i=0; i<pars->grid_nDirs; i++){
+        yawPitchRoll2Rzyx(pars->grid_dirs_deg[i*2]*SAF_PI/180.0f, -pars->grid_dirs_deg[i*2+1]*SAF_PI/180.0f, 0.0f, 0, Rxyz);
+        getSHrotMtxReal(Rxyz, M_rot_tmp, SH_ORDER);
+        for (k = 0; k < NUM_SH_SIGNALS; k++){
+            pars->M_rot[i*NUM_M_ROT_ROWS*NUM_SH_SIGNALS + 0*NUM_SH_SIGNALS + k] = M_rot_tmp[0*NUM_SH_SIGNALS + k];
+            pars->M_rot[i*NUM_M_ROT_ROWS*NUM_SH_SIGNALS + 1*NUM_SH_SIGNALS + k] = M_rot_tmp[3*NUM_SH_SIGNALS + k];
+        }
+    }
+    free(M_rot_tmp);
+    
+    /* DoA quantisation error of this grid */
+    hcropaclib_computeGridQuantisationError(pars->grid_dirs_deg, pars->grid_nDirs, &maxError_deg, &meanError_deg);
+    pData->gridMaxError_deg = maxError_deg;
+    pData->gridMeanError_deg = meanError_deg;
+}
+
+void hcropaclib_computeGridQuantisationError
+(
+    float* grid_dirs_deg,
+    int nDirs,
+    float* maxError_deg,
+    float* meanError_deg
+)
+{
+    int i, j;
+    float z, r, phi, maxDot, dot, angle, maxAngle, sumAngle;
+    float ref_xyz[3];
+    float* grid_xyz;
+    
+    grid_xyz = malloc1d(nDirs*3*sizeof(float));
+    unitSph2cart(grid_dirs_deg, nDirs, 1, grid_xyz);
+    
+    /* quasi-uniform (Fibonacci) reference directions; for each one, find the nearest grid direction */
+    maxAngle = sumAngle = 0.0f;
+    for(i=0; i<GRID_ERROR_NUM_REF_DIRS; i++){
+        z = 1.0f - (2.0f*(float)i + 1.0f)/(float)GRID_ERROR_NUM_REF_DIRS;
+        r = sqrtf(SAF_MAX(0.0f, 1.0f - z*z));
+        phi = (float)i * SAF_PI * (3.0f - sqrtf(5.0f)); /* golden angle */
+        ref_xyz[0] = r*cosf(phi);
+        ref_xyz[1] = r*sinf(phi);
+        ref_xyz[2] = z;
+        maxDot = -1.0f;
+        for(j=0; j<nDirs; j++){
+            dot = cblas_sdot(3, ref_xyz, 1, &grid_xyz[j*3], 1);
+            maxDot = SAF_MAX(maxDot, dot);
+        }
+        angle = RAD2DEG(acosf(SAF_CLAMP(maxDot, -1.0f, 1.0f)));
+        maxAngle = SAF_MAX(maxAngle, angle);
+        sumAngle += angle;
+    }
+    (*maxError_deg) = maxAngle;
+    (*meanError_deg) = sumAngle/(float)GRID_ERROR_NUM_REF_DIRS;
+    
+    free(grid_xyz);
 }
  
 void hcropaclib_interpHRTFs
 (
     void* const hCroPaC,
     int band,
-    float azi[TIME_SLOTS],
-    float elev[TIME_SLOTS],
-    float_complex h_intrp[TIME_SLOTS][NUM_EARS]
+    int nSlots,
+    float azi[MAX_TIME_SLOTS],
+    float elev[MAX_TIME_SLOTS],
+    float_complex h_intrp[MAX_TIME_SLOTS][NUM_EARS]
 )
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
     codecPars* pars = pData->pars;
     int i,t;
-    int aziIndex, elevIndex, gridIndex, N_azi, idx3[TIME_SLOTS][3];
+    int aziIndex, elevIndex, gridIndex, N_azi, idx3[MAX_TIME_SLOTS][3];
     float_complex ipd;
-    float aziRes, elevRes, weights[TIME_SLOTS][3];
-    float magnitudes3[3][NUM_EARS], magInterp[TIME_SLOTS][NUM_EARS], itds3[3], itdInterp[TIME_SLOTS];
+    float aziRes, elevRes, weights[MAX_TIME_SLOTS][3];
+    float magnitudes3[3][NUM_EARS], magInterp[MAX_TIME_SLOTS][NUM_EARS], itds3[3], itdInterp[MAX_TIME_SLOTS];
     
     /* find closest pre-computed Amplitude-norm VBAP direction */
     aziRes = (float)pars->az_res;
     elevRes = (float)pars->el_res;
     N_azi = (int)(360.0f / aziRes + 0.5f) + 1;
-    for(t=0; t<TIME_SLOTS; t++){
+    for(t=0; t<nSlots; t++){
         aziIndex = (int)(matlab_fmodf(azi[t] + 180.0f, 360.0f) / aziRes + 0.5f);
         elevIndex = (int)((elev[t] + 90.0f) / elevRes + 0.5f);
         gridIndex = elevIndex * N_azi + aziIndex;
         memcpy(idx3[t], &(pars->vbap_gtableIdx[gridIndex*3]), 3*sizeof(int));
         memcpy(weights[t], &(pars->vbap_gtableComp[gridIndex*3]), 3*sizeof(float));
     }
-    for(t=0; t<TIME_SLOTS; t++){
+    for(t=0; t<nSlots; t++){
         for(i=0; i<3; i++){
             magnitudes3[i][0] = pars->hrtf_fb_mag[band*NUM_EARS*(pars->N_hrir_dirs) + 0*(pars->N_hrir_dirs) + idx3[t][i]];
             magnitudes3[i][1] = pars->hrtf_fb_mag[band*NUM_EARS*(pars->N_hrir_dirs) + 1*(pars->N_hrir_dirs) + idx3[t][i]];
@@ -106,3 +827,663 @@ void hcropaclib_interpHRTFs
         h_intrp[t][1] = ccmulf(cmplxf(magInterp[t][1], 0.0f), conjf(cexpf(ipd)));
     }
 }
+
+void hcropaclib_rcgemm
+(
+    int M,
+    int N,
+    int K,
+    const float* A,
+    const float_complex* B,
+    int ldb,
+    float_complex* C,
+    int ldc
+)
+{
+    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, M, 2*N, K, 1.0f,
+                A, K,
+                (const float*)B, 2*ldb, 0.0f,
+                (float*)C, 2*ldc);
+}
+
+void hcropaclib_powermapArgmax
+(
+    const float_complex* inTF,
+    int nSlots,
+    const float* Y_grid,
+    int nDirs,
+    float* pwdmap,
+    int dir_max_idx[MAX_TIME_SLOTS]
+)
+{
+    int i, t;
+    float val, maxVal;
+    float *pwd_re, *pwd_im;
+
+    /* The transposed input is a (2*nSlots x NUM_SH_SIGNALS) real matrix, with rows alternating between the real and imaginary parts */
+    cblas_sgemm(CblasRowMajor, CblasTrans, CblasNoTrans, 2*nSlots, nDirs, NUM_SH_SIGNALS, 1.0f,
+                (const float*)inTF, 2*MAX_TIME_SLOTS,
+                Y_grid, nDirs, 0.0f,
+                pwdmap, nDirs);
+
+    /* determine which directions have the most energy per time instance */
+    for(t=0; t<nSlots; t++){
+        pwd_re = &pwdmap[(2*t)*nDirs];
+        pwd_im = &pwdmap[(2*t+1)*nDirs];
+        dir_max_idx[t] = 0;
+        maxVal = -1.0f;
+        for(i=0; i<nDirs; i++){
+            val = fabsf(pwd_re[i]) + fabsf(pwd_im[i]);
+            if(val > maxVal){
+                maxVal = val;
+                dir_max_idx[t] = i;
+            }
+        }
+    }
+}
+
+void hcropaclib_rotateFrameTF
+(
+    void* const hCroPaC,
+    int nBands,
+    int nSlots
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    int band;
+    
+    for (band = 0; band < nBands; band++) {
+        hcropaclib_rcgemm(NUM_SH_SIGNALS, nSlots, NUM_SH_SIGNALS,
+                          (float*)pData->M_rot,
+                          FLATTEN2D(pData->SHframeTF[band]), MAX_TIME_SLOTS,
+                          FLATTEN2D(pData->SHframeTF_rot), MAX_TIME_SLOTS);
+        memcpy(FLATTEN2D(pData->SHframeTF[band]), FLATTEN2D(pData->SHframeTF_rot), NUM_SH_SIGNALS*MAX_TIME_SLOTS*sizeof(float_complex));
+    }
+}
+
+void hcropaclib_decodeFrameTF
+(
+    void* const hCroPaC,
+    int nBands,
+    int nAudibleBands,
+    int nSlots,
+    int enableCroPaC
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    codecPars* pars = pData->pars;
+    const float_complex calpha = cmplxf(1.0f, 0.0f), cbeta = cmplxf(0.0f, 0.0f);
+    int band;
+#ifdef ENABLE_RESIDUAL_STREAM
+    int i, t;
+#endif
+    
+    for (band = 0; band < nBands; band++) {
+        cblas_cgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, NUM_EARS, nSlots, NUM_SH_SIGNALS, &calpha,
+                    enableCroPaC && band < nAudibleBands ? pars->M_dec_fmt[band] : pars->M_dec_eq_fmt[band], NUM_SH_SIGNALS,
+                    FLATTEN2D(pData->SHframeTF[band]), MAX_TIME_SLOTS, &cbeta,
+                    FLATTEN2D(pData->ambiframeTF[band]), MAX_TIME_SLOTS);
+#ifdef ENABLE_RESIDUAL_STREAM
+        if(band >= nAudibleBands)
+            continue;
+        for(i=0; i<NUM_EARS; i++){
+            for(t=0; t<nSlots; t++)
+                pData->decorrelatedframeTF[band][i][t] = pData->circBufferFrames[band][i][NUM_DECOR_SLOTS+t-pData->decorrelationDelays[band][i]];
+        }
+        for(i=0; i<NUM_EARS; i++){
+            for(t=0; t<NUM_DECOR_SLOTS; t++)
+                pData->circBufferFrames[band][i][t] = pData->circBufferFrames[band][i][t+nSlots];
+            memcpy(&(pData->circBufferFrames[band][i][NUM_DECOR_SLOTS]), pData->ambiframeTF[band][i], nSlots*sizeof(float_complex));
+        }
+#endif
+    }
+}
+
+float hcropaclib_updateCovariances
+(
+    void* const hCroPaC,
+    int nBands,
+    int nSlots,
+    float covAvgCoeff,
+    int updatePrototype,
+    float* bandEnergy
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    const float_complex calpha = cmplxf(1.0f, 0.0f), cbeta = cmplxf(0.0f, 0.0f);
+    int i, j, band;
+    float maxBandEnergy;
+    float_complex Cx_new[NUM_SH_SIGNALS][NUM_SH_SIGNALS], Cambi_new[NUM_EARS][NUM_EARS];
+    
+    maxBandEnergy = 0.0f;
+    for(band=0; band<nBands; band++){
+        /* For input SH */
+        cblas_cgemm(CblasRowMajor, CblasNoTrans, CblasConjTrans, NUM_SH_SIGNALS, NUM_SH_SIGNALS, nSlots, &calpha,
+                    FLATTEN2D(pData->SHframeTF[band]), MAX_TIME_SLOTS,
+                    FLATTEN2D(pData->SHframeTF[band]), MAX_TIME_SLOTS, &cbeta,
+                    Cx_new, NUM_SH_SIGNALS);
+        for(i=0; i<NUM_SH_SIGNALS; i++)
+            for(j=0; j<NUM_SH_SIGNALS; j++)
+                pData->Cx[band][i][j] = ccaddf(crmulf(pData->Cx[band][i][j], covAvgCoeff), crmulf(Cx_new[i][j], 1.0f-covAvgCoeff));
+
+        /* Instantaneous band energy */
+        bandEnergy[band] = 0.0f;
+        for(i=0; i<NUM_SH_SIGNALS; i++)
+            bandEnergy[band] += pData->energyWeights[i] * crealf(Cx_new[i][i]);
+        maxBandEnergy = SAF_MAX(maxBandEnergy, bandEnergy[band]);
+            
+        /* For prototype */
+        if(updatePrototype){
+            cblas_cgemm(CblasRowMajor, CblasNoTrans, CblasConjTrans, NUM_EARS, NUM_EARS, nSlots, &calpha,
+                        FLATTEN2D(pData->ambiframeTF[band]), MAX_TIME_SLOTS,
+                        FLATTEN2D(pData->ambiframeTF[band]), MAX_TIME_SLOTS, &cbeta,
+                        Cambi_new, NUM_EARS);
+            for(i=0; i<NUM_EARS; i++)
+                for(j=0; j<NUM_EARS; j++)
+                    pData->Cambi[band][i][j] = ccaddf(crmulf(pData->Cambi[band][i][j], covAvgCoeff), crmulf(Cambi_new[i][j], 1.0f-covAvgCoeff));
+        }
+    }
+    return maxBandEnergy;
+}
+
+float hcropaclib_cropacGain
+(
+    const float_complex* inputFrame_s,
+    const float* M_rot_dir,
+    float inputEnergy
+)
+{
+    int n, j;
+    float G;
+    float_complex inputFrame_rot[NUM_M_ROT_ROWS];
+    
+    /* omni and x-dipole of the input, rotated such that the DoA is aligned with the x-axis */
+    for(n=0; n<NUM_M_ROT_ROWS; n++){
+        inputFrame_rot[n] = cmplxf(0.0f, 0.0f);
+        for(j=0; j<NUM_SH_SIGNALS; j++)
+            inputFrame_rot[n] = ccaddf(inputFrame_rot[n], crmulf(inputFrame_s[j], M_rot_dir[n*NUM_SH_SIGNALS+j]));
+    }
+    G = SAF_MAX(0.0f, 2.0f*crealf( ccmulf(conjf(inputFrame_rot[0]), crmulf(inputFrame_rot[1], 1.0f/sqrtf(3.0f))) ) /inputEnergy);
+    return G;
+}
+
+void hcropaclib_cropacGainsBand
+(
+    void* const hCroPaC,
+    int band,
+    int nSlots,
+    const int* dir_max_idx,
+    float* inputEnergy,
+    float* G
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    codecPars* pars = pData->pars;
+    int i, j;
+    float_complex inputFrame_s[NUM_SH_SIGNALS];
+    
+    for(i=0; i<nSlots; i++){
+        inputEnergy[i] = CROPAC_ENERGY_FLOOR;
+        for(j=0; j<NUM_SH_SIGNALS; j++){
+            inputFrame_s[j] = pData->SHframeTF[band][j][i];
+            inputEnergy[i] += pData->cropacEnergyWeights[j] * (crealf(inputFrame_s[j])*crealf(inputFrame_s[j]) + cimagf(inputFrame_s[j])*cimagf(inputFrame_s[j]));
+        }
+        if(dir_max_idx != NULL)
+            G[i] = hcropaclib_cropacGain(inputFrame_s, &(pars->M_rot_fmt[dir_max_idx[i]*NUM_M_ROT_ROWS*NUM_SH_SIGNALS]), inputEnergy[i]);
+    }
+}
+
+void hcropaclib_formulateMixingMatrices
+(
+    void* const hCroPaC,
+    int band
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    static const float eye2[NUM_EARS][NUM_EARS][2] = { {{1.0f, 0.0f}, {0.0f, 0.0f}}, {{0.0f, 0.0f}, {1.0f, 0.0f}} }; /* complex, interleaved */
+#ifdef ENABLE_RESIDUAL_STREAM
+    int i, j;
+    float_complex Cr[NUM_EARS][NUM_EARS];
+    float Cr_real[NUM_EARS][NUM_EARS];
+    float diag_Cambi[NUM_EARS][NUM_EARS] = {{0.0f}};
+    static const float real_eye2[NUM_EARS][NUM_EARS] = { {1.0f, 0.0f}, {0.0f, 1.0f} };
+    
+    diag_Cambi[0][0] = crealf(pData->Cambi[band][0][0]);
+    diag_Cambi[1][1] = crealf(pData->Cambi[band][1][1]);
+    formulate_M_and_Cr_cmplx(pData->hCdf, (float_complex*)pData->Cambi[band], (float_complex*)pData->Cy[band], (float_complex*)eye2,
+                             0, CDF_REGULARISATION, (float_complex*)pData->new_M[band], (float_complex*)Cr);
+    
+    /* Convert residual to real */
+    for(i=0; i<NUM_EARS; i++)
+        for(j=0; j<NUM_EARS; j++)
+            Cr_real[i][j] = crealf(Cr[i][j]);
+    
+    /* Compute residual mixing matrix */
+    formulate_M_and_Cr(pData->hCdf_res, (float*)diag_Cambi, (float*)Cr_real, (float*)real_eye2,
+                       0, CDF_REGULARISATION, (float*)pData->new_Mr[band], NULL);
+#else
+    formulate_M_and_Cr_cmplx(pData->hCdf, (float_complex*)pData->Cambi[band], (float_complex*)pData->Cy[band], (float_complex*)eye2,
+                             1, CDF_REGULARISATION, (float_complex*)pData->new_M[band], NULL);
+#endif
+}
+
+#ifdef ENABLE_RESIDUAL_STREAM
+void hcropaclib_transientDetector
+(
+    void* const hCroPaC,
+    int nBands,
+    int nSlots
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    int band, i, t;
+    float alpha, beta, detectorEne, transientEQ;
+    
+    alpha = 0.95f;
+    beta = 0.995f;
+    for(band=0; band<nBands; band++){
+        for(i=0; i<NUM_EARS; i++){
+            for(t=NUM_DECOR_SLOTS-nSlots; t<NUM_DECOR_SLOTS; t++){
+                detectorEne = powf(cabsf(pData->circBufferFrames[band][i][t]), 2.0f);
+                pData->transientDetector1[band][i] *= alpha;
+                if(pData->transientDetector1[band][i]<detectorEne)
+                    pData->transientDetector1[band][i] = detectorEne;
+                pData->transientDetector2[band][i] = pData->transientDetector2[band][i]*beta + (1.0f-beta)*(pData->transientDetector1[band][i]);
+                if(pData->transientDetector2[band][i]>pData->transientDetector1[band][i])
+                    pData->transientDetector2[band][i] = pData->transientDetector1[band][i];
+                transientEQ = SAF_MIN(1.0f, 4.0f*(pData->transientDetector2[band][i])/(pData->transientDetector1[band][i]+2.e-9f));
+                pData->circBufferFrames[band][i][t] = crmulf(pData->circBufferFrames[band][i][t], transientEQ);
+            }
+        }
+    }
+}
+#endif
+
+void hcropaclib_mixFrameTF
+(
+    void* const hCroPaC,
+    int nBands,
+    int nSlots,
+    const float* eq
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    int band, i, j, t;
+    float_complex inFrame_t[NUM_EARS], outFrame_t[NUM_EARS], interp_M[NUM_EARS][NUM_EARS], M_eq[NUM_EARS][NUM_EARS];
+#ifdef ENABLE_RESIDUAL_STREAM
+    float Mr_eq[NUM_EARS][NUM_EARS];
+#endif
+    
+    for(band=0; band<nBands; band++){
+        for (i = 0; i < NUM_EARS; i++)
+            for (j = 0; j < NUM_EARS; j++)
+                M_eq[i][j] = crmulf(pData->new_M[band][i][j], eq[band]);
+        for(t=0; t<nSlots; t++){
+            for(j=0; j<NUM_EARS; j++)
+                inFrame_t[j] = pData->ambiframeTF[band][j][t];
+            for (i = 0; i < NUM_EARS; i++) {
+                for (j = 0; j < NUM_EARS; j++) {
+#ifndef _MSC_VER
+                    interp_M[i][j] = pData->interpolator[t]*M_eq[i][j] + (1.0f-pData->interpolator[t])*pData->current_M[band][i][j];
+#else
+                    interp_M[i][j] = ccaddf(crmulf(M_eq[i][j], pData->interpolator[t]), crmulf(pData->current_M[band][i][j], 1.0f - pData->interpolator[t]));
+#endif
+                }
+            }
+            for(i=0; i<NUM_EARS; i++)
+                utility_cvvdot(interp_M[i], inFrame_t, NUM_EARS, NO_CONJ, &outFrame_t[i]);
+            for(i=0; i<NUM_EARS; i++)
+                pData->binframeTF[band][i][t] = outFrame_t[i];
+        }
+        memcpy(pData->current_M[band], M_eq, NUM_EARS*NUM_EARS*sizeof(float_complex)); /* for next frame */
+            
+#ifdef ENABLE_RESIDUAL_STREAM
+        for (i = 0; i < NUM_EARS; i++)
+            for (j = 0; j < NUM_EARS; j++)
+                Mr_eq[i][j] = pData->new_Mr[band][i][j] * eq[band];
+        for(t=0; t<nSlots; t++){
+            for(j=0; j<NUM_EARS; j++)
+                inFrame_t[j] = pData->decorrelatedframeTF[band][j][t];
+                
+            for (i = 0; i < NUM_EARS; i++) {
+                for (j = 0; j < NUM_EARS; j++) {
+#ifndef _MSC_VER
+                    interp_M[i][j] = pData->interpolator[t]*Mr_eq[i][j] + (1.0f-pData->interpolator[t])*pData->current_Mr[band][i][j];
+#else
+                    interp_M[i][j] = cmplxf(Mr_eq[i][j] * pData->interpolator[t] + pData->current_Mr[band][i][j] * (1.0f - pData->interpolator[t]), 0.0f);
+#endif
+                }
+            }
+            for(i=0; i<NUM_EARS; i++)
+                utility_cvvdot(interp_M[i], inFrame_t, NUM_EARS, NO_CONJ, &outFrame_t[i]);
+            for(i=0; i<NUM_EARS; i++)
+                pData->binframeTF[band][i][t] = ccaddf(pData->binframeTF[band][i][t], outFrame_t[i]);
+        } 
+        memcpy(pData->current_Mr[band], Mr_eq, NUM_EARS*NUM_EARS*sizeof(float));
+#endif
+    }
+}
+
+double hcropaclib_profileClock_us(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double)count.QuadPart * 1e6 / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec * 1e-3;
+#endif
+}
+
+void hcropaclib_profileBeginFrame(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    int i;
+
+    pData->profActive = pData->enableProfiling;
+    pData->latActive = pData->enableLatencyStats;
+    pData->traceActive = pData->enableTracing && pData->traceEvents != NULL;
+    if(!pData->profActive && !pData->latActive && !pData->traceActive)
+        return;
+    if(pData->profActive && pData->resetProfileFLAG){
+        /* the statistics are only ever written by the processing thread */
+        memset(pData->profStageSum_us, 0, HCROPAC_PROFILE_NUM_STAGES*sizeof(double));
+        pData->profFrameSum_us = 0.0;
+        pData->profFrameMax_us = 0.0f;
+        pData->profNFrames = 0;
+        pData->resetProfileFLAG = 0;
+    }
+    if(pData->latActive && pData->resetLatencyFLAG){
+        for(i=0; i<LATENCY_NUM_BUCKETS; i++)
+            pData->latencyHist[i] = 0;
+        pData->latency_nFrames = 0;
+        pData->latency_nMisses = 0;
+        pData->latency_max_us = 0.0f;
+        pData->resetLatencyFLAG = 0;
+    }
+    pData->profFrameStart_us = pData->profMark_us = hcropaclib_profileClock_us();
+}
+
+void hcropaclib_profileMark
+(
+    void* const hCroPaC,
+    HCROPAC_PROFILE_STAGES stage
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    double now;
+
+    now = hcropaclib_profileClock_us();
+    if(pData->profActive)
+        pData->profStageSum_us[stage] += now - pData->profMark_us;
+    if(pData->traceActive)
+        hcropaclib_traceEvent(hCroPaC, TRACE_TRACK_PROCESS, hcropaclib_getProfileStageName((int)stage), pData->profMark_us, (float)(now - pData->profMark_us));
+    pData->profMark_us = now;
+}
+
+void hcropaclib_profileEndFrame(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    int stage, bucket;
+    float frame_us, framePeriod_us;
+
+    frame_us = (float)(hcropaclib_profileClock_us() - pData->profFrameStart_us);
+    if(pData->traceActive)
+        hcropaclib_traceEvent(hCroPaC, TRACE_TRACK_PROCESS, "process", pData->profFrameStart_us, frame_us);
+
+    /* latency statistics */
+    if(pData->latActive){
+        bucket = frame_us < 1.0f ? 0 : SAF_MIN((int)((float)LATENCY_BUCKETS_PER_OCTAVE*log2f(frame_us)) + 1, LATENCY_NUM_BUCKETS-1);
+        pData->latencyHist[bucket]++;
+        framePeriod_us = pData->fs > 0 ? 1e6f*(float)(pData->nSlots*HOP_SIZE)/(float)pData->fs : 0.0f;
+        if(framePeriod_us > 0.0f && frame_us > pData->deadlineFraction*framePeriod_us)
+            pData->latency_nMisses++;
+        pData->latency_max_us = SAF_MAX(pData->latency_max_us, frame_us);
+        pData->latency_nFrames++;
+    }
+    if(!pData->profActive)
+        return;
+
+    /* profiler */
+    pData->profFrameSum_us += (double)frame_us;
+    pData->profFrameMax_us = SAF_MAX(pData->profFrameMax_us, frame_us);
+    pData->profNFrames++;
+
+    /* publish */
+    for(stage=0; stage<HCROPAC_PROFILE_NUM_STAGES; stage++)
+        pData->profile_stageMean_us[stage] = (float)(pData->profStageSum_us[stage]/(double)pData->profNFrames);
+    pData->profile_frameMean_us = (float)(pData->profFrameSum_us/(double)pData->profNFrames);
+    pData->profile_frameMax_us = pData->profFrameMax_us;
+    pData->profile_cpuLoad = pData->fs > 0 ? pData->profile_frameMean_us * 1e-6f * (float)pData->fs/(float)(pData->nSlots*HOP_SIZE) : 0.0f;
+    pData->profile_nFrames = pData->profNFrames;
+}
+
+void hcropaclib_traceEvent
+(
+    void* const hCroPaC,
+    TRACE_TRACKS track,
+    const char* name,
+    double start_us,
+    float dur_us
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    traceEvent* event;
+    int idx;
+
+    if(!pData->enableTracing || pData->traceEvents == NULL)
+        return;
+    idx = pData->traceWriteIdx++; /* claims the slot; concurrent writers never share one */
+    event = &(pData->traceEvents[(unsigned int)idx % TRACE_NUM_EVENTS]);
+    event->name = name;
+    event->ts_us = start_us;
+    event->dur_us = dur_us;
+    event->track = (int)track;
+}
+
+void hcropaclib_traceStage
+(
+    void* const hCroPaC,
+    TRACE_TRACKS track,
+    const char* name,
+    double* mark_us
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    double now;
+
+    if(!pData->enableTracing)
+        return;
+    now = hcropaclib_profileClock_us();
+    hcropaclib_traceEvent(hCroPaC, track, name, *mark_us, (float)(now - *mark_us));
+    *mark_us = now;
+}
+
+void hcropaclib_recordParam
+(
+    void* const hCroPaC,
+    HCROPAC_REC_PARAMS param,
+    int index,
+    float value
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    recEvent* event;
+    int idx;
+
+    /* the last value is kept regardless, so that the start of a recording can re-apply it */
+    pData->recLastValue[param] = value;
+    if(pData->recorderState != HCROPAC_RECORDER_RECORDING)
+        return;
+    idx = pData->recNEvents++; /* claims the slot; concurrent writers never share one */
+    if(idx >= REC_NUM_EVENTS){
+        pData->recorderState = HCROPAC_RECORDER_FULL;
+        return;
+    }
+    event = &(pData->recEvents[idx]);
+    event->frame = pData->recNFrames;
+    event->param = (int)param;
+    event->index = index;
+    event->value = value;
+    event->ts_us = hcropaclib_profileClock_us() - pData->recStart_us;
+}
+
+void hcropaclib_recordPath
+(
+    void* const hCroPaC,
+    const char* path
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    int idx;
+
+    if(pData->recorderState != HCROPAC_RECORDER_RECORDING)
+        return;
+    idx = pData->recNPaths++;
+    if(idx >= REC_MAX_PATHS){
+        pData->recorderState = HCROPAC_RECORDER_FULL;
+        return;
+    }
+    pData->recPaths[idx] = malloc1d(strlen(path) + 1);
+    strcpy(pData->recPaths[idx], path);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_SOFA_PATH, idx, 0.0f);
+}
+
+void hcropaclib_recordStart(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    codecPars* pars = pData->pars;
+    int i, band, param, maxSamples;
+    float value;
+    char* path;
+
+    if(pData->recorderState != HCROPAC_RECORDER_ARMED)
+        return;
+
+    /* the processing loop only ever copies into these */
+    maxSamples = NUM_SH_SIGNALS*(int)(pData->recordingLength_s*(float)pData->fs);
+    if(pData->recEvents == NULL)
+        pData->recEvents = (recEvent*)malloc1d(REC_NUM_EVENTS*sizeof(recEvent));
+    if(pData->recMaxSamples != maxSamples){
+        pData->recMaxSamples = maxSamples;
+        pData->recMaxFrames = maxSamples/(NUM_SH_SIGNALS*HCROPAC_MIN_FRAME_SIZE) + 1;
+        pData->recSamples = realloc1d(pData->recSamples, SAF_MAX(maxSamples, 1)*sizeof(float));
+        pData->recFrames = realloc1d(pData->recFrames, pData->recMaxFrames*sizeof(recFrame));
+    }
+    for(i=0; i<REC_MAX_PATHS; i++){
+        free(pData->recPaths[i]);
+        pData->recPaths[i] = NULL;
+    }
+    pData->recNEvents = 0;
+    pData->recNFrames = 0;
+    pData->recNSamples = 0;
+    pData->recNPaths = 0;
+    pData->recFs = pData->fs;
+    pData->recStart_us = hcropaclib_profileClock_us();
+
+    /* start from a state that the replay may reproduce (the rest was reset by hcropaclib_init()) */
+    hcropaclib_tftClearBuffers(hCroPaC);
+    pData->firActive = 0;
+    pData->renderMetadataPending = 0;
+    pData->recorderState = HCROPAC_RECORDER_RECORDING;
+
+    /* current parameters */
+    path = pars->new_sofa_filepath; /* the most recent path, if it has not yet been loaded */
+    if(path == NULL)
+        path = pars->sofa_filepath;
+    if(path != NULL)
+        hcropaclib_recordPath(hCroPaC, path);
+    for(param=HCROPAC_REC_USE_DEFAULT_HRIRS; param<HCROPAC_REC_REFRESH_PARAMS; param++){
+        if(param == HCROPAC_REC_BALANCE || param == HCROPAC_REC_EQ){
+            for(band=0; band<MAX_NUM_BANDS; band++)
+                hcropaclib_recordParam(hCroPaC, (HCROPAC_REC_PARAMS)param, band, param == HCROPAC_REC_BALANCE ? pData->balance[band] : pData->EQ[band]);
+            continue;
+        }
+        value = pData->recLastValue[param];
+        if(!isnan(value)) /* otherwise, still the default */
+            hcropaclib_recordParam(hCroPaC, (HCROPAC_REC_PARAMS)param, -1, value);
+    }
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_INIT, -1, (float)pData->fs);
+    if(pData->codecStatus == CODEC_STATUS_INITIALISED)
+        hcropaclib_recordParam(hCroPaC, HCROPAC_REC_INIT_CODEC, -1, 0.0f);
+}
+
+int hcropaclib_recordFrameBegin
+(
+    void* const hCroPaC,
+    const float* const* inputs,
+    int inSampleStride,
+    int nInputs,
+    int nOutputs,
+    int nSamples
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    recFrame* frame;
+    int idx, ch, n;
+    float* samples;
+
+    if(pData->recorderState != HCROPAC_RECORDER_RECORDING)
+        return -1;
+    idx = pData->recNFrames;
+    nInputs = SAF_CLAMP(nInputs, 0, NUM_SH_SIGNALS); /* any additional input channels are ignored */
+    if(idx >= pData->recMaxFrames || pData->recNSamples + nInputs*nSamples > pData->recMaxSamples){
+        pData->recorderState = HCROPAC_RECORDER_FULL;
+        return -1;
+    }
+    frame = &(pData->recFrames[idx]);
+    frame->ts_us = hcropaclib_profileClock_us() - pData->recStart_us;
+    frame->nInputs = nInputs;
+    frame->nOutputs = nOutputs;
+    frame->nSamples = nSamples;
+    frame->sampleOffset = pData->recNSamples;
+    frame->outputHash = 0;
+
+    /* the inputs are copied before processing, as they may alias the outputs */
+    samples = &(pData->recSamples[pData->recNSamples]);
+    for(ch=0; ch<nInputs; ch++, samples+=nSamples){
+        if(inSampleStride == 1)
+            memcpy(samples, inputs[ch], nSamples*sizeof(float));
+        else
+            for(n=0; n<nSamples; n++)
+                samples[n] = inputs[ch][n*inSampleStride];
+    }
+    pData->recNSamples += nInputs*nSamples;
+    pData->recNFrames = idx + 1; /* parameter changes from now on apply to the next frame */
+    return idx;
+}
+
+void hcropaclib_recordFrameEnd
+(
+    void* const hCroPaC,
+    int frame,
+    float* const* outputs,
+    int outSampleStride,
+    int nOutputs,
+    int nSamples
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    unsigned long long hash;
+    const unsigned char* bytes;
+    int ch, n, b;
+
+    if(frame < 0)
+        return;
+
+    /* 64-bit FNV-1a */
+    hash = 14695981039346656037ULL;
+    for(ch=0; ch<SAF_MIN(nOutputs, NUM_EARS); ch++){
+        for(n=0; n<nSamples; n++){
+            bytes = (const unsigned char*)&(outputs[ch][n*outSampleStride]);
+            for(b=0; b<(int)sizeof(float); b++){
+                hash ^= (unsigned long long)bytes[b];
+                hash *= 1099511628211ULL;
+            }
+        }
+    }
+    pData->recFrames[frame].outputHash = hash;
+}
@@ -76,7 +76,9 @@ typedef enum _HCROPAC_PROC_STATUS{
 /*                           Configurations Options                           */
 /* ========================================================================== */
 
-#define ENABLE_RESIDUAL_STREAM    /* comment out to disable */
+#ifndef HCROPAC_DISABLE_RESIDUAL_STREAM
+# define ENABLE_RESIDUAL_STREAM   /* define HCROPAC_DISABLE_RESIDUAL_STREAM to disable */
+#endif
 //#define ENABLE_BINAURAL_DIFF_COH  /* binaural diffuse coherence, comment out to disable */
 
 
@@ -84,17 +86,30 @@ typedef enum _HCROPAC_PROC_STATUS{
 /*                            Internal Parameters                             */
 /* ========================================================================== */
 
-#ifndef FRAME_SIZE
-# define FRAME_SIZE ( 512 )
-#endif
+#define MAX_FRAME_SIZE ( HCROPAC_MAX_FRAME_SIZE )
 #define HOP_SIZE ( 128 )                                    /* STFT hop size = nBands */
 #define HYBRID_BANDS ( HOP_SIZE + 5 )                       /* hybrid mode incurs an additional 5 bands  */
-#define TIME_SLOTS ( FRAME_SIZE / HOP_SIZE )                /* 4/8/16 */
+#define STFT_WIN_SIZE ( 2*HOP_SIZE )                        /* window length of the uniform STFT (50% overlap) */
+#define STFT_BANDS ( STFT_WIN_SIZE/2 + 1 )                  /* number of bands of the uniform STFT */
+#define MAX_NUM_BANDS ( HYBRID_BANDS )                      /* the band-dependent tables are sized for the transform with the most bands */
+#define MAX_TIME_SLOTS ( MAX_FRAME_SIZE / HOP_SIZE )        /* the time-frequency buffers are sized for the largest frame size */
+#if (MAX_NUM_BANDS != HCROPAC_MAX_NUM_BANDS) || (MAX_TIME_SLOTS != HCROPAC_MAX_TIME_SLOTS)
+# error "hcropaclib_metadata must be sized for the internal time-frequency buffers"
+#endif
+#define COV_AVG_REF_SLOTS ( 4 )                             /* number of time slots per frame that the user covariance averaging coefficient refers to */
 #define SH_ORDER ( 1 )                                      /* first-order only */
 #define NUM_SH_SIGNALS ( (SH_ORDER+1)*(SH_ORDER+1) )
 #define POST_GAIN_DB ( 3.0f )
+#define GRID_ERROR_NUM_REF_DIRS ( 4000 )                    /* number of reference directions used to measure the scanning grid DoA quantisation error */
+#define HRIR_CACHE_SIZE ( 4 )                               /* number of resampled HRIR sets to keep, for switching between sample rates */
+#define MAX_AUDIBLE_FREQ ( 20e3f )                          /* bands above this frequency are passed through the linear decoder */
+#define NUM_M_ROT_ROWS ( 2 )                                /* only rows 0 (omni) and 3 (x-dipole) of the grid rotations feed the CroPaC gain */
+#define CROPAC_ENERGY_FLOOR ( 2.23e-8f )                    /* added to the CroPaC normalisation energy of each tile, to avoid division by zero */
+#define CDF_REGULARISATION ( 0.2f )                         /* regularisation of the covariance domain mixing matrix solutions */
+#define AFSTFT_DELAY ( 12*HOP_SIZE )                        /* processing delay of the hybrid afSTFT, in samples */
+#define STFT_DELAY ( STFT_WIN_SIZE - HOP_SIZE )             /* processing delay of the uniform STFT, in samples */
 #ifdef ENABLE_RESIDUAL_STREAM
-# define NUM_DECOR_FRAMES ( 8 )
+# define NUM_DECOR_SLOTS ( 32 )                             /* maximum decorrelation delay, in time slots */
 #endif
 #ifndef DEG2RAD
 # define DEG2RAD(x) (x * SAF_PI / 180.0f)
@@ -102,6 +117,25 @@ typedef enum _HCROPAC_PROC_STATUS{
 #ifndef RAD2DEG
 # define RAD2DEG(x) (x * 180.0f / SAF_PI)
 #endif
+#ifdef ENABLE_RESIDUAL_STREAM                               /* time slots required to flush the afSTFT and decorrelator tails */
+# define GATE_FLUSH_SLOTS ( 12 + NUM_DECOR_SLOTS )
+#else
+# define GATE_FLUSH_SLOTS ( 12 )
+#endif
+#define LATENCY_BUCKETS_PER_OCTAVE ( 8 )                    /* latency histogram resolution */
+#define LATENCY_NUM_BUCKETS ( 129 )                         /* latency histogram buckets; <1us, then 1/8 octaves up to 65.5ms (the last also takes longer calls) */
+#define TRACE_NUM_EVENTS ( 65536 )                          /* capacity of the trace ring buffer, in events */
+#define REC_NUM_EVENTS ( 65536 )                            /* capacity of the recorder, in parameter events */
+#define REC_MAX_PATHS ( 8 )                                 /* capacity of the recorder, in SOFA file paths */
+#ifndef HCROPAC_DISABLE_PROFILING                          /* profiler hooks; each mark charges the time since the previous mark to a stage */
+# define HCROPAC_PROFILE_BEGIN_FRAME(pData) hcropaclib_profileBeginFrame(pData)
+# define HCROPAC_PROFILE_MARK(pData, stage) do{ if((pData)->profActive || (pData)->traceActive) hcropaclib_profileMark((pData), (stage)); }while(0)
+# define HCROPAC_PROFILE_END_FRAME(pData) do{ if((pData)->profActive || (pData)->latActive || (pData)->traceActive) hcropaclib_profileEndFrame(pData); }while(0)
+#else
+# define HCROPAC_PROFILE_BEGIN_FRAME(pData)
+# define HCROPAC_PROFILE_MARK(pData, stage)
+# define HCROPAC_PROFILE_END_FRAME(pData)
+#endif
 
 #if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && !defined(__STDC_NO_ATOMICS__)
   typedef _Atomic HCROPAC_CH_ORDER _Atomic_HCROPAC_CH_ORDER;
@@ -109,12 +143,15 @@ typedef enum _HCROPAC_PROC_STATUS{
   typedef _Atomic HRIR_PREPROC_OPTIONS _Atomic_HRIR_PREPROC_OPTIONS;
   typedef _Atomic HCROPAC_CODEC_STATUS _Atomic_HCROPAC_CODEC_STATUS;
   typedef _Atomic HCROPAC_PROC_STATUS _Atomic_HCROPAC_PROC_STATUS;
+  typedef char* _Atomic _Atomic_HCROPAC_PATH;
+# define HCROPAC_C11_ATOMICS
 #else
   typedef HCROPAC_CH_ORDER _Atomic_HCROPAC_CH_ORDER;
   typedef HCROPAC_NORM_TYPES _Atomic_HCROPAC_NORM_TYPES;
   typedef HRIR_PREPROC_OPTIONS _Atomic_HRIR_PREPROC_OPTIONS;
   typedef HCROPAC_CODEC_STATUS _Atomic_HCROPAC_CODEC_STATUS;
   typedef HCROPAC_PROC_STATUS _Atomic_HCROPAC_PROC_STATUS;
+  typedef char* _Atomic_HCROPAC_PATH;
 #endif
     
 
@@ -122,6 +159,65 @@ typedef enum _HCROPAC_PROC_STATUS{
 /*                                 Structures                                 */
 /* ========================================================================== */
 
+/**
+ * A set of HRIRs resampled to a specific sampling rate
+ */
+typedef struct _hrirCacheEntry
+{
+    int fs;                            /* sampling rate of the set; 0 if unused */
+    int len;                           /* length of the resampled HRIRs */
+    float* hrirs;                      /* N_hrir_dirs x 2 x len */
+    
+}hrirCacheEntry;
+
+/**
+ * Tracks (threads) of the trace; see hcropaclib_writeTrace()
+ */
+typedef enum {
+    TRACE_TRACK_PROCESS = 1,           /* processing loop stages */
+    TRACE_TRACK_INIT,                  /* codec initialisation stages */
+    TRACE_TRACK_STATUS                 /* codec status transitions */
+}TRACE_TRACKS;
+
+/**
+ * A trace event, as recorded in the trace ring buffer
+ */
+typedef struct _traceEvent
+{
+    const char* name;                  /* string literal; never freed */
+    double ts_us;                      /* start time, microseconds (see hcropaclib_profileClock_us()) */
+    float dur_us;                      /* duration, microseconds; negative for instant events */
+    int track;                         /* see TRACE_TRACKS */
+    
+}traceEvent;
+
+/**
+ * A parameter event, as recorded by the recorder
+ */
+typedef struct _recEvent
+{
+    int frame;                         /* index of the frame before which the event applies */
+    int param;                         /* see HCROPAC_REC_PARAMS */
+    int index;                         /* band or path index, where applicable */
+    float value;                       /* value passed to the set function */
+    double ts_us;                      /* time since the start of the recording, microseconds */
+    
+}recEvent;
+
+/**
+ * An input frame, as recorded by the recorder
+ */
+typedef struct _recFrame
+{
+    double ts_us;                      /* time since the start of the recording, microseconds */
+    int nInputs;                       /* number of recorded input channels */
+    int nOutputs;                      /* number of output channels passed to the process call */
+    int nSamples;                      /* number of samples */
+    int sampleOffset;                  /* offset of the input signals in the sample buffer */
+    unsigned long long outputHash;     /* FNV-1a hash of the output signals */
+    
+}recFrame;
+
 /**
  * Contains variables for source DoA analysis, diffuse stream rendering, ERB
  * grouping, sofa file loading, HRTF rendering, HRTF interpolation.
@@ -129,11 +225,20 @@ typedef enum _HCROPAC_PROC_STATUS{
 typedef struct _codecPars
 {
     /* Prototype Decoder */
-    float_complex M_dec[HYBRID_BANDS][NUM_EARS][NUM_SH_SIGNALS];
-    float_complex M_dec_norm[HYBRID_BANDS][NUM_EARS][NUM_SH_SIGNALS];
+    float_complex M_dec[MAX_NUM_BANDS][NUM_EARS][NUM_SH_SIGNALS];
+    float_complex M_dec_norm[MAX_NUM_BANDS][NUM_EARS][NUM_SH_SIGNALS];
+    float_complex M_dec_fmt[MAX_NUM_BANDS][NUM_EARS][NUM_SH_SIGNALS]; /* M_dec, for input in the current channel order/normalisation */
+    float_complex M_dec_eq_fmt[MAX_NUM_BANDS][NUM_EARS][NUM_SH_SIGNALS]; /* M_dec_fmt, with the EQ applied; for the linear path */
+    
+    /* headphone compensation filter */
+    float* eqFIR;                      /* FIR from which the EQ is derived; NULL if none */
+    int eqFIR_len;                     /* length of the FIR, in samples */
+    int eqFIR_fs;                      /* sampling rate of the FIR */
     
     /* sofa file data */
-    char* sofa_filepath;               /* absolute/relevative file path for a sofa file */
+    char* sofa_filepath;               /* absolute/relevative file path for a sofa file; only changed by initCodec */
+    _Atomic_HCROPAC_PATH new_sofa_filepath; /* path passed to hcropaclib_setSofaFilePath(), awaiting hand-over to initCodec; NULL if none */
+    char* prev_sofa_filepath;          /* the path that sofa_filepath replaced; kept until the next hand-over, as it may have just been returned by the getter */
     float* hrirs;                      /* time domain HRIRs; N_hrir_dirs x 2 x hrir_len */
     float* hrir_dirs_deg;              /* directions of the HRIRs in degrees [azi elev]; N_hrir_dirs x 2 */
     int N_hrir_dirs;                   /* number of HRIR directions in the current sofa file */
@@ -141,12 +246,19 @@ typedef struct _codecPars
     int hrir_fs;                       /* sampling rate of the HRIRs, should ideally match the host sampling rate, although not required */
     int N_Tri;
     
+    /* hrirs at the host sampling rate */
+    hrirCacheEntry hrirCache[HRIR_CACHE_SIZE]; /* resampled sets */
+    int hrirCacheNext;                 /* cache entry to replace next */
+    float* hrirs_runtime;              /* points to either 'hrirs' or one of the cached sets; N_hrir_dirs x 2 x hrir_runtime_len */
+    int hrir_runtime_len;              /* length of the HRIRs at the host sampling rate */
+    int hrir_runtime_fs;               /* should match the host sampling rate */
+    
     /* hrir filterbank coefficients */
     float* itds_s;                     /* interaural-time differences for each HRIR (in seconds); N_hrirs x 1 */
-    float_complex* hrtf_fb;            /* HRTF filterbank coeffs; HYBRID_BANDS x 2 x N_hrir_dirs  */
-    float* hrtf_fb_mag;                /* abs(HRTF filterbank coeffs); HYBRID_BANDS x 2 x N_hrir_dirs */
+    float_complex* hrtf_fb;            /* HRTF filterbank coeffs; MAX_NUM_BANDS x 2 x N_hrir_dirs  */
+    float* hrtf_fb_mag;                /* abs(HRTF filterbank coeffs); MAX_NUM_BANDS x 2 x N_hrir_dirs */
 #ifdef ENABLE_BINAURAL_DIFF_COH
-    float binDiffuseCoh[HYBRID_BANDS]; /* binaural diffuse coherence per band; HYBRID_BANDS x 1 */
+    float binDiffuseCoh[MAX_NUM_BANDS]; /* binaural diffuse coherence per band; MAX_NUM_BANDS x 1 */
 #endif
     
     /* for interpolation of HRTFs */ 
@@ -158,12 +270,14 @@ typedef struct _codecPars
     int el_res;
     
     /* scanning grid */
+    int grid_icoFreq;                  /* geosphere (icosahedron) frequency of the current grid */
     float* grid_dirs_deg;              /* grid_nDirs x 2 */
     int grid_nDirs;
-    float_complex* pwdmap_cmplx;       /* TIME_SLOTS x grid_nDirs */
+    float* pwdmap;                     /* real and imaginary parts of the power-map, one row each per time slot; 2*MAX_TIME_SLOTS x grid_nDirs */
     float* Y_grid;                     /* NUM_SH_SIGNALS x grid_nDirs */
-    float_complex* Y_grid_cmplx;       /* NUM_SH_SIGNALS x grid_nDirs */
-    float_complex* M_rot;              /* grid_nDirs * NUM_SH_SIGNALS * NUM_SH_SIGNALS */
+    float* M_rot;                      /* rows 0 and 3 of the rotation matrix for each grid direction; grid_nDirs x NUM_M_ROT_ROWS x NUM_SH_SIGNALS */
+    float* Y_grid_fmt;                 /* Y_grid, for input in the current channel order/normalisation; NUM_SH_SIGNALS x grid_nDirs */
+    float* M_rot_fmt;                  /* M_rot, for input in the current channel order/normalisation; grid_nDirs x NUM_M_ROT_ROWS x NUM_SH_SIGNALS */
     
 }codecPars;
 
@@ -174,17 +288,27 @@ typedef struct _codecPars
 typedef struct _hcropaclib
 {
     /* audio buffers + afSTFT time-frequency transform handle */
-    float** SHFrameTD;
-    float** binFrameTD;
+    float** SHFrameTD;                       /* only used if the input is strided or requires conversion */
+    float** binFrameTD;                      /* only used if the output is strided, or by the FIR decoder */
+    float** SHFrameTD_rot;                   /* rotated input, for the FIR decoder */
+    void* hMatrixConv;                       /* partitioned convolution of the FIR decoder; NULL if not built */
+    void* hMatrixConv_new;                   /* FIR decoder awaiting hand-over to the processing loop (or the one it replaced); NULL if none */
+    int firLength;                           /* length of the FIR decoder filters, in samples (their modelling delay is half of this); 0 if not built */
+    int firActive;                           /* 1: the FIR decoder was used for the previous frame */
     float_complex*** SHframeTF;
     float_complex** SHframeTF_rot;
     float_complex*** ambiframeTF;
     float_complex*** binframeTF;
-    float interpolator[TIME_SLOTS];
-    void* hSTFT;                             /* afSTFT handle */
+    float interpolator[MAX_TIME_SLOTS];
+    int frameSize;                           /* current frame size, in samples */
+    int nSlots;                              /* current number of time slots per frame */
+    void* hSTFT;                             /* time-frequency transform handle; afSTFT or saf_stft, see tftBackend */
+    HCROPAC_TFT_BACKENDS tftBackend;         /* current time-frequency transform */
+    int nBands;                              /* number of bands of the current transform */
     int afSTFTdelay;                         /* for host delay compensation */
     int fs;                                  /* host sampling rate */
-    float freqVector[HYBRID_BANDS];          /* frequency vector for time-frequency transform, in Hz */
+    float freqVector[MAX_NUM_BANDS];         /* frequency vector for time-frequency transform, in Hz; nBands x 1 */
+    int nAudibleBands;                       /* number of bands below MAX_AUDIBLE_FREQ; only these undergo parametric processing */
     
     /* our codec configuration */
     _Atomic_HCROPAC_CODEC_STATUS codecStatus;
@@ -198,27 +322,94 @@ typedef struct _hcropaclib
     
     /* internal */
     _Atomic_HCROPAC_PROC_STATUS procStatus;
-    float_complex Cx[HYBRID_BANDS][NUM_SH_SIGNALS][NUM_SH_SIGNALS];
-    float_complex Cy[HYBRID_BANDS][NUM_EARS][NUM_EARS];
-    float_complex Cambi[HYBRID_BANDS][NUM_EARS][NUM_EARS];
-    float_complex new_M[HYBRID_BANDS][NUM_EARS][NUM_EARS]; 
-    float_complex current_M[HYBRID_BANDS][NUM_EARS][NUM_EARS];
+    float_complex Cx[MAX_NUM_BANDS][NUM_SH_SIGNALS][NUM_SH_SIGNALS];
+    float_complex Cy[MAX_NUM_BANDS][NUM_EARS][NUM_EARS];
+    float_complex Cambi[MAX_NUM_BANDS][NUM_EARS][NUM_EARS];
+    float_complex new_M[MAX_NUM_BANDS][NUM_EARS][NUM_EARS]; 
+    float_complex current_M[MAX_NUM_BANDS][NUM_EARS][NUM_EARS];
 #ifdef ENABLE_RESIDUAL_STREAM
-    float new_Mr[HYBRID_BANDS][NUM_EARS][NUM_EARS];
-    float current_Mr[HYBRID_BANDS][NUM_EARS][NUM_EARS];
-    float_complex decorrelatedframeTF[HYBRID_BANDS][NUM_EARS][TIME_SLOTS];
-    float_complex circBufferFrames[HYBRID_BANDS][NUM_EARS][(NUM_DECOR_FRAMES+1)*TIME_SLOTS];
-    int decorrelationDelays[HYBRID_BANDS][NUM_EARS];
-    float transientDetector1[HYBRID_BANDS][NUM_EARS];
-    float transientDetector2[HYBRID_BANDS][NUM_EARS];
+    float new_Mr[MAX_NUM_BANDS][NUM_EARS][NUM_EARS];
+    float current_Mr[MAX_NUM_BANDS][NUM_EARS][NUM_EARS];
+    float_complex decorrelatedframeTF[MAX_NUM_BANDS][NUM_EARS][MAX_TIME_SLOTS];
+    float_complex circBufferFrames[MAX_NUM_BANDS][NUM_EARS][NUM_DECOR_SLOTS+MAX_TIME_SLOTS];
+    int decorrelationDelays[MAX_NUM_BANDS][NUM_EARS];
+    float transientDetector1[MAX_NUM_BANDS][NUM_EARS];
+    float transientDetector2[MAX_NUM_BANDS][NUM_EARS];
 #endif
-    float_complex M_rot[NUM_SH_SIGNALS][NUM_SH_SIGNALS];
+    float M_rot[NUM_SH_SIGNALS][NUM_SH_SIGNALS];     /**< scene rotation matrix, for input in the current channel order/normalisation */
+    float M_rot_acn[NUM_SH_SIGNALS][NUM_SH_SIGNALS]; /**< scene rotation matrix, for ACN/N3D signals */
+    int fmtPerm[NUM_SH_SIGNALS];                     /**< input channel index of each ACN channel */
+    float fmtGain[NUM_SH_SIGNALS];                   /**< gain converting each ACN channel of the input to N3D */
+    float energyWeights[NUM_SH_SIGNALS];             /**< per input channel weights giving the N3D signal energy */
+    float cropacEnergyWeights[NUM_SH_SIGNALS];       /**< per input channel weights giving the CroPaC normalisation energy */
     _Atomic_INT32 recalc_M_rotFLAG;                  /**< 0: no init required, 1: init required */
+    _Atomic_INT32 recalc_fmtFLAG;                    /**< 1: the input format tables are to be rebuilt, 0: not required */
+    _Atomic_INT32 recalc_EQFLAG;                     /**< 1: the EQ'd linear decoder is to be rebuilt, 0: not required */
+    _Atomic_INT32 reinitEQFLAG;                      /**< 1: the EQ is to be (re)derived from the FIR by initCodec, 0: not required */
+    _Atomic_INT32 reinitFIRFLAG;                     /**< 1: the FIR decoder is to be (re)built by initCodec, 0: not required */
+    _Atomic_INT32 firSwapFLAG;                       /**< 1: hMatrixConv_new is to replace hMatrixConv at the start of the next frame, 0: not required */
+    _Atomic_INT32 firRebuildingFLAG;                 /**< 1: the FIR decoder is being rebuilt while the codec remains initialised, 0: not */
+    _Atomic_INT32 reinitHRIRsFLAG;                   /**< 1: HRIRs are to be (re)loaded by initCodec, 0: not required */
+    _Atomic_INT32 reinitHRTFsFLAG;                   /**< 1: HRTFs and the prototype decoder are to be (re)computed by initCodec, 0: not required */
+    _Atomic_FLOAT32 gridMaxError_deg;                /**< worst-case DoA quantisation error of the scanning grid, degrees */
+    _Atomic_FLOAT32 gridMeanError_deg;               /**< mean DoA quantisation error of the scanning grid, degrees */
+    int gateHangoverCounter;                         /**< frames remaining until the silence gate closes */
+    int gateClosed;                                  /**< 1: silence gate was closed for the previous frame */
+    _Atomic_INT32 nGatedFrames;                      /**< number of frames skipped by the silence gate */
+    _Atomic_INT32 nProcessedFrames;                  /**< number of frames passed to the processing loop */
+    _Atomic_INT32 nAnalysedBands;                    /**< number of bands eligible for CroPaC analysis */
+    _Atomic_INT32 nSkippedBands;                     /**< number of those bands skipped by band-sparse processing */
+    _Atomic_INT32 nAnalysedSlots;                    /**< number of time-frequency tiles that underwent CroPaC analysis */
+    _Atomic_INT32 nDiffuseSlots;                     /**< number of those tiles with zero CroPaC gain */
+    _Atomic_INT32 nDiffuseBands;                     /**< number of analysed bands with zero CroPaC gain for all time slots */
+    hcropaclib_metadata metadata;                    /**< CroPaC analysis metadata of the previous frame */
+    int analysisActive;                              /**< 1: the previous frame was processed in analysis-only mode */
+    hcropaclib_metadata renderMetadata;              /**< transmitted metadata to render the next frame with */
+    int renderMetadataPending;                       /**< 1: renderMetadata is to be used for the next frame */
+    int profActive;                                  /**< 1: the current frame is being profiled */
+    double profMark_us;                              /**< time of the previous profiler mark, microseconds */
+    double profFrameStart_us;                        /**< time the current frame started, microseconds */
+    double profStageSum_us[HCROPAC_PROFILE_NUM_STAGES]; /**< accumulated processing time of each stage, microseconds */
+    double profFrameSum_us;                          /**< accumulated processing time, microseconds */
+    float profFrameMax_us;                           /**< worst-case processing time of a frame, microseconds */
+    int profNFrames;                                 /**< number of profiled frames */
+    _Atomic_INT32 resetProfileFLAG;                  /**< 1: the profiler statistics are to be reset before the next frame */
+    _Atomic_INT32 profile_nFrames;                   /**< published statistics (see hcropaclib_profile) */
+    _Atomic_FLOAT32 profile_frameMean_us;
+    _Atomic_FLOAT32 profile_frameMax_us;
+    _Atomic_FLOAT32 profile_cpuLoad;
+    _Atomic_FLOAT32 profile_stageMean_us[HCROPAC_PROFILE_NUM_STAGES];
+    int latActive;                                   /**< 1: the current frame is being timed for the latency statistics */
+    _Atomic_INT32 resetLatencyFLAG;                  /**< 1: the latency statistics are to be reset before the next frame */
+    _Atomic_INT32 latencyHist[LATENCY_NUM_BUCKETS];  /**< histogram of the processing time per frame; see LATENCY_BUCKETS_PER_OCTAVE */
+    _Atomic_INT32 latency_nFrames;                   /**< number of timed frames */
+    _Atomic_INT32 latency_nMisses;                   /**< number of those frames that missed the deadline */
+    _Atomic_FLOAT32 latency_max_us;                  /**< worst-case processing time of a frame, microseconds */
+    traceEvent* traceEvents;                         /**< trace ring buffer; TRACE_NUM_EVENTS x 1, allocated when tracing is first enabled, and only freed by hcropaclib_destroy() */
+    _Atomic_INT32 traceWriteIdx;                     /**< number of events recorded since the trace was last cleared */
+    int traceActive;                                 /**< 1: the current frame is being traced */
+    recEvent* recEvents;                             /**< recorded parameter events; REC_NUM_EVENTS x 1 */
+    recFrame* recFrames;                             /**< recorded frames; recMaxFrames x 1 */
+    float* recSamples;                               /**< recorded input signals; recMaxSamples x 1 */
+    char* recPaths[REC_MAX_PATHS];                   /**< recorded SOFA file paths */
+    int recMaxFrames;                                /**< capacity of recFrames */
+    int recMaxSamples;                               /**< capacity of recSamples */
+    int recNSamples;                                 /**< number of samples recorded; only written by the processing thread */
+    int recFs;                                       /**< sample rate at the start of the recording */
+    double recStart_us;                              /**< time the recording started, microseconds */
+    _Atomic_INT32 recNEvents;                        /**< number of parameter events recorded (may exceed REC_NUM_EVENTS once full) */
+    _Atomic_INT32 recNFrames;                        /**< number of frames recorded; the frame index of parameter events */
+    _Atomic_INT32 recNPaths;                         /**< number of SOFA file paths recorded */
+    _Atomic_INT32 recorderState;                     /**< see HCROPAC_RECORDER_STATES */
+    _Atomic_FLOAT32 recLastValue[HCROPAC_REC_NUM_PARAMS]; /**< last value passed to each (non-banded) set function; NAN if never called */
     
     /* user parameters */
     _Atomic_INT32 enableCroPaC;                      /**< 0: Ambisonic decoder, 1: CroPaC decoder */
-    _Atomic_FLOAT32 EQ[HYBRID_BANDS];                /**< EQ curve */
-    _Atomic_FLOAT32 balance[HYBRID_BANDS];           /**< 0: only diffuse, 1: equal, 2: only directional */
+    _Atomic_INT32 linearDecoderMode;                 /**< see HCROPAC_LINEAR_DECODER_MODES */
+    _Atomic_INT32 new_frameSize;                     /**< frame size to use after the next codec initialisation, in samples */
+    _Atomic_INT32 new_tftBackend;                    /**< time-frequency transform to use after the next codec initialisation */
+    _Atomic_FLOAT32 EQ[MAX_NUM_BANDS];                /**< EQ curve; linear gain per band */
+    _Atomic_FLOAT32 balance[MAX_NUM_BANDS];           /**< 0: only diffuse, 1: equal, 2: only directional */
     _Atomic_INT32 diffCorrection;                    /**< 0:disabled, 1: enabled */
     _Atomic_HRIR_PREPROC_OPTIONS hrirProcMode;       /**< see HRIR_PREPROC_OPTIONS */
     _Atomic_INT32 useDefaultHRIRsFLAG;               /**< 1: use default HRIRs in database, 0: use those from SOFA file */
@@ -226,10 +417,22 @@ typedef struct _hcropaclib
     _Atomic_HCROPAC_NORM_TYPES norm;                 /**< N3D or SN3D */
     _Atomic_FLOAT32 covAvgCoeff;                     /**< averaging coefficient for covarience matrix */
     _Atomic_FLOAT32 anaLimit_hz;                     /**< frequency up to which to perform CroPaC analysis, Hz */
+    _Atomic_INT32 gridIcoFreq;                       /**< geosphere (icosahedron) frequency of the scanning grid */
     _Atomic_INT32 enableRotation;                    /**< 1: enable rotation, 0: disable */
     _Atomic_FLOAT32 yaw, roll, pitch;                /**< rotation angles in degrees */
     _Atomic_INT32 bFlipYaw, bFlipPitch, bFlipRoll;   /**< flag to flip the sign of the individual rotation angles */
     _Atomic_INT32 useRollPitchYawFlag;               /**< rotation order flag, 1: r-p-y, 0: y-p-r */
+    _Atomic_INT32 enableGate;                        /**< 1: enable silence gate, 0: disable */
+    _Atomic_FLOAT32 gateThreshold_dB;                /**< input energy below which frames are gated, dB */
+    _Atomic_FLOAT32 gateHangover_ms;                 /**< time to keep processing after the input drops below the threshold, ms */
+    _Atomic_INT32 enableBandSkipping;                /**< 1: skip the analysis of low energy bands, 0: disable */
+    _Atomic_INT32 enableAnalysisOnly;                /**< 1: only perform the CroPaC analysis, 0: full decoding */
+    _Atomic_INT32 enableProfiling;                   /**< 1: enable the profiler, 0: disable */
+    _Atomic_INT32 enableLatencyStats;                /**< 1: enable the latency statistics, 0: disable */
+    _Atomic_INT32 enableTracing;                     /**< 1: record trace events, 0: disable */
+    _Atomic_FLOAT32 deadlineFraction;                /**< fraction of the frame period beyond which a frame misses its deadline */
+    _Atomic_FLOAT32 bandSkipFloor_dB;                /**< band energy floor, relative to the most energetic band, dB */
+    _Atomic_FLOAT32 recordingLength_s;               /**< capacity of the next recording, seconds */
     
 } hcropaclib_data;
 
@@ -245,12 +448,581 @@ void hcropaclib_setCodecStatus(void* const hCroPaC,
                                HCROPAC_CODEC_STATUS newStatus);
 
 /**
- * Interpolate HRTFs for each time slot */
+ * Atomically replaces a file path pointer, and returns the previous one (which
+ * the caller then owns)
+ */
+char* hcropaclib_exchangePath(_Atomic_HCROPAC_PATH* path,
+                              char* newPath);
+
+/**
+ * Processes one frame of audio (see hcropaclib_process()), reading the input and
+ * writing the output channels with the given sample strides (1: contiguous).
+ * Contiguous inputs are passed to the time-frequency transform directly, in
+ * whichever channel order/normalisation they arrive (see
+ * hcropaclib_initInputFormat()), and contiguous outputs are written by the
+ * inverse transform directly.
+ */
+void hcropaclib_processFrame(void* const hCroPaC,
+                             const float* const* inputs,
+                             int inSampleStride,
+                             float* const* outputs,
+                             int outSampleStride,
+                             int nInputs,
+                             int nOutputs,
+                             int nSamples);
+
+/**
+ * Applies any pending input format or EQ changes to the processing tables;
+ * called at the start of every processed frame
+ */
+void hcropaclib_applyPendingUpdates(void* const hCroPaC);
+
+/**
+ * Processes the time-frequency frame currently held in 'SHframeTF' (rotation,
+ * linear decoding, CroPaC analysis and mixing), and returns the binaural
+ * time-frequency frame: 'binframeTF' if CroPaC is enabled, or 'ambiframeTF'
+ * otherwise; nBands x NUM_EARS x MAX_TIME_SLOTS
+ *
+ * @param[in] hCroPaC      hcropaclib handle
+ * @param[in] analysisOnly 1: analysis-only mode, as latched for this frame (see
+ *                         hcropaclib_updateAnalysisOnlyState())
+ *
+ * @note 'SHframeTF' is overwritten with its rotated version. In analysis-only
+ *       mode, only the metadata is updated and NULL is returned.
+ */
+float_complex*** hcropaclib_processFrameTF(void* const hCroPaC,
+                                           int analysisOnly);
+
+/**
+ * Returns the channel permutation and gains that convert the input from the
+ * given channel order and normalisation convention to ACN/N3D
+ *
+ * @param[in]  chOrdering Input channel order convention
+ * @param[in]  norm       Input normalisation convention
+ * @param[out] perm       Input channel index for each ACN channel;
+ *                        NUM_SH_SIGNALS x 1
+ * @param[out] gain       Gain to apply to each ACN channel; NUM_SH_SIGNALS x 1
+ */
+void hcropaclib_getInputConversion(HCROPAC_CH_ORDER chOrdering,
+                                   HCROPAC_NORM_TYPES norm,
+                                   int perm[NUM_SH_SIGNALS],
+                                   float gain[NUM_SH_SIGNALS]);
+
+/**
+ * Folds the current input channel order and normalisation convention into the
+ * prototype decoder, scanning grid and energy weights (M_dec_fmt, Y_grid_fmt,
+ * M_rot_fmt, energyWeights, cropacEnergyWeights), so that the input may be
+ * processed without conversion. The scene rotation matrix is flagged for
+ * recomputation.
+ */
+void hcropaclib_initInputFormat(void* const hCroPaC);
+
+/**
+ * Creates the time-frequency transform given by 'tftBackend', and sets 'nBands'
+ */
+void hcropaclib_tftCreate(void* const hCroPaC);
+
+/**
+ * Destroys the current time-frequency transform
+ */
+void hcropaclib_tftDestroy(void* const hCroPaC);
+
+/**
+ * Applies the forward time-frequency transform
+ *
+ * @param[in]  hCroPaC   hcropaclib handle
+ * @param[in]  inTD      Input; NUM_SH_SIGNALS x frameSize
+ * @param[in]  frameSize Frame size, in samples (multiple of HOP_SIZE)
+ * @param[out] outTF     Output; nBands x NUM_SH_SIGNALS x frameSize/HOP_SIZE
+ */
+void hcropaclib_tftForward(void* const hCroPaC,
+                           float** inTD,
+                           int frameSize,
+                           float_complex*** outTF);
+
+/**
+ * Applies the backward time-frequency transform
+ *
+ * @param[in]  hCroPaC   hcropaclib handle
+ * @param[in]  inTF      Input; nBands x NUM_EARS x frameSize/HOP_SIZE
+ * @param[in]  frameSize Frame size, in samples (multiple of HOP_SIZE)
+ * @param[out] outTD     Output; NUM_EARS x frameSize
+ */
+void hcropaclib_tftBackward(void* const hCroPaC,
+                            float_complex*** inTF,
+                            int frameSize,
+                            float** outTD);
+
+/**
+ * Clears the internal buffers of the time-frequency transform
+ */
+void hcropaclib_tftClearBuffers(void* const hCroPaC);
+
+/**
+ * Returns the centre frequencies of the bands of the current time-frequency
+ * transform, in Hz; nBands x 1
+ */
+void hcropaclib_tftGetCentreFreqs(void* const hCroPaC,
+                                  float fs,
+                                  float* freqVector);
+
+/**
+ * Returns the processing delay of the given time-frequency transform, in
+ * samples
+ */
+int hcropaclib_tftGetDelay(HCROPAC_TFT_BACKENDS tftBackend);
+
+/**
+ * Converts HRIRs to HRTFs for the bands of the current time-frequency transform
+ *
+ * @param[in]  hCroPaC  hcropaclib handle
+ * @param[in]  hrirs    HRIRs; N_dirs x NUM_EARS x hrir_len
+ * @param[in]  N_dirs   Number of HRIRs
+ * @param[in]  hrir_len Length of the HRIRs, in samples
+ * @param[out] hrtfs    HRTFs; nBands x NUM_EARS x N_dirs
+ */
+void hcropaclib_tftHRIRs2HRTFs(void* const hCroPaC,
+                               float* hrirs,
+                               int N_dirs,
+                               int hrir_len,
+                               float_complex* hrtfs);
+
+/**
+ * Computes the band centre frequencies of the current time-frequency transform
+ * at the host sampling rate, and the number of bands below MAX_AUDIBLE_FREQ
+ */
+void hcropaclib_initFrequencies(void* const hCroPaC);
+
+/**
+ * Zeros the covariance matrices, mixing matrices and detector states
+ */
+void hcropaclib_resetProcessingState(void* const hCroPaC);
+
+/**
+ * Tracks the analysis-only mode of the frame about to be processed. On leaving
+ * it, the synthesis state is reset, and the TFT buffers are cleared (as the
+ * inverse TFT has not been run since); called once per frame, before the
+ * forward TFT
+ *
+ * @param[in] hCroPaC      hcropaclib handle
+ * @param[in] analysisOnly 1: this frame is processed in analysis-only mode
+ * @param[in] clearTFT     1: the TFT is owned by hcropaclib, 0: by the caller
+ *                         (hcropaclib_processTF())
+ */
+void hcropaclib_updateAnalysisOnlyState(void* const hCroPaC,
+                                        int analysisOnly,
+                                        int clearTFT);
+
+/**
+ * Computes the scene rotation matrix (M_rot) from the current yaw-pitch-roll
+ * angles, for input in the current channel order/normalisation
+ *
+ * @note Called from the processing loop, and therefore does not allocate
+ */
+void hcropaclib_calcRotationMatrix(void* const hCroPaC);
+
+/**
+ * Returns the spherical harmonic steering vectors for a given direction, as
+ * used in place of the scanning grid tables when rendering from transmitted
+ * metadata
+ *
+ * @param[in]     hCroPaC       hcropaclib handle
+ * @param[in]     applyRotation 1: apply the scene rotation (M_rot_acn) to the
+ *                              direction, 0: do not
+ * @param[in,out] azi_deg       Azimuth, degrees; rotated if 'applyRotation'
+ * @param[in,out] elev_deg      Elevation, degrees; rotated if 'applyRotation'
+ * @param[out]    y             Steering vector in ACN/N3D; NUM_SH_SIGNALS x 1
+ * @param[out]    y_fmt         Steering vector in the current channel
+ *                              order/normalisation; NUM_SH_SIGNALS x 1
+ */
+void hcropaclib_getSteeringVectors(void* const hCroPaC,
+                                   int applyRotation,
+                                   float* azi_deg,
+                                   float* elev_deg,
+                                   float* y,
+                                   float* y_fmt);
+
+/**
+ * Flags the FIR linear decoder for rebuilding (the input format and EQ are
+ * folded into the filters). The codec status is left as is; the current filters
+ * remain in use until hcropaclib_initCodec() has rebuilt them
+ */
+void hcropaclib_requestFIRDecoderRebuild(void* const hCroPaC);
+
+/**
+ * Builds the FIR linear decoder: the MagLS decoder is computed at uniformly
+ * spaced frequencies, the input format and EQ are folded in, and the result is
+ * converted to a bank of NUM_EARS x NUM_SH_SIGNALS FIRs. The responses (and
+ * their linear-phase ITDs) are centred on a modelling delay of half the filter
+ * length, so that they are causal, and the filter ends are tapered. The FIRs
+ * are applied with uniformly partitioned convolution, using the current frame
+ * size as the partition length. The convolver is built into hMatrixConv_new, which the
+ * caller then hands over to the processing loop by setting firSwapFLAG
+ *
+ * @note Must not be called while firSwapFLAG is set and frames are being
+ *       processed
+ */
+void hcropaclib_initFIRDecoder(void* const hCroPaC);
+
+/**
+ * Rebuilds the FIR linear decoder while the codec remains initialised, and
+ * hands it over to the processing loop (which keeps rendering with the previous
+ * filters in the meantime); called by hcropaclib_initCodec()
+ */
+void hcropaclib_rebuildFIRDecoder(void* const hCroPaC);
+
+/**
+ * Builds the linear decoder with the EQ applied (M_dec_eq_fmt), from M_dec_fmt
+ * and the current EQ curve
+ */
+void hcropaclib_initEQDecoder(void* const hCroPaC);
+
+/**
+ * Evaluates the magnitude response of an FIR filter at the filterbank centre
+ * frequencies
+ *
+ * @param[in]  fir        FIR filter; firLen x 1
+ * @param[in]  firLen     Length of the FIR filter, in samples
+ * @param[in]  fir_fs     Sampling rate of the FIR filter
+ * @param[in]  freqVector Filterbank centre frequencies, in Hz; nBands x 1
+ * @param[in]  nBands     Number of bands
+ * @param[out] eq         Magnitude response per band; nBands x 1
+ */
+void hcropaclib_getEQfromFIR(const float* fir,
+                             int firLen,
+                             int fir_fs,
+                             const float* freqVector,
+                             int nBands,
+                             float* eq);
+
+/**
+ * Zeros output channels with the given sample stride
+ */
+void hcropaclib_zeroOutputs(float* const* outputs,
+                            int outSampleStride,
+                            int nOutputs,
+                            int nSamples);
+
+/**
+ * Loads the HRIRs (from the SOFA file, or the defaults), and clears the cache
+ * of resampled HRIR sets
+ */
+void hcropaclib_loadHRIRs(void* const hCroPaC);
+
+/**
+ * Points 'hrirs_runtime' to a set of HRIRs at the host sampling rate; resampling
+ * the loaded HRIRs only if this rate is not already in the cache
+ */
+void hcropaclib_resampleHRIRs(void* const hCroPaC);
+
+/**
+ * Converts the HRIRs (at the host sampling rate) to filterbank coefficients,
+ * and computes the HRTF interpolation table and the prototype (Mag-LS) decoder
+ */
+void hcropaclib_initHRTFsAndDecoder(void* const hCroPaC);
+
+/**
+ * (Re)computes the scanning grid and the tables derived from it (steering
+ * vectors, grid rotations), along with its DoA quantisation error
+ */
+void hcropaclib_initScanningGrid(void* const hCroPaC);
+
+/**
+ * Measures the DoA quantisation error of a scanning grid, as the angle between
+ * each of GRID_ERROR_NUM_REF_DIRS quasi-uniformly distributed reference
+ * directions and its nearest grid direction
+ *
+ * @param[in]  grid_dirs_deg Grid directions in degrees [azi elev]; nDirs x 2
+ * @param[in]  nDirs         Number of grid directions
+ * @param[out] maxError_deg  Worst-case error, degrees
+ * @param[out] meanError_deg Mean error, degrees
+ */
+void hcropaclib_computeGridQuantisationError(float* grid_dirs_deg,
+                                             int nDirs,
+                                             float* maxError_deg,
+                                             float* meanError_deg);
+
+/**
+ * Interpolate HRTFs for the first 'nSlots' time slots */
 void hcropaclib_interpHRTFs(void* const hCroPaC,
                             int band,
-                            float secAzi[TIME_SLOTS],
-                            float secElev[TIME_SLOTS],
-                            float_complex h_intrp[TIME_SLOTS][NUM_EARS]);
+                            int nSlots,
+                            float secAzi[MAX_TIME_SLOTS],
+                            float secElev[MAX_TIME_SLOTS],
+                            float_complex h_intrp[MAX_TIME_SLOTS][NUM_EARS]);
+
+/**
+ * Real-by-complex matrix multiplication, C = A*B, where A is real and B and C
+ * are complex (all row-major).
+ *
+ * Since B and C are stored as interleaved real/imaginary pairs, this amounts
+ * to a single real matrix multiplication with twice the number of columns.
+ *
+ * @param[in]  M   Number of rows in A and C
+ * @param[in]  N   Number of columns in B and C
+ * @param[in]  K   Number of columns in A and rows in B
+ * @param[in]  A   Real matrix; M x K
+ * @param[in]  B   Complex matrix; K x N
+ * @param[in]  ldb Leading dimension of B (in complex elements)
+ * @param[out] C   Complex matrix; M x N
+ * @param[in]  ldc Leading dimension of C (in complex elements)
+ */
+void hcropaclib_rcgemm(int M,
+                       int N,
+                       int K,
+                       const float* A,
+                       const float_complex* B,
+                       int ldb,
+                       float_complex* C,
+                       int ldc);
+
+/**
+ * Computes the power-map of the input SH signals over a real-valued scanning
+ * grid, and returns the index of the grid direction with the largest response
+ * for each time slot
+ *
+ * The largest response is taken as the largest |re|+|im| (the same metric as
+ * cblas_icamax).
+ *
+ * @param[in]  inTF        Input SH signals; NUM_SH_SIGNALS x MAX_TIME_SLOTS
+ * @param[in]  nSlots      Number of time slots to analyse
+ * @param[in]  Y_grid      Real SH steering vectors; NUM_SH_SIGNALS x nDirs
+ * @param[in]  nDirs       Number of grid directions
+ * @param[out] pwdmap      Power-map (real and imaginary parts, one row each
+ *                         per time slot); 2*nSlots x nDirs
+ * @param[out] dir_max_idx Grid index of the peak for each time slot;
+ *                         nSlots x 1
+ */
+void hcropaclib_powermapArgmax(const float_complex* inTF,
+                               int nSlots,
+                               const float* Y_grid,
+                               int nDirs,
+                               float* pwdmap,
+                               int dir_max_idx[MAX_TIME_SLOTS]);
+
+/**
+ * Applies the scene rotation (M_rot) to 'SHframeTF', in-place
+ */
+void hcropaclib_rotateFrameTF(void* const hCroPaC,
+                              int nBands,
+                              int nSlots);
+
+/**
+ * Applies the linear decoder to 'SHframeTF', giving the prototype signals
+ * ('ambiframeTF'), and feeds the audible bands through the decorrelator delay
+ * lines
+ *
+ * @param[in] hCroPaC       hcropaclib handle
+ * @param[in] nBands        Number of bands
+ * @param[in] nAudibleBands Number of bands undergoing parametric processing
+ * @param[in] nSlots        Number of time slots
+ * @param[in] enableCroPaC  1: the EQ is left to the mixing matrices for the
+ *                          audible bands, 0: EQ'd decoder for all bands
+ */
+void hcropaclib_decodeFrameTF(void* const hCroPaC,
+                              int nBands,
+                              int nAudibleBands,
+                              int nSlots,
+                              int enableCroPaC);
+
+/**
+ * Updates the temporally averaged input (Cx) and, optionally, prototype
+ * (Cambi) covariance matrices
+ *
+ * @param[in]  hCroPaC         hcropaclib handle
+ * @param[in]  nBands          Number of bands to update
+ * @param[in]  nSlots          Number of time slots
+ * @param[in]  covAvgCoeff     Averaging coefficient for this frame size
+ * @param[in]  updatePrototype 1: also update Cambi, 0: only Cx
+ * @param[out] bandEnergy      Instantaneous input energy per band; nBands x 1
+ * @returns The largest of the band energies
+ */
+float hcropaclib_updateCovariances(void* const hCroPaC,
+                                   int nBands,
+                                   int nSlots,
+                                   float covAvgCoeff,
+                                   int updatePrototype,
+                                   float* bandEnergy);
+
+/**
+ * Returns the CroPaC gain of one time-frequency tile
+ *
+ * @param[in] inputFrame_s Input SH signals of the tile; NUM_SH_SIGNALS x 1
+ * @param[in] M_rot_dir    Rotation rows of the DoA (see codecPars.M_rot_fmt);
+ *                         NUM_M_ROT_ROWS x NUM_SH_SIGNALS
+ * @param[in] inputEnergy  CroPaC normalisation energy of the tile
+ */
+float hcropaclib_cropacGain(const float_complex* inputFrame_s,
+                            const float* M_rot_dir,
+                            float inputEnergy);
+
+/**
+ * Computes the CroPaC normalisation energy of each time slot of one band of
+ * 'SHframeTF', and (if the DoAs are given) the CroPaC gain of each slot
+ *
+ * @param[in]  hCroPaC     hcropaclib handle
+ * @param[in]  band        Band index
+ * @param[in]  nSlots      Number of time slots
+ * @param[in]  dir_max_idx Scanning grid index of the DoA per slot; nSlots x 1,
+ *                         or NULL to only compute the energies
+ * @param[out] inputEnergy CroPaC normalisation energy per slot; nSlots x 1
+ * @param[out] G           CroPaC gain per slot (not written if dir_max_idx is
+ *                         NULL); nSlots x 1
+ */
+void hcropaclib_cropacGainsBand(void* const hCroPaC,
+                                int band,
+                                int nSlots,
+                                const int* dir_max_idx,
+                                float* inputEnergy,
+                                float* G);
+
+/**
+ * Formulates the optimal mixing matrix of one band ('new_M'), which brings the
+ * prototype covariance matrix ('Cambi') to the target ('Cy'), along with the
+ * mixing matrix of the residual ('new_Mr'), if enabled
+ */
+void hcropaclib_formulateMixingMatrices(void* const hCroPaC,
+                                        int band);
+
+#ifdef ENABLE_RESIDUAL_STREAM
+/**
+ * Suppresses transients in the most recent slots of the decorrelator delay
+ * lines
+ */
+void hcropaclib_transientDetector(void* const hCroPaC,
+                                  int nBands,
+                                  int nSlots);
+#endif
+
+/**
+ * Applies the (temporally interpolated) mixing matrices, with the EQ folded
+ * in, to the prototype and decorrelated signals, giving 'binframeTF'
+ *
+ * @param[in] hCroPaC hcropaclib handle
+ * @param[in] nBands  Number of bands to mix
+ * @param[in] nSlots  Number of time slots
+ * @param[in] eq      EQ per band; nBands x 1
+ */
+void hcropaclib_mixFrameTF(void* const hCroPaC,
+                           int nBands,
+                           int nSlots,
+                           const float* eq);
+
+/**
+ * Returns the time of a monotonic clock, in microseconds
+ */
+double hcropaclib_profileClock_us(void);
+
+/**
+ * Starts profiling/timing a frame if the profiler and/or latency statistics are
+ * enabled, first applying any pending resets (use HCROPAC_PROFILE_BEGIN_FRAME)
+ */
+void hcropaclib_profileBeginFrame(void* const hCroPaC);
+
+/**
+ * Charges the time elapsed since the previous mark to a stage of the
+ * processing loop (use HCROPAC_PROFILE_MARK)
+ *
+ * @param[in] hCroPaC hcropaclib handle
+ * @param[in] stage   See 'HCROPAC_PROFILE_STAGES' enum
+ */
+void hcropaclib_profileMark(void* const hCroPaC,
+                            HCROPAC_PROFILE_STAGES stage);
+
+/**
+ * Completes the profiled/timed frame, and publishes the updated statistics (use
+ * HCROPAC_PROFILE_END_FRAME)
+ */
+void hcropaclib_profileEndFrame(void* const hCroPaC);
+
+/**
+ * Records an event into the trace ring buffer, if tracing is enabled; lock-free
+ * and never allocates, so may be called from any thread
+ *
+ * @param[in] hCroPaC  hcropaclib handle
+ * @param[in] track    See 'TRACE_TRACKS' enum
+ * @param[in] name     Event name; must be a string literal
+ * @param[in] start_us Start time, microseconds (see hcropaclib_profileClock_us())
+ * @param[in] dur_us   Duration, microseconds; negative for instant events
+ */
+void hcropaclib_traceEvent(void* const hCroPaC,
+                           TRACE_TRACKS track,
+                           const char* name,
+                           double start_us,
+                           float dur_us);
+
+/**
+ * Records the event spanning from 'mark_us' until now, and advances 'mark_us'
+ * to now; for tracing consecutive stages, e.g. of hcropaclib_initCodec()
+ *
+ * @param[in]     hCroPaC hcropaclib handle
+ * @param[in]     track   See 'TRACE_TRACKS' enum
+ * @param[in]     name    Event name; must be a string literal
+ * @param[in,out] mark_us Time the stage started, microseconds
+ */
+void hcropaclib_traceStage(void* const hCroPaC,
+                           TRACE_TRACKS track,
+                           const char* name,
+                           double* mark_us);
+
+/**
+ * Records a call of a set function, if recording; lock-free and never
+ * allocates, so may be called from any thread. Should be called before the set
+ * function has any effect (i.e. before any set functions it calls in turn).
+ *
+ * @param[in] hCroPaC hcropaclib handle
+ * @param[in] param   See 'HCROPAC_REC_PARAMS' enum
+ * @param[in] index   Band or path index, where applicable; otherwise -1
+ * @param[in] value   Value passed to the set function
+ */
+void hcropaclib_recordParam(void* const hCroPaC,
+                            HCROPAC_REC_PARAMS param,
+                            int index,
+                            float value);
+
+/**
+ * Records a call of hcropaclib_setSofaFilePath(), if recording (not for the
+ * processing thread, as the path is copied); recording stops if the path table
+ * is full
+ */
+void hcropaclib_recordPath(void* const hCroPaC,
+                           const char* path);
+
+/**
+ * Starts the armed recording; (re)allocates the recording buffer, clears the
+ * transform and FIR decoder buffers, and records the current parameters.
+ * Called by hcropaclib_init(), after resetting the processing state.
+ */
+void hcropaclib_recordStart(void* const hCroPaC);
+
+/**
+ * Records the input frame of a process call, if recording
+ *
+ * @returns Index of the recorded frame (for hcropaclib_recordFrameEnd()), or -1
+ */
+int hcropaclib_recordFrameBegin(void* const hCroPaC,
+                                const float* const* inputs,
+                                int inSampleStride,
+                                int nInputs,
+                                int nOutputs,
+                                int nSamples);
+
+/**
+ * Records the hash of the output of a process call
+ *
+ * @param[in] hCroPaC         hcropaclib handle
+ * @param[in] frame           Index returned by hcropaclib_recordFrameBegin()
+ * @param[in] outputs         Output signals
+ * @param[in] outSampleStride Distance between consecutive samples of a channel
+ * @param[in] nOutputs        Number of output channels
+ * @param[in] nSamples        Number of samples
+ */
+void hcropaclib_recordFrameEnd(void* const hCroPaC,
+                               int frame,
+                               float* const* outputs,
+                               int outSampleStride,
+                               int nOutputs,
+                               int nSamples);
 
     
 #ifdef __cplusplus
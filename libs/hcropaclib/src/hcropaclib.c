@@ -52,11 +52,12 @@ void hcropaclib_create
 {
     hcropaclib_data* pData = (hcropaclib_data*)malloc1d(sizeof(hcropaclib_data));
     *phCroPaC = (void*)pData;
-    int band;
+    int i, band;
 
     /* default user parameters */
     pData->enableCroPaC = 1;
-    for (band = 0; band<HYBRID_BANDS; band++){
+    pData->linearDecoderMode = LINEAR_DECODER_STFT;
+    for (band = 0; band<MAX_NUM_BANDS; band++){
         pData->EQ[band] = 1.0f;
         pData->balance[band] = 1.0f;
     }
@@ -67,6 +68,7 @@ void hcropaclib_create
     pData->hrirProcMode = HRIR_PREPROC_ALL;
     pData->covAvgCoeff = 0.75f;
     pData->anaLimit_hz = 18e3f;
+    pData->gridIcoFreq = HCROPAC_GRID_DENSITY_DEFAULT_VALUE;
     pData->enableRotation = 0;
     pData->yaw = 0.0f;
     pData->pitch = 0.0f;
@@ -75,15 +77,41 @@ void hcropaclib_create
     pData->bFlipPitch = 0;
     pData->bFlipRoll = 0;
     pData->useRollPitchYawFlag = 0;
+    pData->enableGate = 0;
+    pData->gateThreshold_dB = -90.0f;
+    pData->gateHangover_ms = 500.0f;
+    pData->enableBandSkipping = 0;
+    pData->enableAnalysisOnly = 0;
+    pData->enableProfiling = 0;
+    pData->enableLatencyStats = 0;
+    pData->enableTracing = 0;
+    pData->deadlineFraction = 1.0f;
+    pData->bandSkipFloor_dB = -60.0f;
+    pData->recordingLength_s = HCROPAC_RECORDING_LENGTH_DEFAULT;
+    pData->new_frameSize = HCROPAC_FRAME_SIZE_DEFAULT;
     
-    /* afSTFT stuff */
-    afSTFT_create(&(pData->hSTFT), NUM_SH_SIGNALS, NUM_EARS, HOP_SIZE, 0, 1, AFSTFT_BANDS_CH_TIME);
-    pData->SHFrameTD = (float**)malloc2d(NUM_SH_SIGNALS, FRAME_SIZE, sizeof(float));
-    pData->binFrameTD = (float**)malloc2d(NUM_EARS, FRAME_SIZE, sizeof(float));
-    pData->SHframeTF = (float_complex***)malloc3d(HYBRID_BANDS, NUM_SH_SIGNALS, TIME_SLOTS, sizeof(float_complex));
-    pData->SHframeTF_rot = (float_complex**)malloc2d(NUM_SH_SIGNALS, TIME_SLOTS, sizeof(float_complex));
-    pData->ambiframeTF = (float_complex***)malloc3d(HYBRID_BANDS, NUM_EARS, TIME_SLOTS, sizeof(float_complex));
-    pData->binframeTF= (float_complex***)malloc3d(HYBRID_BANDS, NUM_EARS, TIME_SLOTS, sizeof(float_complex));
+    /* time-frequency transform */
+    pData->frameSize = pData->new_frameSize;
+    pData->nSlots = pData->frameSize/HOP_SIZE;
+    pData->hSTFT = NULL;
+    pData->tftBackend = TFT_AFSTFT_HYBRID;
+    pData->new_tftBackend = pData->tftBackend;
+    hcropaclib_tftCreate(pData);
+    pData->SHFrameTD = (float**)malloc2d(NUM_SH_SIGNALS, pData->frameSize, sizeof(float));
+    pData->binFrameTD = (float**)malloc2d(NUM_EARS, pData->frameSize, sizeof(float));
+    pData->SHFrameTD_rot = (float**)malloc2d(NUM_SH_SIGNALS, pData->frameSize, sizeof(float));
+    pData->hMatrixConv = NULL;
+    pData->hMatrixConv_new = NULL;
+    pData->firLength = 0;
+    pData->firActive = 0;
+    memset(&(pData->metadata), 0, sizeof(hcropaclib_metadata));
+    pData->analysisActive = 0;
+    memset(&(pData->renderMetadata), 0, sizeof(hcropaclib_metadata));
+    pData->renderMetadataPending = 0;
+    pData->SHframeTF = (float_complex***)malloc3d(MAX_NUM_BANDS, NUM_SH_SIGNALS, MAX_TIME_SLOTS, sizeof(float_complex));
+    pData->SHframeTF_rot = (float_complex**)malloc2d(NUM_SH_SIGNALS, MAX_TIME_SLOTS, sizeof(float_complex));
+    pData->ambiframeTF = (float_complex***)malloc3d(MAX_NUM_BANDS, NUM_EARS, MAX_TIME_SLOTS, sizeof(float_complex));
+    pData->binframeTF= (float_complex***)malloc3d(MAX_NUM_BANDS, NUM_EARS, MAX_TIME_SLOTS, sizeof(float_complex));
 
     /* codec data */
     pData->progressBar0_1 = 0.0f;
@@ -92,17 +120,31 @@ void hcropaclib_create
     pData->pars = (codecPars*)malloc1d(sizeof(codecPars));
     codecPars* pars = pData->pars; 
     pars->sofa_filepath = NULL;
+    pars->new_sofa_filepath = NULL;
+    pars->prev_sofa_filepath = NULL;
+    pars->eqFIR = NULL;
+    pars->eqFIR_len = 0;
+    pars->eqFIR_fs = 0;
     pars->hrirs = NULL;
     pars->hrir_dirs_deg = NULL;
+    for(i=0; i<HRIR_CACHE_SIZE; i++){
+        pars->hrirCache[i].hrirs = NULL;
+        pars->hrirCache[i].fs = 0;
+        pars->hrirCache[i].len = 0;
+    }
+    pars->hrirCacheNext = 0;
+    pars->hrirs_runtime = NULL;
     pars->itds_s = NULL;
     pars->hrtf_fb = NULL;
     pars->hrtf_fb_mag = NULL;
-    pars->pwdmap_cmplx = NULL;
+    pars->pwdmap = NULL;
     pars->M_rot = NULL;
+    pars->Y_grid_fmt = NULL;
+    pars->M_rot_fmt = NULL;
     pars->vbap_gtableComp = NULL;
     pars->vbap_gtableIdx = NULL;
     pars->Y_grid = NULL;
-    pars->Y_grid_cmplx = NULL;
+    pars->grid_icoFreq = -1;
     cdf4sap_cmplx_create(&(pData->hCdf), NUM_EARS, NUM_EARS);
 #ifdef ENABLE_RESIDUAL_STREAM
     cdf4sap_create(&(pData->hCdf_res), NUM_EARS, NUM_EARS);
@@ -112,6 +154,61 @@ void hcropaclib_create
     pData->procStatus = PROC_STATUS_NOT_ONGOING;
     pData->codecStatus = CODEC_STATUS_NOT_INITIALISED;
     pData->recalc_M_rotFLAG = 1;
+    pData->recalc_fmtFLAG = 1;
+    pData->recalc_EQFLAG = 1;
+    pData->reinitEQFLAG = 0;
+    pData->reinitFIRFLAG = 0;
+    pData->firSwapFLAG = 0;
+    pData->firRebuildingFLAG = 0;
+    pData->reinitHRIRsFLAG = 1;
+    pData->reinitHRTFsFLAG = 1;
+    pData->fs = 0;
+    pData->nAudibleBands = MAX_NUM_BANDS;
+    pData->gridMaxError_deg = 0.0f;
+    pData->gridMeanError_deg = 0.0f;
+    pData->gateHangoverCounter = 0;
+    pData->gateClosed = 0;
+    pData->nGatedFrames = 0;
+    pData->nProcessedFrames = 0;
+    pData->nAnalysedBands = 0;
+    pData->nSkippedBands = 0;
+    pData->nAnalysedSlots = 0;
+    pData->nDiffuseSlots = 0;
+    pData->nDiffuseBands = 0;
+    pData->profActive = 0;
+    pData->resetProfileFLAG = 1;
+    pData->profile_nFrames = 0;
+    pData->profile_frameMean_us = 0.0f;
+    pData->profile_frameMax_us = 0.0f;
+    pData->profile_cpuLoad = 0.0f;
+    for(i=0; i<HCROPAC_PROFILE_NUM_STAGES; i++)
+        pData->profile_stageMean_us[i] = 0.0f;
+    pData->latActive = 0;
+    pData->resetLatencyFLAG = 1;
+    for(i=0; i<LATENCY_NUM_BUCKETS; i++)
+        pData->latencyHist[i] = 0;
+    pData->latency_nFrames = 0;
+    pData->latency_nMisses = 0;
+    pData->latency_max_us = 0.0f;
+    pData->traceEvents = NULL;
+    pData->traceWriteIdx = 0;
+    pData->traceActive = 0;
+    pData->recEvents = NULL;
+    pData->recFrames = NULL;
+    pData->recSamples = NULL;
+    for(i=0; i<REC_MAX_PATHS; i++)
+        pData->recPaths[i] = NULL;
+    pData->recMaxFrames = 0;
+    pData->recMaxSamples = 0;
+    pData->recNSamples = 0;
+    pData->recFs = 0;
+    pData->recStart_us = 0.0;
+    pData->recNEvents = 0;
+    pData->recNFrames = 0;
+    pData->recNPaths = 0;
+    pData->recorderState = HCROPAC_RECORDER_OFF;
+    for(i=0; i<HCROPAC_REC_NUM_PARAMS; i++)
+        pData->recLastValue[i] = NAN; /* i.e. never set */
 }
 
 void hcropaclib_destroy
@@ -121,6 +218,7 @@ void hcropaclib_destroy
 {
     hcropaclib_data *pData = (hcropaclib_data*)(*phCroPaC);
     codecPars *pars;
+    int i;
     
     if (pData != NULL) {
         /* not safe to free memory during intialisation/processing loop */
@@ -129,28 +227,43 @@ void hcropaclib_destroy
             SAF_SLEEP(10);
         }
         
-        /* free afSTFT and buffers */
-        if(pData->hSTFT!=NULL)
-            afSTFT_destroy(&(pData->hSTFT));
+        /* free time-frequency transform and buffers */
+        hcropaclib_tftDestroy(pData);
         free(pData->SHFrameTD);
         free(pData->binFrameTD);
+        free(pData->SHFrameTD_rot);
+        saf_matrixConv_destroy(&(pData->hMatrixConv));
+        saf_matrixConv_destroy(&(pData->hMatrixConv_new));
         free(pData->SHframeTF);
         free(pData->SHframeTF_rot);
         free(pData->ambiframeTF);
         free(pData->binframeTF);
+        free(pData->traceEvents);
+        free(pData->recEvents);
+        free(pData->recFrames);
+        free(pData->recSamples);
+        for(i=0; i<REC_MAX_PATHS; i++)
+            free(pData->recPaths[i]);
 
         pars = pData->pars;
         free(pars->hrtf_fb);
         free(pars->hrtf_fb_mag);
         free(pars->itds_s);
         free(pars->hrirs);
+        for(i=0; i<HRIR_CACHE_SIZE; i++)
+            free(pars->hrirCache[i].hrirs);
         free(pars->hrir_dirs_deg);
-        free(pars->pwdmap_cmplx);
+        free(pars->pwdmap);
         free(pars->M_rot);
         free(pars->vbap_gtableComp);
         free(pars->vbap_gtableIdx);
         free(pars->Y_grid);
-        free(pars->Y_grid_cmplx);
+        free(pars->Y_grid_fmt);
+        free(pars->eqFIR);
+        free(pars->M_rot_fmt);
+        free(pars->sofa_filepath);
+        free(pars->new_sofa_filepath);
+        free(pars->prev_sofa_filepath);
         free(pars);
         
         cdf4sap_cmplx_destroy(&(pData->hCdf));
@@ -170,29 +283,28 @@ void hcropaclib_init
 )
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
-    int t;
+    
+    if(pData->recorderState == HCROPAC_RECORDER_RECORDING)
+        hcropaclib_recordParam(hCroPaC, HCROPAC_REC_INIT, -1, (float)sampleRate);
     
     /* define frequency vector */
-    pData->fs = sampleRate;
-    afSTFT_getCentreFreqs(pData->hSTFT, (float)sampleRate, HYBRID_BANDS, pData->freqVector);
+    if(pData->fs != sampleRate){
+        pData->fs = sampleRate;
+        pData->reinitHRTFsFLAG = 1; /* the HRIRs are resampled to the host rate, and the decoder depends on the band centre frequencies */
+        pData->reinitEQFLAG = 1;    /* as does the EQ derived from an FIR */
+        hcropaclib_setCodecStatus(hCroPaC, CODEC_STATUS_NOT_INITIALISED);
+    }
+    hcropaclib_initFrequencies(hCroPaC);
     
     /* default starting values */
-    memset(pData->Cx, 0, HYBRID_BANDS*NUM_SH_SIGNALS*NUM_SH_SIGNALS*sizeof(float_complex));
-    memset(pData->Cy, 0, HYBRID_BANDS*NUM_EARS*NUM_EARS*sizeof(float_complex));
-    memset(pData->Cambi, 0, HYBRID_BANDS*NUM_EARS*NUM_EARS*sizeof(float_complex));
-    memset(pData->current_M, 0, HYBRID_BANDS*NUM_EARS*NUM_EARS*sizeof(float_complex));
-#ifdef ENABLE_RESIDUAL_STREAM
-    memset(pData->current_Mr, 0, HYBRID_BANDS*NUM_EARS*NUM_EARS*sizeof(float));
-    memset(pData->transientDetector1, 0, HYBRID_BANDS*NUM_EARS*sizeof(float));
-    memset(pData->transientDetector2, 0, HYBRID_BANDS*NUM_EARS*sizeof(float));
-    memset(pData->circBufferFrames, 0, HYBRID_BANDS*NUM_EARS*TIME_SLOTS*(NUM_DECOR_FRAMES+1)*sizeof(float_complex));
-#endif
-    memset(pData->M_rot, 0, NUM_SH_SIGNALS*NUM_SH_SIGNALS*sizeof(float_complex));
+    hcropaclib_resetProcessingState(hCroPaC);
+    memset(pData->M_rot, 0, NUM_SH_SIGNALS*NUM_SH_SIGNALS*sizeof(float));
     pData->recalc_M_rotFLAG = 1;
+    pData->gateHangoverCounter = 0;
+    pData->gateClosed = 0;
     
-    /* interpolator */
-    for(t=0; t<TIME_SLOTS; t++)
-        pData->interpolator[t] = ((float)t+1.0f)/TIME_SLOTS;
+    /* an armed recording starts from here */
+    hcropaclib_recordStart(hCroPaC);
 }
 
 void hcropaclib_initCodec
@@ -202,162 +314,125 @@ void hcropaclib_initCodec
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
     codecPars* pars = pData->pars;
-    int i, j, k, band;
-    float Rxyz[3][3];
-    float* M_rot_tmp;
-#ifdef SAF_ENABLE_SOFA_READER_MODULE
-    SAF_SOFA_ERROR_CODES error;
-    saf_sofa_container sofa;
-#endif
+    int t, band;
+    float eq[MAX_NUM_BANDS];
+    double mark_us;
+    char* newPath;
     
+    if (hcropaclib_getFIRDecoderRebuildPending(hCroPaC)){
+        hcropaclib_rebuildFIRDecoder(hCroPaC); /* only the FIR decoder is out of date; processing continues meanwhile */
+        return;
+    }
     if (pData->codecStatus != CODEC_STATUS_NOT_INITIALISED)
         return; /* re-init not required, or already happening */
+    mark_us = hcropaclib_profileClock_us();
     while (pData->procStatus == PROC_STATUS_ONGOING){
         /* re-init required, but we need to wait for the current processing loop to end */
         pData->codecStatus = CODEC_STATUS_INITIALISING; /* indicate that we want to init */
         SAF_SLEEP(10);
     }
+    hcropaclib_traceStage(hCroPaC, TRACE_TRACK_INIT, "wait_for_processing", &mark_us);
     
     /* for progress bar */
     pData->codecStatus = CODEC_STATUS_INITIALISING;
+    while (pData->firRebuildingFLAG)
+        SAF_SLEEP(10); /* a rebuild of the FIR decoder, which began while the codec was initialised, must finish first */
+    hcropaclib_traceEvent(hCroPaC, TRACE_TRACK_STATUS, "codec_initialising", mark_us, -1.0f);
     strcpy(pData->progressBarText,"Preparing HRIRs");
     pData->progressBar0_1 = 0.0f;
     
-    /* clear afSTFT buffers */
-    afSTFT_clearBuffers(pData->hSTFT);
-    
-    /* ----- LOAD HRIRs ----- */
-    /* load sofa file or load default hrir data */
-#ifdef SAF_ENABLE_SOFA_READER_MODULE
-    if(!pData->useDefaultHRIRsFLAG && pars->sofa_filepath!=NULL){
-        /* Load SOFA file */
-        error = saf_sofa_open(&sofa, pars->sofa_filepath, SAF_SOFA_READER_OPTION_DEFAULT);
-
-        /* Load defaults instead */
-        if(error!=SAF_SOFA_OK || sofa.nReceivers!=NUM_EARS){
-            pData->useDefaultHRIRsFLAG = 1;
-            saf_print_warning("Unable to load the specified SOFA file, or it contained something other than 2 channels. Using default HRIR data instead.");
-        }
-        else{
-            /* Copy SOFA data */
-            pars->hrir_fs = (int)sofa.DataSamplingRate;
-            pars->hrir_len = sofa.DataLengthIR;
-            pars->N_hrir_dirs = sofa.nSources;
-            pars->hrirs = realloc1d(pars->hrirs, pars->N_hrir_dirs*NUM_EARS*(pars->hrir_len)*sizeof(float));
-            memcpy(pars->hrirs, sofa.DataIR, pars->N_hrir_dirs*NUM_EARS*(pars->hrir_len)*sizeof(float));
-            pars->hrir_dirs_deg = realloc1d(pars->hrir_dirs_deg, pars->N_hrir_dirs*2*sizeof(float));
-            cblas_scopy(pars->N_hrir_dirs, sofa.SourcePosition, 3, pars->hrir_dirs_deg, 2); /* azi */
-            cblas_scopy(pars->N_hrir_dirs, &sofa.SourcePosition[1], 3, &pars->hrir_dirs_deg[1], 2); /* elev */
-        }
-
-        /* Clean-up */
-        saf_sofa_close(&sofa);
-    }
-#else
-    pData->useDefaultHRIRsFLAG = 1; /* Can only load the default HRIR data */
-#endif
-    if(pData->useDefaultHRIRsFLAG){
-        /* Copy default HRIR data */
-        pars->hrir_fs = __default_hrir_fs;
-        pars->hrir_len = __default_hrir_len;
-        pars->N_hrir_dirs = __default_N_hrir_dirs;
-        pars->hrirs = realloc1d(pars->hrirs, pars->N_hrir_dirs*NUM_EARS*(pars->hrir_len)*sizeof(float));
-        memcpy(pars->hrirs, (float*)__default_hrirs, pars->N_hrir_dirs*NUM_EARS*(pars->hrir_len)*sizeof(float));
-        pars->hrir_dirs_deg = realloc1d(pars->hrir_dirs_deg, pars->N_hrir_dirs*2*sizeof(float));
-        memcpy(pars->hrir_dirs_deg, (float*)__default_hrir_dirs_deg, pars->N_hrir_dirs*2*sizeof(float));
+    /* ----- TIME-FREQUENCY TRANSFORM ----- */
+    if(pData->tftBackend != (HCROPAC_TFT_BACKENDS)pData->new_tftBackend){
+        hcropaclib_tftDestroy(hCroPaC);
+        pData->tftBackend = (HCROPAC_TFT_BACKENDS)pData->new_tftBackend;
+        hcropaclib_tftCreate(hCroPaC);
+        hcropaclib_initFrequencies(hCroPaC);
+        hcropaclib_resetProcessingState(hCroPaC);
+        pData->reinitHRTFsFLAG = 1; /* all band-dependent tables are to be rebuilt */
+        pData->reinitEQFLAG = 1;
     }
+    hcropaclib_tftClearBuffers(hCroPaC);
+    hcropaclib_traceStage(hCroPaC, TRACE_TRACK_INIT, "transform", &mark_us);
     
-    /* estimate the ITDs for each HRIR */
-    pars->itds_s = realloc1d(pars->itds_s, pars->N_hrir_dirs*sizeof(float));
-    estimateITDs(pars->hrirs, pars->N_hrir_dirs, pars->hrir_len, pars->hrir_fs, pars->itds_s);
-    
-    pData->progressBar0_1 = 0.4f;
+    /* ----- FRAME SIZE ----- */
+    if(pData->frameSize != pData->new_frameSize){
+        pData->frameSize = pData->new_frameSize;
+        pData->nSlots = pData->frameSize/HOP_SIZE;
+        pData->SHFrameTD = (float**)realloc2d((void**)pData->SHFrameTD, NUM_SH_SIGNALS, pData->frameSize, sizeof(float));
+        pData->binFrameTD = (float**)realloc2d((void**)pData->binFrameTD, NUM_EARS, pData->frameSize, sizeof(float));
+        pData->SHFrameTD_rot = (float**)realloc2d((void**)pData->SHFrameTD_rot, NUM_SH_SIGNALS, pData->frameSize, sizeof(float));
+        pData->reinitFIRFLAG = 1; /* the partition length is the frame size */
+    }
     
-    /* convert hrirs to filterbank coefficients */
-    pars->hrtf_fb = realloc1d(pars->hrtf_fb, HYBRID_BANDS * NUM_EARS * (pars->N_hrir_dirs)*sizeof(float_complex));
-    HRIRs2HRTFs_afSTFT(pars->hrirs, pars->N_hrir_dirs, pars->hrir_len, HOP_SIZE, 0, 1, pars->hrtf_fb);
-    diffuseFieldEqualiseHRTFs(pars->N_hrir_dirs, pars->itds_s, pData->freqVector, HYBRID_BANDS, NULL,
-                              pData->hrirProcMode == HRIR_PREPROC_ALL || pData->hrirProcMode == HRIR_PREPROC_EQ ? 1 : 0,
-                              pData->hrirProcMode == HRIR_PREPROC_ALL || pData->hrirProcMode == HRIR_PREPROC_PHASE ? 1 : 0,
-                              pars->hrtf_fb);
-    pars->hrtf_fb_mag = realloc1d(pars->hrtf_fb_mag, HYBRID_BANDS*NUM_EARS* (pars->N_hrir_dirs)*sizeof(float));
-    for(i=0; i<HYBRID_BANDS*NUM_EARS* (pars->N_hrir_dirs); i++)
-        pars->hrtf_fb_mag[i] = cabsf(pars->hrtf_fb[i]);
-#ifdef ENABLE_BINAURAL_DIFF_COH
-    binauralDiffuseCoherence(pars->hrtf_fb, pars->itds_s, pData->freqVector, pars->N_hrir_dirs, HYBRID_BANDS, (float*)pars->binDiffuseCoh);
-#endif
+    /* mixing matrices are interpolated over the time slots of each frame */
+    for(t=0; t<pData->nSlots; t++)
+        pData->interpolator[t] = ((float)t+1.0f)/(float)pData->nSlots;
+    hcropaclib_traceStage(hCroPaC, TRACE_TRACK_INIT, "frame_size", &mark_us);
     
-    /* compressed HRTF interpolation table */
-    strcpy(pData->progressBarText,"Computing interpolation table");
-    pData->progressBar0_1 = 0.85f;
-    float* hrtf_vbap_gtable = NULL;
-    pars->az_res = 1;
-    pars->el_res = 4;
-    generateVBAPgainTable3D(pars->hrir_dirs_deg,  pars->N_hrir_dirs, pars->az_res, pars->el_res, 0, 0, 0.0f,
-                            &hrtf_vbap_gtable, &(pars->N_hrtf_vbap_gtable), &(pars->hrtf_nTriangles));
-    pars->vbap_gtableComp = realloc1d(pars->vbap_gtableComp, pars->N_hrtf_vbap_gtable*3*sizeof(float));
-    pars->vbap_gtableIdx = realloc1d(pars->vbap_gtableIdx, pars->N_hrtf_vbap_gtable*3*sizeof(int));
-    compressVBAPgainTable3D(hrtf_vbap_gtable, pars->N_hrtf_vbap_gtable, pars->N_hrir_dirs, pars->vbap_gtableComp, pars->vbap_gtableIdx);
-    free(hrtf_vbap_gtable);
-
-    /* get integration weights */
-    float* weights;
-    if(pars->N_hrir_dirs<1800){
-        weights = malloc1d(pars->N_hrir_dirs*sizeof(float));
-        getVoronoiWeights(pars->hrir_dirs_deg, pars->N_hrir_dirs, 0, weights);
+    /* ----- HRIRs, HRTFs AND PROTO DECODER ----- */
+    if(pData->reinitHRIRsFLAG){
+        pData->reinitHRIRsFLAG = 0; /* cleared first, so that a request made while loading is not lost */
+        newPath = hcropaclib_exchangePath(&(pars->new_sofa_filepath), NULL);
+        if(newPath != NULL){
+            free(pars->prev_sofa_filepath);
+            pars->prev_sofa_filepath = pars->sofa_filepath;
+            pars->sofa_filepath = newPath;
+        }
+        hcropaclib_loadHRIRs(hCroPaC);
+        pData->reinitHRTFsFLAG = 1;
+        hcropaclib_traceStage(hCroPaC, TRACE_TRACK_INIT, "load_hrirs", &mark_us);
+    }
+    if(pData->reinitHRTFsFLAG){
+        hcropaclib_initHRTFsAndDecoder(hCroPaC);
+        pData->reinitHRTFsFLAG = 0;
+        pData->reinitFIRFLAG = 1;
+        hcropaclib_traceStage(hCroPaC, TRACE_TRACK_INIT, "hrtfs_and_decoder", &mark_us);
     }
-    else
-        weights = NULL;
-    
-    /* ----- COMPUTE PROTO DECODER ----- */
-    float_complex* decMtx;
-    decMtx = calloc1d(HYBRID_BANDS*NUM_EARS*NUM_SH_SIGNALS, sizeof(float_complex));
-    getBinauralAmbiDecoderMtx(pars->hrtf_fb, pars->hrir_dirs_deg, pars->N_hrir_dirs, HYBRID_BANDS, BINAURAL_DECODER_MAGLS, SH_ORDER, pData->freqVector, pars->itds_s, weights, pData->diffCorrection, 1, decMtx);
     
-    /* replace current decoder */
-    memset(pars->M_dec, 0, HYBRID_BANDS*NUM_EARS*NUM_SH_SIGNALS*sizeof(float_complex));
-    for(band=0; band<HYBRID_BANDS; band++)
-        for(i=0; i<NUM_EARS; i++)
-            for(j=0; j<NUM_SH_SIGNALS; j++)
-                pars->M_dec[band][i][j] = decMtx[band*NUM_EARS*NUM_SH_SIGNALS + i*NUM_SH_SIGNALS + j];
-    free(decMtx);
-    free(weights);
-  
     /* ----- SCANNING GRID ----- */
     strcpy(pData->progressBarText,"Computing scanning grid");
     pData->progressBar0_1 = 0.95f;
-    int geosphere_ico_freq = 12;
-    pars->grid_dirs_deg = (float*)__HANDLES_geosphere_ico_dirs_deg[geosphere_ico_freq];
-    pars->grid_nDirs = __geosphere_ico_nPoints[geosphere_ico_freq];
-    pars->Y_grid = realloc1d(pars->Y_grid, NUM_SH_SIGNALS*(pars->grid_nDirs)*sizeof(float));
-    getRSH(SH_ORDER, pars->grid_dirs_deg, pars->grid_nDirs, pars->Y_grid);
-    pars->Y_grid_cmplx = realloc1d(pars->Y_grid_cmplx, NUM_SH_SIGNALS * (pars->grid_nDirs)*sizeof(float_complex));
-    for(i=0; i<NUM_SH_SIGNALS; i++)
-        for(j=0; j<pars->grid_nDirs; j++)
-            pars->Y_grid_cmplx[i*(pars->grid_nDirs)+j] = cmplxf(pars->Y_grid[i*(pars->grid_nDirs)+j], 0.0f);
-    pars->pwdmap_cmplx = realloc1d(pars->pwdmap_cmplx, TIME_SLOTS*(pars->grid_nDirs)*sizeof(float_complex));
-    pars->M_rot = realloc1d(pars->M_rot, pars->grid_nDirs*NUM_SH_SIGNALS*NUM_SH_SIGNALS*sizeof(float_complex));
+    hcropaclib_initScanningGrid(hCroPaC);
+    pData->recalc_fmtFLAG = 1; /* decoder and/or grid tables have changed */
+    hcropaclib_traceStage(hCroPaC, TRACE_TRACK_INIT, "scanning_grid", &mark_us);
+    
+    /* ----- EQ ----- */
+    if(pData->reinitEQFLAG){
+        if(pars->eqFIR != NULL){
+            hcropaclib_getEQfromFIR(pars->eqFIR, pars->eqFIR_len, pars->eqFIR_fs, pData->freqVector, pData->nBands, eq);
+            for(band=0; band<pData->nBands; band++){
+                pData->EQ[band] = eq[band];
+                hcropaclib_recordParam(hCroPaC, HCROPAC_REC_EQ, band, eq[band]); /* the replay has no FIR */
+            }
+        }
+        pData->reinitEQFLAG = 0;
+        pData->recalc_EQFLAG = 1;
+        pData->reinitFIRFLAG = 1;
+        hcropaclib_traceStage(hCroPaC, TRACE_TRACK_INIT, "eq", &mark_us);
+    }
     
-    /* rotation matrices for each grid direction */
-    M_rot_tmp = malloc1d(NUM_SH_SIGNALS*NUM_SH_SIGNALS * sizeof(float));
-    for(i=0; i<pars->grid_nDirs; i++){
-        yawPitchRoll2Rzyx(pars->grid_dirs_deg[i*2]*SAF_PI/180.0f, -pars->grid_dirs_deg[i*2+1]*SAF_PI/180.0f, 0.0f, 0, Rxyz);
-        getSHrotMtxReal(Rxyz, M_rot_tmp, SH_ORDER);
-        for (j = 0; j < NUM_SH_SIGNALS; j++)
-            for (k = 0; k < NUM_SH_SIGNALS; k++)
-                pars->M_rot[i*NUM_SH_SIGNALS*NUM_SH_SIGNALS + j*NUM_SH_SIGNALS + k] = cmplxf(M_rot_tmp[j*NUM_SH_SIGNALS + k], 0.0f);
+    /* ----- FIR LINEAR DECODER ----- */
+    if(pData->reinitFIRFLAG && pData->linearDecoderMode == LINEAR_DECODER_FIR){
+        strcpy(pData->progressBarText,"Computing decoding filters");
+        pData->progressBar0_1 = 0.97f;
+        hcropaclib_initFIRDecoder(hCroPaC);
+        pData->firSwapFLAG = 1; /* handed over at the start of the first frame */
+        pData->reinitFIRFLAG = 0;
+        hcropaclib_traceStage(hCroPaC, TRACE_TRACK_INIT, "fir_decoder", &mark_us);
     }
-    free(M_rot_tmp);
     
     /* ----- RESIDUAL PROCESSING ----- */
 #ifdef ENABLE_RESIDUAL_STREAM
-    getDecorrelationDelays(NUM_EARS, pData->freqVector, HYBRID_BANDS, (float)pData->fs, NUM_DECOR_FRAMES*TIME_SLOTS, HOP_SIZE, &(pData->decorrelationDelays[0][0]));
+    getDecorrelationDelays(NUM_EARS, pData->freqVector, pData->nBands, (float)pData->fs, NUM_DECOR_SLOTS, HOP_SIZE, &(pData->decorrelationDelays[0][0]));
+    hcropaclib_traceStage(hCroPaC, TRACE_TRACK_INIT, "decorrelation_delays", &mark_us);
 #endif
     
     /* done! */
     strcpy(pData->progressBarText,"Done!");
     pData->progressBar0_1 = 1.0f;
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_INIT_CODEC, -1, 0.0f);
     pData->codecStatus = CODEC_STATUS_INITIALISED;
+    hcropaclib_traceEvent(hCroPaC, TRACE_TRACK_STATUS, "codec_initialised", mark_us, -1.0f);
 }
 
 void hcropaclib_process
@@ -369,525 +444,1063 @@ void hcropaclib_process
     int            nOutputs,
     int            nSamples
 )
+{
+    int recFrame;
+    
+    recFrame = hcropaclib_recordFrameBegin(hCroPaC, (const float* const*)inputs, 1, nInputs, nOutputs, nSamples);
+    hcropaclib_processFrame(hCroPaC, (const float* const*)inputs, 1, outputs, 1, nInputs, nOutputs, nSamples);
+    hcropaclib_recordFrameEnd(hCroPaC, recFrame, outputs, 1, nOutputs, nSamples);
+}
+
+void hcropaclib_processStrided
+(
+    void  *  const hCroPaC,
+    const float *  inputs,
+    int            inChannelStride,
+    int            inSampleStride,
+    float       *  outputs,
+    int            outChannelStride,
+    int            outSampleStride,
+    int            nInputs,
+    int            nOutputs,
+    int            nSamples
+)
+{
+    const float* inPtrs[NUM_SH_SIGNALS];
+    float* outPtrs[NUM_EARS];
+    int ch, n, recFrame;
+    
+    nInputs = SAF_MIN(nInputs, NUM_SH_SIGNALS); /* any additional input channels are ignored */
+    for(ch=0; ch<nInputs; ch++)
+        inPtrs[ch] = &inputs[ch*inChannelStride];
+    for(ch=0; ch<SAF_MIN(nOutputs, NUM_EARS); ch++)
+        outPtrs[ch] = &outputs[ch*outChannelStride];
+    recFrame = hcropaclib_recordFrameBegin(hCroPaC, inPtrs, inSampleStride, nInputs, nOutputs, nSamples);
+    hcropaclib_processFrame(hCroPaC, inPtrs, inSampleStride, outPtrs, outSampleStride, nInputs, SAF_MIN(nOutputs, NUM_EARS), nSamples);
+    hcropaclib_recordFrameEnd(hCroPaC, recFrame, outPtrs, outSampleStride, SAF_MIN(nOutputs, NUM_EARS), nSamples);
+    
+    /* zero any additional output channels */
+    for(ch=NUM_EARS; ch<nOutputs; ch++)
+        for(n=0; n<nSamples; n++)
+            outputs[ch*outChannelStride + n*outSampleStride] = 0.0f;
+}
+
+void hcropaclib_processTF
+(
+    void   *  const hCroPaC,
+    float *** const inputsTF,
+    float *** const outputsTF,
+    int             nInputs,
+    int             nOutputs,
+    int             nBands,
+    int             nTimeSlots
+)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
-    codecPars* pars = pData->pars;
-    int n, t, ch, i, j, band;
-    int o[SH_ORDER + 2], dir_max_idx[TIME_SLOTS];
-    const float_complex calpha = cmplxf(1.0f, 0.0f), cbeta = cmplxf(0.0f, 0.0f);
-    float inputEnergy, G, Ex, Eambi;
-    float Rxyz[3][3]; // ambiFrame_norm[NUM_EARS][TIME_SLOTS],
-    float azi[TIME_SLOTS], elev[TIME_SLOTS]; 
-#ifdef ENABLE_RESIDUAL_STREAM
-    float_complex Cr[NUM_EARS][NUM_EARS];
-    float Cr_real[NUM_EARS][NUM_EARS];
-    float real_eye2[NUM_EARS][NUM_EARS] = { {1.0f, 0.0f}, {0.0f, 1.0f} };
-#endif
-    float_complex Cx_new[NUM_SH_SIGNALS][NUM_SH_SIGNALS], Cambi_new[NUM_EARS][NUM_EARS];
-    float_complex inputFrame_s[NUM_SH_SIGNALS], inputFrame_rot[NUM_SH_SIGNALS];
-    float_complex Cdir[NUM_EARS][NUM_EARS], Cdiff[NUM_EARS][NUM_EARS], hrtf_interp[TIME_SLOTS][NUM_EARS];
-    float_complex inFrame_t[NUM_EARS], outFrame_t[NUM_EARS], interp_M[NUM_EARS][NUM_EARS];
-    float_complex eye2[NUM_EARS][NUM_EARS];
-    float_complex B, GB[TIME_SLOTS], w[NUM_SH_SIGNALS], y[TIME_SLOTS][NUM_SH_SIGNALS];
-    float_complex y_dir[TIME_SLOTS][NUM_EARS], y_diff[TIME_SLOTS][NUM_EARS];
-    float_complex a_diff[NUM_SH_SIGNALS];
-#ifdef ENABLE_BINAURAL_DIFF_COH
-    float_complex U[NUM_EARS][NUM_EARS], U_Cdiff[NUM_EARS][NUM_EARS];
-#endif
-    float* M_rot_tmp;
-    for (i = 0; i < NUM_EARS; i++)
-        for (j = 0; j < NUM_EARS; j++)
-            eye2[i][j] = i == j ? cmplxf(1.0f, 0.0f) : cmplxf(0.0f, 0.0f);
+    float_complex*** outTF;
+    int band, ch, analysisOnly;
+    
+    if ( (nBands == pData->nBands) && (nTimeSlots == pData->nSlots) && (pData->codecStatus == CODEC_STATUS_INITIALISED) ) {
+        pData->procStatus = PROC_STATUS_ONGOING;
+        HCROPAC_PROFILE_BEGIN_FRAME(pData);
+        analysisOnly = pData->enableAnalysisOnly;
+        pData->nProcessedFrames++;
+        hcropaclib_applyPendingUpdates(hCroPaC);
+        hcropaclib_updateAnalysisOnlyState(hCroPaC, analysisOnly, 0); /* the caller owns the TFT */
+        
+        /* Load time-frequency data; the input may alias the output, so it is always copied */
+        for(band=0; band<nBands; band++){
+            for(ch=0; ch<NUM_SH_SIGNALS; ch++){
+                if(ch < nInputs)
+                    memcpy(pData->SHframeTF[band][ch], inputsTF[band][ch], nTimeSlots*sizeof(float_complex));
+                else
+                    memset(pData->SHframeTF[band][ch], 0, nTimeSlots*sizeof(float_complex));
+            }
+        }
+        HCROPAC_PROFILE_MARK(pData, HCROPAC_PROFILE_INPUT);
+        
+        /* Main processing */
+        outTF = hcropaclib_processFrameTF(hCroPaC, analysisOnly);
+        
+        /* Copy to output */
+        for(band=0; band<nBands; band++){
+            for(ch=0; ch<nOutputs; ch++){
+                if(ch < NUM_EARS && outTF != NULL)
+                    memcpy(outputsTF[band][ch], outTF[band][ch], nTimeSlots*sizeof(float_complex));
+                else
+                    memset(outputsTF[band][ch], 0, nTimeSlots*sizeof(float_complex));
+            }
+        }
+        HCROPAC_PROFILE_MARK(pData, HCROPAC_PROFILE_OUTPUT);
+        HCROPAC_PROFILE_END_FRAME(pData);
+    }
+    else{
+        for(band=0; band<nBands; band++)
+            for(ch=0; ch<nOutputs; ch++)
+                memset(outputsTF[band][ch], 0, nTimeSlots*sizeof(float_complex));
+    }
+    
+    pData->procStatus = PROC_STATUS_NOT_ONGOING;
+}
+
+void hcropaclib_applyPendingUpdates
+(
+    void* const hCroPaC
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    void* hMatrixConv;
+    
+    /* A rebuilt FIR decoder replaces the current one; the latter is freed by the next rebuild */
+    if(pData->firSwapFLAG){
+        hMatrixConv = pData->hMatrixConv;
+        pData->hMatrixConv = pData->hMatrixConv_new;
+        pData->hMatrixConv_new = hMatrixConv;
+        pData->firActive = 0; /* i.e. the convolver is reset before its first use */
+        pData->firSwapFLAG = 0;
+    }
+    
+    /* The input channel order and normalisation are folded into the processing tables */
+    if(pData->recalc_fmtFLAG){
+        pData->recalc_fmtFLAG = 0;
+        hcropaclib_initInputFormat(hCroPaC);
+    }
+    if(pData->recalc_EQFLAG){
+        pData->recalc_EQFLAG = 0;
+        hcropaclib_initEQDecoder(hCroPaC);
+    }
+}
+
+int hcropaclib_encodeMetadata
+(
+    void          * const hCroPaC,
+    unsigned char *       buffer,
+    int                   bufferSize
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    hcropaclib_metadata* md = &(pData->metadata);
+    int band, t, nBytes;
+    float azi;
+    unsigned char* tile;
+    
+    nBytes = HCROPAC_METADATA_HEADER_BYTES + HCROPAC_METADATA_BYTES_PER_TILE*(md->nAnalysedBands)*(md->nTimeSlots);
+    if(nBytes > bufferSize)
+        return 0;
+    buffer[0] = 'H'; buffer[1] = 'C'; buffer[2] = 'P'; buffer[3] = 'M';
+    buffer[4] = HCROPAC_METADATA_VERSION;
+    buffer[5] = (unsigned char)md->nTimeSlots;
+    buffer[6] = (unsigned char)md->nBands;
+    buffer[7] = (unsigned char)md->nAnalysedBands;
+    tile = &buffer[HCROPAC_METADATA_HEADER_BYTES];
+    for(band=0; band<md->nAnalysedBands; band++){
+        for(t=0; t<md->nTimeSlots; t++, tile+=HCROPAC_METADATA_BYTES_PER_TILE){
+            if(md->dirIdx[band][t] < 0){
+                tile[0] = 0; tile[1] = 255; tile[2] = 0; /* skipped band */
+                continue;
+            }
+            azi = md->azi[band][t] < 0.0f ? md->azi[band][t] + 360.0f : md->azi[band][t];
+            tile[0] = (unsigned char)((int)(azi*256.0f/360.0f + 0.5f) & 255);
+            tile[1] = (unsigned char)SAF_CLAMP((int)((md->elev[band][t]+90.0f)*254.0f/180.0f + 0.5f), 0, 254);
+            tile[2] = (unsigned char)SAF_CLAMP((int)(md->gain[band][t]*255.0f + 0.5f), 0, 255);
+        }
+    }
+    return nBytes;
+}
+
+int hcropaclib_setRenderMetadata
+(
+    void                * const hCroPaC,
+    const unsigned char *       buffer,
+    int                         nBytes
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    hcropaclib_metadata* md = &(pData->renderMetadata);
+    int band, t, nTimeSlots, nAnalysedBands;
+    const unsigned char* tile;
+    
+    pData->renderMetadataPending = 0;
+    if(nBytes < HCROPAC_METADATA_HEADER_BYTES || buffer[0] != 'H' || buffer[1] != 'C' || buffer[2] != 'P' || buffer[3] != 'M' ||
+       buffer[4] != HCROPAC_METADATA_VERSION)
+        return 0;
+    nTimeSlots = (int)buffer[5];
+    nAnalysedBands = (int)buffer[7];
+    if(nTimeSlots != pData->nSlots || (int)buffer[6] != pData->nBands || nAnalysedBands > pData->nAudibleBands ||
+       nBytes != HCROPAC_METADATA_HEADER_BYTES + HCROPAC_METADATA_BYTES_PER_TILE*nAnalysedBands*nTimeSlots)
+        return 0;
+    md->nTimeSlots = nTimeSlots;
+    md->nBands = pData->nBands;
+    md->nAnalysedBands = nAnalysedBands;
+    tile = &buffer[HCROPAC_METADATA_HEADER_BYTES];
+    for(band=0; band<nAnalysedBands; band++){
+        for(t=0; t<nTimeSlots; t++, tile+=HCROPAC_METADATA_BYTES_PER_TILE){
+            md->dirIdx[band][t] = tile[1] == 255 ? -1 : 0; /* the directions are not tied to the scanning grid */
+            md->azi[band][t] = (float)tile[0]*360.0f/256.0f;
+            md->azi[band][t] = md->azi[band][t] > 180.0f ? md->azi[band][t] - 360.0f : md->azi[band][t];
+            md->elev[band][t] = (float)tile[1]*180.0f/254.0f - 90.0f;
+            md->gain[band][t] = (float)tile[2]/255.0f;
+        }
+    }
+    pData->renderMetadataPending = 1;
+    return 1;
+}
+
+void hcropaclib_processFrame
+(
+    void  *  const hCroPaC,
+    const float * const * inputs,
+    int            inSampleStride,
+    float * const * outputs,
+    int            outSampleStride,
+    int            nInputs,
+    int            nOutputs,
+    int            nSamples
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    int n, ch, i, nSlots, frameSize, gateClosed, directOutput, useFIR, analysisOnly;
+    float frameEnergy;
+    float* firIn;
+    float* inTD[NUM_SH_SIGNALS];
+    float* outTD[NUM_EARS];
+    float_complex*** outTF;
 
     /* local copies of user parameters */
-    int enableRot, enableCroPaC;
-    float covAvgCoeff, anaLim;
-    float balance[HYBRID_BANDS];
-    HCROPAC_NORM_TYPES norm;
-    HCROPAC_CH_ORDER chOrdering;
+    int enableRot, enableGate, gateHangover;
+    float covAvgCoeff, gateThreshold;
+    
+    /* current frame size */
+    frameSize = pData->frameSize;
+    nSlots = pData->nSlots;
     
     /* decode audio to headphones */
-    if ( (nSamples == FRAME_SIZE) && (pData->codecStatus == CODEC_STATUS_INITIALISED) ) {
+    if ( (nSamples == frameSize) && (pData->codecStatus == CODEC_STATUS_INITIALISED) ) {
         pData->procStatus = PROC_STATUS_ONGOING;
+        HCROPAC_PROFILE_BEGIN_FRAME(pData);
         
         /* copy user parameters to local variables */
-        for(n=0; n<SH_ORDER+2; n++){  o[n] = n*n;  }
-        norm = pData->norm;
-        chOrdering = pData->chOrdering;
         enableRot = pData->enableRotation;
-        covAvgCoeff = pData->covAvgCoeff;
-        enableCroPaC = pData->enableCroPaC;
-        anaLim = pData->anaLimit_hz;
-        memcpy(balance, pData->balance, HYBRID_BANDS*sizeof(float));
-
-        /* Load time-domain data */
-        for(i=0; i < SAF_MIN(NUM_SH_SIGNALS, nInputs); i++)
-            utility_svvcopy(inputs[i], FRAME_SIZE, pData->SHFrameTD[i]);
-        for(; i<NUM_SH_SIGNALS; i++)
-            memset(pData->SHFrameTD[i], 0, FRAME_SIZE * sizeof(float)); /* fill remaining channels with zeros */
-
-        /* account for channel order convention */
-        switch(chOrdering){
-            case CH_ACN:
-                convertHOAChannelConvention(FLATTEN2D(pData->SHFrameTD), SH_ORDER, FRAME_SIZE, HOA_CH_ORDER_ACN, HOA_CH_ORDER_ACN);
-                break;
-            case CH_FUMA:
-                convertHOAChannelConvention(FLATTEN2D(pData->SHFrameTD), SH_ORDER, FRAME_SIZE, HOA_CH_ORDER_FUMA, HOA_CH_ORDER_ACN);
-                break;
+        covAvgCoeff = powf(pData->covAvgCoeff, (float)nSlots/(float)COV_AVG_REF_SLOTS); /* same time constant, regardless of frame size */
+        enableGate = pData->enableGate;
+        gateThreshold = powf(10.0f, pData->gateThreshold_dB/10.0f);
+        gateHangover = 1 + (int)(pData->gateHangover_ms*(float)pData->fs/(1000.0f*(float)frameSize) + 0.5f);
+        analysisOnly = pData->enableAnalysisOnly; /* read once, as the setter may be called mid-frame */
+        pData->nProcessedFrames++;
+        hcropaclib_applyPendingUpdates(hCroPaC);
+
+        /* Load time-domain data; contiguous input channels are passed to the TFT as is */
+        for(i=0; i<NUM_SH_SIGNALS; i++){
+            if(i < nInputs && inSampleStride == 1)
+                inTD[i] = (float*)inputs[i]; /* not written to */
+            else{
+                inTD[i] = pData->SHFrameTD[i];
+                if(i < nInputs){
+                    for(n=0; n<frameSize; n++)
+                        inTD[i][n] = inputs[i][n*inSampleStride];
+                }
+                else
+                    memset(inTD[i], 0, frameSize * sizeof(float)); /* fill remaining channels with zeros */
+            }
         }
 
-        /* account for input normalisation scheme */
-        switch(norm){
-            case NORM_N3D:  /* already in N3D, do nothing */
-                break;
-            case NORM_SN3D: /* convert to N3D */
-                convertHOANormConvention(FLATTEN2D(pData->SHFrameTD), SH_ORDER, FRAME_SIZE, HOA_NORM_SN3D, HOA_NORM_N3D);
-                break;
-            case NORM_FUMA: /* only for first-order, convert to N3D */
-                convertHOANormConvention(FLATTEN2D(pData->SHFrameTD), SH_ORDER, FRAME_SIZE, HOA_NORM_FUMA, HOA_NORM_N3D);
-                break;
+        /* FIR linear decoding (below), in which CroPaC is disabled; the gate must also flush the FIR tails */
+        useFIR = !analysisOnly && pData->linearDecoderMode == LINEAR_DECODER_FIR && pData->hMatrixConv != NULL;
+
+        /* Silence gate; the gate only closes once the input has been below the threshold for the whole hangover period,
+         * which is extended to flush the TFT and decorrelator tails (or those of the FIR decoder) */
+        gateClosed = 0;
+        if(enableGate){
+            frameEnergy = 0.0f;
+            for(i=0; i<NUM_SH_SIGNALS; i++)
+                frameEnergy += pData->energyWeights[i] * cblas_sdot(frameSize, inTD[i], 1, inTD[i], 1);
+            frameEnergy /= (float)(NUM_SH_SIGNALS*frameSize);
+            if(frameEnergy > gateThreshold)
+                pData->gateHangoverCounter = gateHangover + (useFIR ? (pData->firLength + frameSize - 1)/frameSize : (GATE_FLUSH_SLOTS + nSlots - 1)/nSlots);
+            else if(pData->gateHangoverCounter > 0)
+                pData->gateHangoverCounter--;
+            gateClosed = pData->gateHangoverCounter == 0 ? 1 : 0;
         }
-        
-        /* Apply time-frequency transform (TFT) */
-        afSTFT_forward(pData->hSTFT, pData->SHFrameTD, FRAME_SIZE, pData->SHframeTF);
-    
-        /* Main processing: */
-        /* Apply rotation */
-        if (enableRot) {
-            if(pData->recalc_M_rotFLAG){
-                M_rot_tmp = malloc1d(NUM_SH_SIGNALS*NUM_SH_SIGNALS * sizeof(float));
-                yawPitchRoll2Rzyx(pData->yaw, pData->pitch, pData->roll, pData->useRollPitchYawFlag, Rxyz);
-                getSHrotMtxReal(Rxyz, M_rot_tmp, SH_ORDER);
-                for (i = 0; i < NUM_SH_SIGNALS; i++)
-                    for (j = 0; j < NUM_SH_SIGNALS; j++)
-                        pData->M_rot[i][j] = cmplxf(M_rot_tmp[i*NUM_SH_SIGNALS + j], 0.0f);
-                free(M_rot_tmp);
-                pData->recalc_M_rotFLAG = 0;
-            }
-            for (band = 0; band < HYBRID_BANDS; band++) {
-                cblas_cgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, NUM_SH_SIGNALS, TIME_SLOTS, NUM_SH_SIGNALS, &calpha,
-                            pData->M_rot, NUM_SH_SIGNALS,
-                            FLATTEN2D(pData->SHframeTF[band]), TIME_SLOTS, &cbeta,
-                            FLATTEN2D(pData->SHframeTF_rot), TIME_SLOTS);
-                memcpy(FLATTEN2D(pData->SHframeTF[band]), FLATTEN2D(pData->SHframeTF_rot), NUM_SH_SIGNALS*TIME_SLOTS*sizeof(float_complex));
-            }
+        if(gateClosed){
+            /* Decay the covariance matrices, as if the input were zero */
+            cblas_sscal(2*MAX_NUM_BANDS*NUM_SH_SIGNALS*NUM_SH_SIGNALS, covAvgCoeff, (float*)pData->Cx, 1);
+            cblas_sscal(2*MAX_NUM_BANDS*NUM_EARS*NUM_EARS, covAvgCoeff, (float*)pData->Cambi, 1);
+            cblas_sscal(2*MAX_NUM_BANDS*NUM_EARS*NUM_EARS, covAvgCoeff, (float*)pData->Cy, 1);
+            pData->gateClosed = 1;
+            pData->nGatedFrames++;
+            pData->metadata.nAnalysedBands = 0;
+            pData->renderMetadataPending = 0;
+            hcropaclib_zeroOutputs(outputs, outSampleStride, nOutputs, frameSize);
+            HCROPAC_PROFILE_MARK(pData, HCROPAC_PROFILE_INPUT);
+            HCROPAC_PROFILE_END_FRAME(pData);
+            pData->procStatus = PROC_STATUS_NOT_ONGOING;
+            return;
         }
-
-        /* mix to headphones via linear decoding */
-        for (band = 0; band < HYBRID_BANDS; band++) {
-            cblas_cgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, NUM_EARS, TIME_SLOTS, NUM_SH_SIGNALS, &calpha,
-                        pars->M_dec[band], NUM_SH_SIGNALS,
-                        FLATTEN2D(pData->SHframeTF[band]), TIME_SLOTS, &cbeta,
-                        FLATTEN2D(pData->ambiframeTF[band]), TIME_SLOTS);
+        else if(pData->gateClosed){
+            /* Gate has just re-opened; the tails were already flushed before it closed, so start again from silence */
+            hcropaclib_tftClearBuffers(hCroPaC);
 #ifdef ENABLE_RESIDUAL_STREAM
-            for(i=0; i<NUM_EARS; i++){
-                for(t=0; t<TIME_SLOTS; t++)
-                    pData->decorrelatedframeTF[band][i][t] = pData->circBufferFrames[band][i][TIME_SLOTS*(NUM_DECOR_FRAMES)+t-pData->decorrelationDelays[band][i]];
-            }
-            for(i=0; i<NUM_EARS; i++){
-                for(t=0; t<TIME_SLOTS*NUM_DECOR_FRAMES; t++)
-                    pData->circBufferFrames[band][i][t] = pData->circBufferFrames[band][i][t+TIME_SLOTS];
-                memcpy(&(pData->circBufferFrames[band][i][NUM_DECOR_FRAMES*TIME_SLOTS]), pData->ambiframeTF[band][i], TIME_SLOTS*sizeof(float_complex));
-            }
+            memset(pData->transientDetector1, 0, MAX_NUM_BANDS*NUM_EARS*sizeof(float));
+            memset(pData->transientDetector2, 0, MAX_NUM_BANDS*NUM_EARS*sizeof(float));
+            memset(pData->circBufferFrames, 0, MAX_NUM_BANDS*NUM_EARS*(NUM_DECOR_SLOTS+MAX_TIME_SLOTS)*sizeof(float_complex));
 #endif
+            if(pData->hMatrixConv != NULL)
+                saf_matrixConv_reset(pData->hMatrixConv);
+            pData->gateClosed = 0;
         }
-            
-        /* update covarience matrix per band */
-        for(band=0; band<HYBRID_BANDS; band++){
-            /* For input SH */
-            cblas_cgemm(CblasRowMajor, CblasNoTrans, CblasConjTrans, NUM_SH_SIGNALS, NUM_SH_SIGNALS, TIME_SLOTS, &calpha,
-                        FLATTEN2D(pData->SHframeTF[band]), TIME_SLOTS,
-                        FLATTEN2D(pData->SHframeTF[band]), TIME_SLOTS, &cbeta,
-                        Cx_new, NUM_SH_SIGNALS);
+
+        /* Linear decoding via partitioned convolution, which bypasses the TFT entirely */
+        if(useFIR){
+            if(!pData->firActive)
+                saf_matrixConv_reset(pData->hMatrixConv);
+            pData->firActive = 1;
             for(i=0; i<NUM_SH_SIGNALS; i++)
-                for(j=0; j<NUM_SH_SIGNALS; j++)
-                    pData->Cx[band][i][j] = ccaddf(crmulf(pData->Cx[band][i][j], covAvgCoeff), crmulf(Cx_new[i][j], 1.0f-covAvgCoeff));
-                
-            /* For prototype */
-            cblas_cgemm(CblasRowMajor, CblasNoTrans, CblasConjTrans, NUM_EARS, NUM_EARS, TIME_SLOTS, &calpha,
-                        FLATTEN2D(pData->ambiframeTF[band]), TIME_SLOTS,
-                        FLATTEN2D(pData->ambiframeTF[band]), TIME_SLOTS, &cbeta,
-                        Cambi_new, NUM_EARS);
-            for(i=0; i<NUM_EARS; i++)
-                for(j=0; j<NUM_EARS; j++)
-                    pData->Cambi[band][i][j] = ccaddf(crmulf(pData->Cambi[band][i][j], covAvgCoeff), crmulf(Cambi_new[i][j], 1.0f-covAvgCoeff));
+                if(inTD[i] != pData->SHFrameTD[i])
+                    memcpy(pData->SHFrameTD[i], inTD[i], frameSize*sizeof(float)); /* the convolver takes one contiguous block */
+            firIn = FLATTEN2D(pData->SHFrameTD);
+            if(enableRot){
+                if(pData->recalc_M_rotFLAG){
+                    hcropaclib_calcRotationMatrix(hCroPaC);
+                    pData->recalc_M_rotFLAG = 0;
+                }
+                cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, NUM_SH_SIGNALS, frameSize, NUM_SH_SIGNALS, 1.0f,
+                            (float*)pData->M_rot, NUM_SH_SIGNALS,
+                            FLATTEN2D(pData->SHFrameTD), frameSize, 0.0f,
+                            FLATTEN2D(pData->SHFrameTD_rot), frameSize);
+                firIn = FLATTEN2D(pData->SHFrameTD_rot);
+            }
+            saf_matrixConv_apply(pData->hMatrixConv, firIn, FLATTEN2D(pData->binFrameTD));
+            pData->renderMetadataPending = 0;
+            for (ch = 0; ch < SAF_MIN(NUM_EARS, nOutputs); ch++)
+                for (n = 0; n < frameSize; n++)
+                    outputs[ch][n*outSampleStride] = pData->binFrameTD[ch][n];
+            if(nOutputs > NUM_EARS)
+                hcropaclib_zeroOutputs(&outputs[NUM_EARS], outSampleStride, nOutputs-NUM_EARS, frameSize);
+            HCROPAC_PROFILE_MARK(pData, HCROPAC_PROFILE_INPUT);
+            HCROPAC_PROFILE_END_FRAME(pData);
+            pData->procStatus = PROC_STATUS_NOT_ONGOING;
+            return;
+        }
+        else if(pData->firActive){
+            /* Switching back from the FIR decoder; the TFT buffers are out of date */
+            hcropaclib_tftClearBuffers(hCroPaC);
+            pData->firActive = 0;
         }
+
+        hcropaclib_updateAnalysisOnlyState(hCroPaC, analysisOnly, 1);
+        HCROPAC_PROFILE_MARK(pData, HCROPAC_PROFILE_INPUT);
         
-        /* CroPaC analysis/synthesis per band */
-        for(band=0; band<HYBRID_BANDS; band++){
-            if(pData->freqVector[band] < anaLim){
-                /* optain powermap */
-                cblas_cgemm(CblasRowMajor, CblasTrans, CblasNoTrans, TIME_SLOTS, pars->grid_nDirs, NUM_SH_SIGNALS, &calpha,
-                            FLATTEN2D(pData->SHframeTF[band]), TIME_SLOTS,
-                            pars->Y_grid_cmplx, pars->grid_nDirs, &cbeta,
-                            pars->pwdmap_cmplx, pars->grid_nDirs);
-                
-                /* determine which directions have the most energy per time instance */
-                for(i=0; i<TIME_SLOTS; i++){
-                    utility_cimaxv(&pars->pwdmap_cmplx[i*(pars->grid_nDirs)], pars->grid_nDirs, &dir_max_idx[i]);
+        /* Apply time-frequency transform (TFT) */
+        hcropaclib_tftForward(hCroPaC, inTD, frameSize, pData->SHframeTF);
+        HCROPAC_PROFILE_MARK(pData, HCROPAC_PROFILE_TFT_FORWARD);
+
+        /* Main processing */
+        outTF = hcropaclib_processFrameTF(hCroPaC, analysisOnly);
+        if(outTF == NULL){
+            /* analysis-only mode */
+            hcropaclib_zeroOutputs(outputs, outSampleStride, nOutputs, frameSize);
+            HCROPAC_PROFILE_MARK(pData, HCROPAC_PROFILE_OUTPUT);
+            HCROPAC_PROFILE_END_FRAME(pData);
+            pData->procStatus = PROC_STATUS_NOT_ONGOING;
+            return;
+        }
+
+        /* inverse-TFT; written directly to contiguous outputs (the inputs have already been consumed, so may alias) */
+        directOutput = outSampleStride == 1 && nOutputs >= NUM_EARS;
+        for (ch = 0; ch < NUM_EARS; ch++)
+            outTD[ch] = directOutput ? outputs[ch] : pData->binFrameTD[ch];
+        hcropaclib_tftBackward(hCroPaC, outTF, frameSize, outTD);
+        HCROPAC_PROFILE_MARK(pData, HCROPAC_PROFILE_TFT_BACKWARD);
+
+        /* Copy to output */
+        if(!directOutput){
+            for (ch = 0; ch < SAF_MIN(NUM_EARS, nOutputs); ch++)
+                for (n = 0; n < frameSize; n++)
+                    outputs[ch][n*outSampleStride] = pData->binFrameTD[ch][n];
+        }
+        if(nOutputs > NUM_EARS)
+            hcropaclib_zeroOutputs(&outputs[NUM_EARS], outSampleStride, nOutputs-NUM_EARS, frameSize);
+        HCROPAC_PROFILE_MARK(pData, HCROPAC_PROFILE_OUTPUT);
+        HCROPAC_PROFILE_END_FRAME(pData);
+    }
+    else
+        hcropaclib_zeroOutputs(outputs, outSampleStride, nOutputs, nSamples);
+    
+    pData->procStatus = PROC_STATUS_NOT_ONGOING;
+}
+
+float_complex*** hcropaclib_processFrameTF
+(
+    void* const hCroPaC,
+    int         analysisOnly
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    codecPars* pars = pData->pars;
+    int n, i, j, k, band, nSlots, nBands, nAudibleBands, nAnalysedBands, nSkippedBands;
+    int nDirSlots, nAnalysedSlots, nDiffuseSlots, nDiffuseBands, dirSlots[MAX_TIME_SLOTS];
+    int dir_max_idx[MAX_TIME_SLOTS];
+    const float_complex calpha = cmplxf(1.0f, 0.0f), cbeta = cmplxf(0.0f, 0.0f);
+    float inputEnergy[MAX_TIME_SLOTS], G[MAX_TIME_SLOTS], Ex, Eambi, maxBandEnergy, Edir;
+    float bandEnergy[MAX_NUM_BANDS];
+    hcropaclib_metadata *md, *renderMd;
+    float azi[MAX_TIME_SLOTS], elev[MAX_TIME_SLOTS], dirAzi[MAX_TIME_SLOTS], dirElev[MAX_TIME_SLOTS];
+    float_complex Cdir[NUM_EARS][NUM_EARS], Cdiff[NUM_EARS][NUM_EARS], hrtf_interp[MAX_TIME_SLOTS][NUM_EARS];
+    float_complex B, GB[MAX_TIME_SLOTS];
+    float w[NUM_SH_SIGNALS], y[MAX_TIME_SLOTS][NUM_SH_SIGNALS];
+    float_complex y_dir[MAX_TIME_SLOTS][NUM_EARS], y_diff[MAX_TIME_SLOTS][NUM_EARS];
+    float_complex M_dec_y;
+#ifdef ENABLE_BINAURAL_DIFF_COH
+    float_complex U[NUM_EARS][NUM_EARS], U_Cdiff[NUM_EARS][NUM_EARS];
+#endif
+
+    /* local copies of user parameters */
+    int enableRot, enableCroPaC, enableBandSkipping;
+    float covAvgCoeff, anaLim, bandSkipFloor;
+    float balance[MAX_NUM_BANDS], eq[MAX_NUM_BANDS];
+
+    /* copy user parameters to local variables */
+    nSlots = pData->nSlots;
+    enableRot = pData->enableRotation;
+    covAvgCoeff = powf(pData->covAvgCoeff, (float)nSlots/(float)COV_AVG_REF_SLOTS); /* same time constant, regardless of frame size */
+    enableCroPaC = pData->enableCroPaC;
+    anaLim = pData->anaLimit_hz;
+    memcpy(balance, pData->balance, MAX_NUM_BANDS*sizeof(float));
+    memcpy(eq, pData->EQ, MAX_NUM_BANDS*sizeof(float));
+    enableBandSkipping = pData->enableBandSkipping;
+    bandSkipFloor = powf(10.0f, pData->bandSkipFloor_dB/10.0f);
+    nBands = pData->nBands;
+    nAudibleBands = pData->nAudibleBands;
+
+    md = &(pData->metadata);
+    renderMd = pData->renderMetadataPending ? &(pData->renderMetadata) : NULL;
+    pData->renderMetadataPending = 0;
+    if(renderMd != NULL && (renderMd->nBands != nBands || renderMd->nTimeSlots != nSlots || renderMd->nAnalysedBands > nAudibleBands))
+        renderMd = NULL; /* configuration changed since it was passed */
+    md->nBands = nBands;
+    md->nTimeSlots = nSlots;
+    memcpy(md->freqVector, pData->freqVector, nBands*sizeof(float));
+
+    /* Apply rotation */
+    if (enableRot) {
+        if(pData->recalc_M_rotFLAG){
+            hcropaclib_calcRotationMatrix(hCroPaC);
+            pData->recalc_M_rotFLAG = 0;
+        }
+        hcropaclib_rotateFrameTF(hCroPaC, nBands, nSlots);
+        HCROPAC_PROFILE_MARK(pData, HCROPAC_PROFILE_ROTATION);
+    }
+
+    /* mix to headphones via linear decoding; the EQ is folded into the decoder, except where the prototype
+     * signals undergo CroPaC processing (there it is instead folded into the mixing matrices); not
+     * required in analysis-only mode */
+    if(!analysisOnly)
+        hcropaclib_decodeFrameTF(hCroPaC, nBands, nAudibleBands, nSlots, enableCroPaC);
+    HCROPAC_PROFILE_MARK(pData, HCROPAC_PROFILE_DECODING);
+        
+    /* update covarience matrix per band */
+    maxBandEnergy = hcropaclib_updateCovariances(hCroPaC, nAudibleBands, nSlots, covAvgCoeff, !analysisOnly, bandEnergy);
+    HCROPAC_PROFILE_MARK(pData, HCROPAC_PROFILE_COVARIANCES);
+    
+    /* CroPaC analysis/synthesis per band */
+    nAnalysedBands = nSkippedBands = nAnalysedSlots = nDiffuseSlots = nDiffuseBands = 0;
+    for(band=0; band<nAudibleBands; band++){
+        if(renderMd != NULL ? band < renderMd->nAnalysedBands : pData->freqVector[band] < anaLim){
+            /* Bands with negligible energy (or those skipped by the encoder) keep their previous mixing matrices */
+            nAnalysedBands++;
+            if(renderMd != NULL ? renderMd->dirIdx[band][0] < 0 : enableBandSkipping && bandEnergy[band] < bandSkipFloor*maxBandEnergy){
+                nSkippedBands++;
+                for(i=0; i<nSlots && renderMd == NULL; i++){
+                    md->dirIdx[band][i] = -1;
+                    md->azi[band][i] = md->elev[band][i] = md->gain[band][i] = 0.0f;
+                    md->directEnergy[band][i] = md->diffuseEnergy[band][i] = 0.0f;
+                }
+                continue;
+            }
+
+            if(renderMd == NULL){
+                /* optain powermap, and determine which directions have the most energy per time instance */
+                hcropaclib_powermapArgmax(FLATTEN2D(pData->SHframeTF[band]), nSlots, pars->Y_grid_fmt, pars->grid_nDirs, pars->pwdmap, dir_max_idx);
+                for(i=0; i<nSlots; i++){
                     azi[i] = pars->grid_dirs_deg[dir_max_idx[i]*2];
                     elev[i] = pars->grid_dirs_deg[dir_max_idx[i]*2+1];
                 }
+            }
+            else{
+                /* the directions were transmitted, so there is no need for the power-map */
+                for(i=0; i<nSlots; i++){
+                    azi[i] = renderMd->azi[band][i];
+                    elev[i] = renderMd->elev[band][i];
+                }
+            }
  
-                /* calculate CroPaC Gains, G */
-                for(i=0; i<TIME_SLOTS; i++){
-                    for(j=0; j<NUM_SH_SIGNALS; j++)
-                        inputFrame_s[j] = pData->SHframeTF[band][j][i];
-                    inputEnergy = powf(cabsf(pData->SHframeTF[band][0][i]), 2.0f) +
-                                    powf(cabsf(crdivf(pData->SHframeTF[band][1][i],sqrtf(3.0f))), 2.0f) +
-                                    powf(cabsf(crdivf(pData->SHframeTF[band][2][i],sqrtf(3.0f))), 2.0f) +
-                                    powf(cabsf(crdivf(pData->SHframeTF[band][3][i],sqrtf(3.0f))), 2.0f) + 2.23e-8f;
-                    cblas_cgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, NUM_SH_SIGNALS, 1, NUM_SH_SIGNALS, &calpha,
-                                &(pars->M_rot[dir_max_idx[i]*NUM_SH_SIGNALS*NUM_SH_SIGNALS]), NUM_SH_SIGNALS,
-                                inputFrame_s, 1, &cbeta,
-                                inputFrame_rot, 1);
-                    G = SAF_MAX(0.0f, 2.0f*crealf( ccmulf(conjf(inputFrame_rot[0]), crmulf(inputFrame_rot[3], 1.0f/sqrtf(3.0f))) ) /inputEnergy);
-                    for(j=0; j<NUM_SH_SIGNALS; j++){
-                        y[i][j] = pars->Y_grid_cmplx[j*(pars->grid_nDirs)+dir_max_idx[i]];
-                        w[j] = crdivf(y[i][j], (float)NUM_SH_SIGNALS);
+            /* calculate CroPaC Gains, G (unless these were transmitted) */
+            hcropaclib_cropacGainsBand(hCroPaC, band, nSlots, renderMd == NULL ? dir_max_idx : NULL, inputEnergy, G);
+            if(renderMd != NULL)
+                memcpy(G, renderMd->gain[band], nSlots*sizeof(float));
+            nDirSlots = 0;
+            for(i=0; i<nSlots; i++){
+                /* Slots with zero CroPaC gain are entirely diffuse, and take the short path */
+                if(G[i] > 0.0f){
+                    if(renderMd == NULL){
+                        for(j=0; j<NUM_SH_SIGNALS; j++){
+                            y[i][j] = pars->Y_grid[j*(pars->grid_nDirs)+dir_max_idx[i]];
+                            w[j] = pars->Y_grid_fmt[j*(pars->grid_nDirs)+dir_max_idx[i]];
+                        }
                     }
-                    utility_cvvdot(w, inputFrame_s, NUM_SH_SIGNALS, NO_CONJ, &B);
-                    GB[i] = crmulf(B,G);
+                    else
+                        hcropaclib_getSteeringVectors(hCroPaC, enableRot, &azi[i], &elev[i], y[i], w);
+                    B = cmplxf(0.0f, 0.0f);
+                    for(j=0; j<NUM_SH_SIGNALS; j++)
+                        B = ccaddf(B, crmulf(pData->SHframeTF[band][j][i], w[j]/(float)NUM_SH_SIGNALS));
+                    GB[i] = crmulf(B,G[i]);
+                    dirSlots[nDirSlots] = i;
+                    dirAzi[nDirSlots] = azi[i];
+                    dirElev[nDirSlots] = elev[i];
+                    nDirSlots++;
                 }
-
-                /* interpolate HRTFs */
-                hcropaclib_interpHRTFs(hCroPaC, band, azi, elev, hrtf_interp);
-
-                /* Construct target covariance matrix, Cy */
-                for(i=0; i<TIME_SLOTS; i++){
-                    for(j=0; j<NUM_EARS; j++)
-                        y_dir[i][j] = ccmulf(hrtf_interp[i][j], GB[i]);
-                    for(j=0; j<NUM_SH_SIGNALS; j++){
-                        a_diff[j] = ccmulf(y[i][j], GB[i]);
-                        a_diff[j] = ccsubf(pData->SHframeTF[band][j][i], a_diff[j]);
-                    }
-                    cblas_cgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, NUM_EARS, 1, NUM_SH_SIGNALS, &calpha,
-                                pars->M_dec[band], NUM_SH_SIGNALS,
-                                a_diff, 1, &cbeta,
-                                y_diff[i], 1);
+                else
+                    GB[i] = cmplxf(0.0f, 0.0f);
+
+                /* metadata; the input energy is twice the omnidirectional-equivalent energy */
+                if(renderMd == NULL){
+                    Edir = crealf(GB[i])*crealf(GB[i]) + cimagf(GB[i])*cimagf(GB[i]);
+                    md->dirIdx[band][i] = dir_max_idx[i];
+                    md->azi[band][i] = azi[i];
+                    md->elev[band][i] = elev[i];
+                    md->gain[band][i] = G[i];
+                    md->directEnergy[band][i] = Edir;
+                    md->diffuseEnergy[band][i] = SAF_MAX(0.0f, 0.5f*inputEnergy[i] - Edir);
                 }
-                cblas_cgemm(CblasRowMajor, CblasConjTrans, CblasNoTrans, NUM_EARS, NUM_EARS, TIME_SLOTS, &calpha,
-                            y_dir, NUM_EARS,
-                            y_dir, NUM_EARS, &cbeta,
-                            Cdir, NUM_EARS);
-                cblas_cgemm(CblasRowMajor, CblasConjTrans, CblasNoTrans, NUM_EARS, NUM_EARS, TIME_SLOTS, &calpha,
-                            y_diff, NUM_EARS,
-                            y_diff, NUM_EARS, &cbeta,
-                            Cdiff, NUM_EARS);
-                
-                /* adjust balance */
-                for(i=0; i<NUM_EARS; i++){
+            }
+            nAnalysedSlots += nSlots;
+            nDiffuseSlots += nSlots - nDirSlots;
+            if(nDirSlots == 0)
+                nDiffuseBands++;
+            HCROPAC_PROFILE_MARK(pData, HCROPAC_PROFILE_ANALYSIS);
+            if(analysisOnly)
+                continue;
+
+            /* interpolate HRTFs, only for the slots that have a direct component */
+            if(nDirSlots > 0)
+                hcropaclib_interpHRTFs(hCroPaC, band, nDirSlots, dirAzi, dirElev, hrtf_interp);
+
+            /* Construct target covariance matrix, Cy */
+            for(n=0; n<nDirSlots; n++)
+                for(j=0; j<NUM_EARS; j++)
+                    y_dir[n][j] = ccmulf(hrtf_interp[n][j], GB[dirSlots[n]]);
+            for(i=0, n=0; i<nSlots; i++){
+                if(n<nDirSlots && dirSlots[n]==i){
+                    /* M_dec*(x - GB*y) = prototype - GB*(M_dec*y), with y in ACN/N3D */
                     for(j=0; j<NUM_EARS; j++){
-                        if (balance[band] > 1)
-                            Cdiff[i][j] = crmulf(Cdiff[i][j], 2.0f - balance[band]);
-                        else
-                            Cdir[i][j] = crmulf(Cdir[i][j], balance[band]);
+                        M_dec_y = cmplxf(0.0f, 0.0f);
+                        for(k=0; k<NUM_SH_SIGNALS; k++)
+                            M_dec_y = ccaddf(M_dec_y, crmulf(pars->M_dec[band][j][k], y[i][k]));
+                        y_diff[i][j] = ccsubf(pData->ambiframeTF[band][j][i], ccmulf(GB[i], M_dec_y));
                     }
+                    n++;
                 }
-       
-                /* Account for binaural diffuse coherence */
-#ifdef ENABLE_BINAURAL_DIFF_COH
-                U[0][0] = ccdivf(pData->Cambi[band][0][0], ccaddf(pData->Cambi[band][0][0], pData->Cambi[band][1][1]));
-                U[0][1] = cmplxf(pars->binDiffuseCoh[band], 0.0f);
-                U[1][0] = cmplxf(pars->binDiffuseCoh[band], 0.0f);
-                U[1][1] = ccdivf(pData->Cambi[band][1][1], ccaddf(pData->Cambi[band][0][0], pData->Cambi[band][1][1]));
-                cblas_cgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, NUM_EARS, NUM_EARS, NUM_EARS, &calpha,
-                            U, NUM_EARS,
-                            Cdiff, NUM_EARS, &cbeta,
-                            U_Cdiff, NUM_EARS);
-                memcpy(Cdiff, U_Cdiff, NUM_EARS*NUM_EARS*sizeof(float_complex));
-#endif
-                /* Average Cy over time */
-                for(i=0; i<NUM_EARS; i++)
+                else{
+                    /* no direct component, so the diffuse stream is simply the prototype */
                     for(j=0; j<NUM_EARS; j++)
-                        pData->Cy[band][i][j] = ccaddf(crmulf(pData->Cy[band][i][j], covAvgCoeff), crmulf(ccaddf(conjf(Cdir[i][j]), conjf(Cdiff[i][j])), 1.0f-covAvgCoeff)); //
-
-                /* formulate optimal mixing matrix */
-#ifdef ENABLE_RESIDUAL_STREAM
-                float diag_Cambi[NUM_EARS][NUM_EARS] = {{0.0f}};
-                diag_Cambi[0][0] = crealf(pData->Cambi[band][0][0]);
-                diag_Cambi[1][1] = crealf(pData->Cambi[band][1][1]);
-                formulate_M_and_Cr_cmplx(pData->hCdf, (float_complex*)pData->Cambi[band], (float_complex*)pData->Cy[band], (float_complex*)eye2,
-                                            0, 0.2f, (float_complex*)pData->new_M[band], (float_complex*)Cr);
-                /* Convert residual to real */
-                for(i=0; i<NUM_EARS; i++)
-                    for(j=0; j<NUM_EARS; j++)
-                        Cr_real[i][j] = crealf(Cr[i][j]);
-
-                /* Compute residual mixing matrix */
-                formulate_M_and_Cr(pData->hCdf_res, (float*)diag_Cambi, (float*)Cr_real, (float*)real_eye2,
-                                            0, 0.2f, (float*)pData->new_Mr[band], NULL);
-#else
-                formulate_M_and_Cr_cmplx(pData->hCdf, (float_complex*)pData->Cambi[band], (float_complex*)pData->Cy[band], (float_complex*)eye2,
-                                            1, 0.2f, (float_complex*)pData->new_M[band], NULL);
-#endif
-            }
-            else{
-                Ex = Eambi = 0.0f;
-                for(i=0; i<NUM_SH_SIGNALS; i++)
-                    Ex += crealf(pData->Cx[band][i][i]);
-                for(i=0; i<NUM_EARS; i++)
-                    Eambi += crealf(pData->Cambi[band][i][i]);
-                Ex /= (float)NUM_SH_SIGNALS;
-                Eambi /= (float)NUM_EARS;
-                Eambi += 2.23e-7f;
-                memset(pData->new_M[band], 0, NUM_EARS*NUM_EARS*sizeof(float_complex));
-                for(i=0; i<NUM_EARS; i++)
-                    pData->new_M[band][i][i] = cmplxf(sqrtf(Ex/Eambi), 0.0f);
-#ifdef ENABLE_RESIDUAL_STREAM
-                memset(pData->new_Mr[band], 0, NUM_EARS*NUM_EARS*sizeof(float));
-#endif
+                        y_diff[i][j] = pData->ambiframeTF[band][j][i];
+                }
             }
-        }
+            if(nDirSlots > 0)
+                cblas_cgemm(CblasRowMajor, CblasConjTrans, CblasNoTrans, NUM_EARS, NUM_EARS, nDirSlots, &calpha,
+                            y_dir, NUM_EARS,
+                            y_dir, NUM_EARS, &cbeta,
+                            Cdir, NUM_EARS);
+            else
+                memset(Cdir, 0, NUM_EARS*NUM_EARS*sizeof(float_complex));
+            cblas_cgemm(CblasRowMajor, CblasConjTrans, CblasNoTrans, NUM_EARS, NUM_EARS, nSlots, &calpha,
+                        y_diff, NUM_EARS,
+                        y_diff, NUM_EARS, &cbeta,
+                        Cdiff, NUM_EARS);
             
-        /* extract onsets from decorrelation buffer */
-#ifdef ENABLE_RESIDUAL_STREAM
-        float alpha, beta, detectorEne, transientEQ;
-        alpha = 0.95f;
-        beta = 0.995f;
-        for(band=0; band<HYBRID_BANDS; band++){
+            /* adjust balance */
             for(i=0; i<NUM_EARS; i++){
-                for(t=TIME_SLOTS*(NUM_DECOR_FRAMES-1); t<TIME_SLOTS*NUM_DECOR_FRAMES; t++){
-                    detectorEne = powf(cabsf(pData->circBufferFrames[band][i][t]), 2.0f);
-                    pData->transientDetector1[band][i] *= alpha;
-                    if(pData->transientDetector1[band][i]<detectorEne)
-                        pData->transientDetector1[band][i] = detectorEne;
-                    pData->transientDetector2[band][i] = pData->transientDetector2[band][i]*beta + (1.0f-beta)*(pData->transientDetector1[band][i]);
-                    if(pData->transientDetector2[band][i]>pData->transientDetector1[band][i])
-                        pData->transientDetector2[band][i] = pData->transientDetector1[band][i];
-                    transientEQ = SAF_MIN(1.0f, 4.0f*(pData->transientDetector2[band][i])/(pData->transientDetector1[band][i]+2.e-9f));
-                    pData->circBufferFrames[band][i][t] = crmulf(pData->circBufferFrames[band][i][t], transientEQ);
+                for(j=0; j<NUM_EARS; j++){
+                    if (balance[band] > 1)
+                        Cdiff[i][j] = crmulf(Cdiff[i][j], 2.0f - balance[band]);
+                    else
+                        Cdir[i][j] = crmulf(Cdir[i][j], balance[band]);
                 }
             }
-        }
+   
+            /* Account for binaural diffuse coherence */
+#ifdef ENABLE_BINAURAL_DIFF_COH
+            U[0][0] = ccdivf(pData->Cambi[band][0][0], ccaddf(pData->Cambi[band][0][0], pData->Cambi[band][1][1]));
+            U[0][1] = cmplxf(pars->binDiffuseCoh[band], 0.0f);
+            U[1][0] = cmplxf(pars->binDiffuseCoh[band], 0.0f);
+            U[1][1] = ccdivf(pData->Cambi[band][1][1], ccaddf(pData->Cambi[band][0][0], pData->Cambi[band][1][1]));
+            cblas_cgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, NUM_EARS, NUM_EARS, NUM_EARS, &calpha,
+                        U, NUM_EARS,
+                        Cdiff, NUM_EARS, &cbeta,
+                        U_Cdiff, NUM_EARS);
+            memcpy(Cdiff, U_Cdiff, NUM_EARS*NUM_EARS*sizeof(float_complex));
 #endif
-
-        /* Apply mixing matrices */
-        for(band=0; band<HYBRID_BANDS; band++){
-            for(t=0; t<TIME_SLOTS; t++){
+            /* Average Cy over time */
+            for(i=0; i<NUM_EARS; i++)
                 for(j=0; j<NUM_EARS; j++)
-                    inFrame_t[j] = pData->ambiframeTF[band][j][t];
-                for (i = 0; i < NUM_EARS; i++) {
-                    for (j = 0; j < NUM_EARS; j++) {
-#ifndef _MSC_VER
-                        interp_M[i][j] = pData->interpolator[t]*pData->new_M[band][i][j] + (1.0f-pData->interpolator[t])*pData->current_M[band][i][j];
-#else
-                        interp_M[i][j] = ccaddf(crmulf(pData->new_M[band][i][j], pData->interpolator[t]), crmulf(pData->current_M[band][i][j], 1.0f - pData->interpolator[t]));
-#endif
-                    }
-                }
-                for(i=0; i<NUM_EARS; i++)
-                    utility_cvvdot(interp_M[i], inFrame_t, NUM_EARS, NO_CONJ, &outFrame_t[i]);
-                for(i=0; i<NUM_EARS; i++)
-                    pData->binframeTF[band][i][t] = outFrame_t[i];
-            }
-                
+                    pData->Cy[band][i][j] = ccaddf(crmulf(pData->Cy[band][i][j], covAvgCoeff), crmulf(ccaddf(conjf(Cdir[i][j]), conjf(Cdiff[i][j])), 1.0f-covAvgCoeff)); //
+
+            /* formulate optimal mixing matrix */
+            hcropaclib_formulateMixingMatrices(hCroPaC, band);
+        }
+        else if(!analysisOnly){
+            Ex = Eambi = 0.0f;
+            for(i=0; i<NUM_SH_SIGNALS; i++)
+                Ex += pData->energyWeights[i] * crealf(pData->Cx[band][i][i]);
+            for(i=0; i<NUM_EARS; i++)
+                Eambi += crealf(pData->Cambi[band][i][i]);
+            Ex /= (float)NUM_SH_SIGNALS;
+            Eambi /= (float)NUM_EARS;
+            Eambi += 2.23e-7f;
+            memset(pData->new_M[band], 0, NUM_EARS*NUM_EARS*sizeof(float_complex));
+            for(i=0; i<NUM_EARS; i++)
+                pData->new_M[band][i][i] = cmplxf(sqrtf(Ex/Eambi), 0.0f);
 #ifdef ENABLE_RESIDUAL_STREAM
-            for(t=0; t<TIME_SLOTS; t++){
-                for(j=0; j<NUM_EARS; j++)
-                    inFrame_t[j] = pData->decorrelatedframeTF[band][j][t];
-                    
-                for (i = 0; i < NUM_EARS; i++) {
-                    for (j = 0; j < NUM_EARS; j++) {
-#ifndef _MSC_VER
-                        interp_M[i][j] = pData->interpolator[t]*pData->new_Mr[band][i][j] + (1.0f-pData->interpolator[t])*pData->current_Mr[band][i][j];
-#else
-                        interp_M[i][j] = cmplxf(pData->new_Mr[band][i][j] * pData->interpolator[t] + pData->current_Mr[band][i][j] * (1.0f - pData->interpolator[t]), 0.0f);
-#endif
-                    }
-                }
-                for(i=0; i<NUM_EARS; i++)
-                    utility_cvvdot(interp_M[i], inFrame_t, NUM_EARS, NO_CONJ, &outFrame_t[i]);
-                for(i=0; i<NUM_EARS; i++)
-                    pData->binframeTF[band][i][t] = ccaddf(pData->binframeTF[band][i][t], outFrame_t[i]);
-            } 
+            memset(pData->new_Mr[band], 0, NUM_EARS*NUM_EARS*sizeof(float));
 #endif
         }
-            
-        /* for next frame */
-        memcpy(pData->current_M, pData->new_M, HYBRID_BANDS*NUM_EARS*NUM_EARS*sizeof(float_complex));
+        HCROPAC_PROFILE_MARK(pData, HCROPAC_PROFILE_SYNTHESIS);
+    }
+    pData->nAnalysedBands += nAnalysedBands;
+    pData->nSkippedBands += nSkippedBands;
+    pData->nAnalysedSlots += nAnalysedSlots;
+    pData->nDiffuseSlots += nDiffuseSlots;
+    pData->nDiffuseBands += nDiffuseBands;
+    md->nAnalysedBands = renderMd == NULL ? nAnalysedBands : 0; /* no analysis when rendering from transmitted metadata */
+    if(analysisOnly)
+        return NULL;
+        
+    /* extract onsets from decorrelation buffer */
 #ifdef ENABLE_RESIDUAL_STREAM
-        memcpy(pData->current_Mr, pData->new_Mr, HYBRID_BANDS*NUM_EARS*NUM_EARS*sizeof(float));
+    hcropaclib_transientDetector(hCroPaC, nAudibleBands, nSlots);
 #endif
-  
-        /* inverse-TFT */
-        if(enableCroPaC)
-            afSTFT_backward(pData->hSTFT, pData->binframeTF, FRAME_SIZE, pData->binFrameTD);
-        else
-            afSTFT_backward(pData->hSTFT, pData->ambiframeTF, FRAME_SIZE, pData->binFrameTD);
 
-        /* Copy to output */
-        for (ch = 0; ch < SAF_MIN(NUM_EARS, nOutputs); ch++)
-            utility_svvcopy(pData->binFrameTD[ch], FRAME_SIZE, outputs[ch]);
-        for (; ch < nOutputs; ch++)
-            memset(outputs[ch], 0, FRAME_SIZE*sizeof(float));
-    }
-    else
-        for (ch=0; ch < nOutputs; ch++)
-            memset(outputs[ch],0, FRAME_SIZE*sizeof(float));
-    
-    pData->procStatus = PROC_STATUS_NOT_ONGOING;
+    /* Apply mixing matrices, with the EQ folded in */
+    hcropaclib_mixFrameTF(hCroPaC, nAudibleBands, nSlots, eq);
+        
+    /* Inaudible bands (i.e. at higher sampling rates) are simply passed through the linear decoder */
+    for(band=nAudibleBands; band<nBands; band++)
+        memcpy(FLATTEN2D(pData->binframeTF[band]), FLATTEN2D(pData->ambiframeTF[band]), NUM_EARS*MAX_TIME_SLOTS*sizeof(float_complex));
+    HCROPAC_PROFILE_MARK(pData, HCROPAC_PROFILE_MIXING);
+
+    return enableCroPaC ? pData->binframeTF : pData->ambiframeTF;
 }
 
 
+
 /* Set Functions */
 
 void hcropaclib_refreshParams(void* const hCroPaC)
 {
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_REFRESH_PARAMS, -1, 0.0f);
+    pData->reinitHRIRsFLAG = 1;
     hcropaclib_setCodecStatus(hCroPaC, CODEC_STATUS_NOT_INITIALISED);
 }
 
 void hcropaclib_setEnableCroPaC(void* const hCroPaC, int newState)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_ENABLE_CROPAC, -1, (float)newState);
     pData->enableCroPaC = newState;
 }
 
+void hcropaclib_setTransformBackend(void* const hCroPaC, int newBackend)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_TRANSFORM_BACKEND, -1, (float)newBackend);
+    if(pData->new_tftBackend != newBackend){
+        pData->new_tftBackend = newBackend;
+        hcropaclib_setCodecStatus(hCroPaC, CODEC_STATUS_NOT_INITIALISED);
+    }
+}
+
+void hcropaclib_setLinearDecoderMode(void* const hCroPaC, int newMode)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_LINEAR_DECODER_MODE, -1, (float)newMode);
+    if(pData->linearDecoderMode != newMode){
+        pData->linearDecoderMode = (HCROPAC_LINEAR_DECODER_MODES)newMode;
+        if(newMode == LINEAR_DECODER_FIR && (pData->hMatrixConv == NULL || pData->reinitFIRFLAG)){
+            pData->reinitFIRFLAG = 1;
+            hcropaclib_setCodecStatus(hCroPaC, CODEC_STATUS_NOT_INITIALISED);
+        }
+    }
+}
+
+void hcropaclib_setFrameSize(void* const hCroPaC, int newFrameSize)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    int frameSize;
+    
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_FRAME_SIZE, -1, (float)newFrameSize);
+    
+    /* round down to a supported frame size (a power-of-two multiple of the hop size) */
+    frameSize = HCROPAC_MIN_FRAME_SIZE;
+    while(2*frameSize <= SAF_MIN(newFrameSize, HCROPAC_MAX_FRAME_SIZE))
+        frameSize *= 2;
+    if(pData->new_frameSize != frameSize){
+        pData->new_frameSize = frameSize;
+        hcropaclib_setCodecStatus(hCroPaC, CODEC_STATUS_NOT_INITIALISED);
+    }
+}
+
 void hcropaclib_setBalance(void* const hCroPaC, float newValue, int bandIdx)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
-    pData->balance[bandIdx] = newValue;
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_BALANCE, bandIdx, newValue);
+    pData->balance[bandIdx] = newValue;
+}
+
+void hcropaclib_setBalanceAllBands(void* const hCroPaC, float newValue)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    int band;
+    
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_BALANCE, -1, newValue);
+    for(band=0; band<MAX_NUM_BANDS; band++)
+        pData->balance[band] = newValue;
+}
+
+void hcropaclib_setEQ(void* const hCroPaC, float newValue, int bandIdx)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_EQ, bandIdx, newValue);
+    pData->EQ[bandIdx] = newValue;
+    pData->recalc_EQFLAG = 1;
+    hcropaclib_requestFIRDecoderRebuild(hCroPaC);
+}
+
+void hcropaclib_setEQAllBands(void* const hCroPaC, float newValue)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    int band;
+    
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_EQ, -1, newValue);
+    for(band=0; band<MAX_NUM_BANDS; band++)
+        pData->EQ[band] = newValue;
+    pData->recalc_EQFLAG = 1;
+    hcropaclib_requestFIRDecoderRebuild(hCroPaC);
+}
+
+void hcropaclib_setEQfromFIR
+(
+    void* const hCroPaC,
+    const float* fir,
+    int firLen,
+    int fir_fs
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    codecPars* pars = pData->pars;
+    
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_REFRESH_PARAMS, -1, 0.0f); /* the resulting EQ is recorded by hcropaclib_initCodec() */
+    hcropaclib_setCodecStatus(hCroPaC, CODEC_STATUS_NOT_INITIALISED);
+    pars->eqFIR = realloc1d(pars->eqFIR, firLen*sizeof(float));
+    memcpy(pars->eqFIR, fir, firLen*sizeof(float));
+    pars->eqFIR_len = firLen;
+    pars->eqFIR_fs = fir_fs;
+    pData->reinitEQFLAG = 1;
+}
+
+void hcropaclib_setCovAvg(void* const hCroPaC, float newValue)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_COV_AVG, -1, newValue);
+    pData->covAvgCoeff = newValue;
+}
+
+void hcropaclib_setAnaLimit(void* const hCroPaC, float newValue)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_ANA_LIMIT, -1, newValue);
+    pData->anaLimit_hz = SAF_CLAMP(newValue, HCROPAC_ANA_LIMIT_MIN_VALUE, HCROPAC_ANA_LIMIT_MAX_VALUE);
+}
+
+void hcropaclib_setUseDefaultHRIRsflag(void* const hCroPaC, int newState)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_USE_DEFAULT_HRIRS, -1, (float)newState);
+    
+    if((!pData->useDefaultHRIRsFLAG) && (newState)){
+        pData->useDefaultHRIRsFLAG = newState;
+        pData->reinitHRIRsFLAG = 1;
+        hcropaclib_setCodecStatus(hCroPaC, CODEC_STATUS_NOT_INITIALISED);
+    }
+}
+
+void hcropaclib_setSofaFilePath(void* const hCroPaC, const char* path)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    codecPars* pars = pData->pars;
+    char* newPath;
+    
+    hcropaclib_recordPath(hCroPaC, path);
+    
+    /* handed over to hcropaclib_initCodec(), which may be reading the current path meanwhile; a previous path that
+     * it has not yet taken is replaced */
+    newPath = malloc1d(strlen(path) + 1);
+    strcpy(newPath, path);
+    free(hcropaclib_exchangePath(&(pars->new_sofa_filepath), newPath));
+    pData->useDefaultHRIRsFLAG = 0;
+    pData->reinitHRIRsFLAG = 1;
+    hcropaclib_setCodecStatus(hCroPaC, CODEC_STATUS_NOT_INITIALISED);
+}
+
+void hcropaclib_setChOrder(void* const hCroPaC, int newOrder)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_CH_ORDER, -1, (float)newOrder);
+    pData->chOrdering = (HCROPAC_CH_ORDER)newOrder;
+    pData->recalc_fmtFLAG = 1;
+    hcropaclib_requestFIRDecoderRebuild(hCroPaC);
+}
+
+void hcropaclib_setNormType(void* const hCroPaC, int newType)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_NORM_TYPE, -1, (float)newType);
+    pData->norm = (HCROPAC_NORM_TYPES)newType;
+    pData->recalc_fmtFLAG = 1;
+    hcropaclib_requestFIRDecoderRebuild(hCroPaC);
+}
+
+void hcropaclib_setEnableDiffCorrection(void* const hCroPaC, int newState)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_ENABLE_DIFF_CORRECTION, -1, (float)newState);
+    if(pData->diffCorrection != newState){
+        pData->diffCorrection = newState;
+        pData->reinitHRTFsFLAG = 1;
+        hcropaclib_setCodecStatus(hCroPaC, CODEC_STATUS_NOT_INITIALISED);
+    }
+}
+
+void hcropaclib_setHRIRsPreProc(void* const hCroPaC, HRIR_PREPROC_OPTIONS newState)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_HRIR_PREPROC, -1, (float)newState);
+    if(pData->hrirProcMode != newState){
+        pData->hrirProcMode = newState;
+        pData->reinitHRTFsFLAG = 1;
+        hcropaclib_setCodecStatus(hCroPaC, CODEC_STATUS_NOT_INITIALISED);
+    }
+}
+
+void hcropaclib_setScanningGridDensity(void* const hCroPaC, int newValue)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_SCANNING_GRID_DENSITY, -1, (float)newValue);
+    newValue = SAF_CLAMP(newValue, HCROPAC_GRID_DENSITY_MIN_VALUE, HCROPAC_GRID_DENSITY_MAX_VALUE);
+    if(pData->gridIcoFreq != newValue){
+        pData->gridIcoFreq = newValue;
+        hcropaclib_setCodecStatus(hCroPaC, CODEC_STATUS_NOT_INITIALISED);
+    }
+}
+
+void hcropaclib_setEnableRotation(void* const hCroPaC, int newState)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_ENABLE_ROTATION, -1, (float)newState);
+    pData->enableRotation = newState;
+    pData->recalc_M_rotFLAG = 1;
+}
+
+void hcropaclib_setYaw(void  * const hCroPaC, float newYaw)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_YAW, -1, newYaw);
+    pData->yaw = pData->bFlipYaw == 1 ? -DEG2RAD(newYaw) : DEG2RAD(newYaw);
+    pData->recalc_M_rotFLAG = 1;
+}
+
+void hcropaclib_setPitch(void* const hCroPaC, float newPitch)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_PITCH, -1, newPitch);
+    pData->pitch = pData->bFlipPitch == 1 ? -DEG2RAD(newPitch) : DEG2RAD(newPitch);
+    pData->recalc_M_rotFLAG = 1;
+}
+
+void hcropaclib_setRoll(void* const hCroPaC, float newRoll)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_ROLL, -1, newRoll);
+    pData->roll = pData->bFlipRoll == 1 ? -DEG2RAD(newRoll) : DEG2RAD(newRoll);
+    pData->recalc_M_rotFLAG = 1;
+}
+
+void hcropaclib_setFlipYaw(void* const hCroPaC, int newState)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_FLIP_YAW, -1, (float)newState);
+    if(newState !=pData->bFlipYaw ){
+        pData->bFlipYaw = newState;
+        hcropaclib_setYaw(hCroPaC, -hcropaclib_getYaw(hCroPaC));
+    }
+}
+
+void hcropaclib_setFlipPitch(void* const hCroPaC, int newState)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_FLIP_PITCH, -1, (float)newState);
+    if(newState !=pData->bFlipPitch ){
+        pData->bFlipPitch = newState;
+        hcropaclib_setPitch(hCroPaC, -hcropaclib_getPitch(hCroPaC));
+    }
+}
+
+void hcropaclib_setFlipRoll(void* const hCroPaC, int newState)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_FLIP_ROLL, -1, (float)newState);
+    if(newState !=pData->bFlipRoll ){
+        pData->bFlipRoll = newState;
+        hcropaclib_setRoll(hCroPaC, -hcropaclib_getRoll(hCroPaC));
+    }
 }
 
-void hcropaclib_setBalanceAllBands(void* const hCroPaC, float newValue)
+void hcropaclib_setRPYflag(void* const hCroPaC, int newState)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
-    int band;
-    
-    for(band=0; band<HYBRID_BANDS; band++)
-        pData->balance[band] = newValue;
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_RPY_FLAG, -1, (float)newState);
+    pData->useRollPitchYawFlag = newState;
 }
 
-void hcropaclib_setCovAvg(void* const hCroPaC, float newValue)
+void hcropaclib_setEnableSilenceGate(void* const hCroPaC, int newState)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
-    pData->covAvgCoeff = newValue;
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_ENABLE_SILENCE_GATE, -1, (float)newState);
+    pData->enableGate = newState;
 }
 
-void hcropaclib_setAnaLimit(void* const hCroPaC, float newValue)
+void hcropaclib_setSilenceGateThreshold(void* const hCroPaC, float newValue)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
-    pData->anaLimit_hz = SAF_CLAMP(newValue, HCROPAC_ANA_LIMIT_MIN_VALUE, HCROPAC_ANA_LIMIT_MAX_VALUE);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_SILENCE_GATE_THRESHOLD, -1, newValue);
+    pData->gateThreshold_dB = SAF_CLAMP(newValue, HCROPAC_GATE_THRESHOLD_MIN_VALUE, HCROPAC_GATE_THRESHOLD_MAX_VALUE);
 }
 
-void hcropaclib_setUseDefaultHRIRsflag(void* const hCroPaC, int newState)
+void hcropaclib_setSilenceGateHangover(void* const hCroPaC, float newValue)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
-    
-    if((!pData->useDefaultHRIRsFLAG) && (newState)){
-        pData->useDefaultHRIRsFLAG = newState;
-        hcropaclib_setCodecStatus(hCroPaC, CODEC_STATUS_NOT_INITIALISED);
-    }
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_SILENCE_GATE_HANGOVER, -1, newValue);
+    pData->gateHangover_ms = SAF_CLAMP(newValue, HCROPAC_GATE_HANGOVER_MIN_VALUE, HCROPAC_GATE_HANGOVER_MAX_VALUE);
 }
 
-void hcropaclib_setSofaFilePath(void* const hCroPaC, const char* path)
+void hcropaclib_setEnableBandSkipping(void* const hCroPaC, int newState)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
-    codecPars* pars = pData->pars;
-    
-    pars->sofa_filepath = malloc1d(strlen(path) + 1);
-    strcpy(pars->sofa_filepath, path);
-    pData->useDefaultHRIRsFLAG = 0;
-    hcropaclib_setCodecStatus(hCroPaC, CODEC_STATUS_NOT_INITIALISED);
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_ENABLE_BAND_SKIPPING, -1, (float)newState);
+    pData->enableBandSkipping = newState;
 }
 
-void hcropaclib_setChOrder(void* const hCroPaC, int newOrder)
+void hcropaclib_setEnableAnalysisOnly(void* const hCroPaC, int newState)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
-    pData->chOrdering = (HCROPAC_CH_ORDER)newOrder;
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_ENABLE_ANALYSIS_ONLY, -1, (float)newState);
+    pData->enableAnalysisOnly = newState;
 }
 
-void hcropaclib_setNormType(void* const hCroPaC, int newType)
+void hcropaclib_setBandSkipFloor(void* const hCroPaC, float newValue)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
-    pData->norm = (HCROPAC_NORM_TYPES)newType;
+    hcropaclib_recordParam(hCroPaC, HCROPAC_REC_BAND_SKIP_FLOOR, -1, newValue);
+    pData->bandSkipFloor_dB = SAF_CLAMP(newValue, HCROPAC_BAND_FLOOR_MIN_VALUE, HCROPAC_BAND_FLOOR_MAX_VALUE);
 }
 
-void hcropaclib_setEnableDiffCorrection(void* const hCroPaC, int newState)
+void hcropaclib_resetProcessingCounters(void* const hCroPaC)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
-    if(pData->diffCorrection != newState){
-        pData->diffCorrection = newState;
-        hcropaclib_setCodecStatus(hCroPaC, CODEC_STATUS_NOT_INITIALISED);
-    }
+    pData->nGatedFrames = 0;
+    pData->nProcessedFrames = 0;
+    pData->nAnalysedBands = 0;
+    pData->nSkippedBands = 0;
+    pData->nAnalysedSlots = 0;
+    pData->nDiffuseSlots = 0;
+    pData->nDiffuseBands = 0;
 }
 
-void hcropaclib_setHRIRsPreProc(void* const hCroPaC, HRIR_PREPROC_OPTIONS newState)
+void hcropaclib_setEnableProfiling(void* const hCroPaC, int newState)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
-    if(pData->hrirProcMode != newState){
-        pData->hrirProcMode = newState;
-        hcropaclib_setCodecStatus(hCroPaC, CODEC_STATUS_NOT_INITIALISED);
-    }
+    pData->enableProfiling = newState ? 1 : 0;
 }
 
-void hcropaclib_setEnableRotation(void* const hCroPaC, int newState)
+void hcropaclib_resetProfile(void* const hCroPaC)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
-    pData->enableRotation = newState;
-    pData->recalc_M_rotFLAG = 1;
+    int stage;
+    pData->profile_nFrames = 0;
+    pData->profile_frameMean_us = 0.0f;
+    pData->profile_frameMax_us = 0.0f;
+    pData->profile_cpuLoad = 0.0f;
+    for(stage=0; stage<HCROPAC_PROFILE_NUM_STAGES; stage++)
+        pData->profile_stageMean_us[stage] = 0.0f;
+    pData->resetProfileFLAG = 1; /* the accumulators are reset by the processing thread */
 }
 
-void hcropaclib_setYaw(void  * const hCroPaC, float newYaw)
+void hcropaclib_setEnableLatencyStats(void* const hCroPaC, int newState)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
-    pData->yaw = pData->bFlipYaw == 1 ? -DEG2RAD(newYaw) : DEG2RAD(newYaw);
-    pData->recalc_M_rotFLAG = 1;
+    pData->enableLatencyStats = newState ? 1 : 0;
 }
 
-void hcropaclib_setPitch(void* const hCroPaC, float newPitch)
+void hcropaclib_setDeadlineFraction(void* const hCroPaC, float newValue)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
-    pData->pitch = pData->bFlipPitch == 1 ? -DEG2RAD(newPitch) : DEG2RAD(newPitch);
-    pData->recalc_M_rotFLAG = 1;
+    pData->deadlineFraction = SAF_CLAMP(newValue, HCROPAC_DEADLINE_FRACTION_MIN_VALUE, HCROPAC_DEADLINE_FRACTION_MAX_VALUE);
 }
 
-void hcropaclib_setRoll(void* const hCroPaC, float newRoll)
+void hcropaclib_resetLatencyStats(void* const hCroPaC)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
-    pData->roll = pData->bFlipRoll == 1 ? -DEG2RAD(newRoll) : DEG2RAD(newRoll);
-    pData->recalc_M_rotFLAG = 1;
+    pData->resetLatencyFLAG = 1; /* the histogram is only ever written by the processing thread */
 }
 
-void hcropaclib_setFlipYaw(void* const hCroPaC, int newState)
+void hcropaclib_setEnableTracing(void* const hCroPaC, int newState)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
-    if(newState !=pData->bFlipYaw ){
-        pData->bFlipYaw = newState;
-        hcropaclib_setYaw(hCroPaC, -hcropaclib_getYaw(hCroPaC));
+    if(newState && pData->traceEvents == NULL){
+        pData->traceWriteIdx = 0;
+        pData->traceEvents = (traceEvent*)calloc1d(TRACE_NUM_EVENTS, sizeof(traceEvent));
     }
+    pData->enableTracing = newState ? 1 : 0;
 }
 
-void hcropaclib_setFlipPitch(void* const hCroPaC, int newState)
+void hcropaclib_clearTrace(void* const hCroPaC)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
-    if(newState !=pData->bFlipPitch ){
-        pData->bFlipPitch = newState;
-        hcropaclib_setPitch(hCroPaC, -hcropaclib_getPitch(hCroPaC));
-    }
+    pData->traceWriteIdx = 0;
 }
 
-void hcropaclib_setFlipRoll(void* const hCroPaC, int newState)
+void hcropaclib_setEnableRecording(void* const hCroPaC, int newState)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
-    if(newState !=pData->bFlipRoll ){
-        pData->bFlipRoll = newState;
-        hcropaclib_setRoll(hCroPaC, -hcropaclib_getRoll(hCroPaC));
-    }
+    if(!newState)
+        pData->recorderState = HCROPAC_RECORDER_OFF;
+    else if(pData->recorderState != HCROPAC_RECORDER_RECORDING)
+        pData->recorderState = HCROPAC_RECORDER_ARMED; /* the buffer is allocated by hcropaclib_init() */
 }
 
-void hcropaclib_setRPYflag(void* const hCroPaC, int newState)
+void hcropaclib_setRecordingLength(void* const hCroPaC, float newValue)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
-    pData->useRollPitchYawFlag = newState;
+    pData->recordingLength_s = SAF_CLAMP(newValue, HCROPAC_RECORDING_LENGTH_MIN_VALUE, HCROPAC_RECORDING_LENGTH_MAX_VALUE);
 }
 
 
 /* Get Functions */
 
-int hcropaclib_getFrameSize(void)
+int hcropaclib_getFrameSize(void* const hCroPaC)
 {
-    return FRAME_SIZE;
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->frameSize;
 }
 
 HCROPAC_CODEC_STATUS hcropaclib_getCodecStatus(void* const hCroPaC)
@@ -896,6 +1509,13 @@ HCROPAC_CODEC_STATUS hcropaclib_getCodecStatus(void* const hCroPaC)
     return pData->codecStatus;
 }
 
+int hcropaclib_getFIRDecoderRebuildPending(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->codecStatus == CODEC_STATUS_INITIALISED && pData->linearDecoderMode == LINEAR_DECODER_FIR &&
+           pData->reinitFIRFLAG && !pData->firSwapFLAG && !pData->firRebuildingFLAG ? 1 : 0;
+}
+
 float hcropaclib_getProgressBar0_1(void* const hCroPaC)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
@@ -914,6 +1534,18 @@ int hcropaclib_getEnableCroPaC(void* const hCroPaC)
     return pData->enableCroPaC;
 }
 
+int hcropaclib_getTransformBackend(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->new_tftBackend;
+}
+
+int hcropaclib_getLinearDecoderMode(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return (int)pData->linearDecoderMode;
+}
+
 float hcropaclib_getBalance(void  * const hCroPaC, int bandIdx)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
@@ -937,9 +1569,35 @@ void hcropaclib_getBalanceHandle
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
     (*pX_vector) = &pData->freqVector[0];
     (*pY_values) = (float*)&pData->balance[0];
-    (*pNpoints) = HYBRID_BANDS;
+    (*pNpoints) = pData->nBands;
 } 
 
+float hcropaclib_getEQ(void* const hCroPaC, int bandIdx)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->EQ[bandIdx];
+}
+
+float hcropaclib_getEQAllBands(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->EQ[0];
+}
+
+void hcropaclib_getEQHandle
+(
+    void* const hCroPaC,
+    float** pX_vector,
+    float** pY_values,
+    int* pNpoints
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    (*pX_vector) = &pData->freqVector[0];
+    (*pY_values) = (float*)&pData->EQ[0];
+    (*pNpoints) = pData->nBands;
+}
+
 float hcropaclib_getCovAvg(void* const hCroPaC)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
@@ -952,6 +1610,33 @@ float hcropaclib_getAnaLimit(void* const hCroPaC)
     return pData->anaLimit_hz;
 }
 
+int hcropaclib_getScanningGridDensity(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->gridIcoFreq;
+}
+
+int hcropaclib_getNumScanningGridDirs(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    codecPars* pars = pData->pars;
+    if(pData->codecStatus != CODEC_STATUS_INITIALISED)
+        return 0;
+    return pars->grid_nDirs;
+}
+
+float hcropaclib_getScanningGridMaxError(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->gridMaxError_deg;
+}
+
+float hcropaclib_getScanningGridMeanError(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->gridMeanError_deg;
+}
+
 int hcropaclib_getUseDefaultHRIRsflag(void* const hCroPaC)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
@@ -962,7 +1647,11 @@ char* hcropaclib_getSofaFilePath(void* const hCroPaC)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
     codecPars* pars = pData->pars;
-    if(pars->sofa_filepath!=NULL)
+    char* newPath;
+    newPath = pars->new_sofa_filepath;
+    if(newPath!=NULL)
+        return newPath; /* not yet loaded */
+    else if(pars->sofa_filepath!=NULL)
         return pars->sofa_filepath;
     else
         return "/Spatial_Audio_Framework/Default";
@@ -997,9 +1686,16 @@ int hcropaclib_getNumEars()
     return NUM_EARS;
 }
 
-int hcropaclib_getNumberOfBands()
+int hcropaclib_getNumberOfBands(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->nBands;
+}
+
+int hcropaclib_getNumberOfTimeSlots(void* const hCroPaC)
 {
-    return HYBRID_BANDS;
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->nSlots;
 }
 
 int hcropaclib_getNSHrequired()
@@ -1055,6 +1751,308 @@ int hcropaclib_getRPYflag(void* const hCroPaC)
     return pData->useRollPitchYawFlag;
 }
 
+int hcropaclib_getEnableSilenceGate(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->enableGate;
+}
+
+float hcropaclib_getSilenceGateThreshold(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->gateThreshold_dB;
+}
+
+float hcropaclib_getSilenceGateHangover(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->gateHangover_ms;
+}
+
+int hcropaclib_getNumGatedFrames(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->nGatedFrames;
+}
+
+int hcropaclib_getNumProcessedFrames(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->nProcessedFrames;
+}
+
+int hcropaclib_getEnableBandSkipping(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->enableBandSkipping;
+}
+
+int hcropaclib_getEnableAnalysisOnly(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->enableAnalysisOnly;
+}
+
+const hcropaclib_metadata* hcropaclib_getMetadata(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return &(pData->metadata);
+}
+
+float hcropaclib_getBandSkipFloor(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->bandSkipFloor_dB;
+}
+
+float hcropaclib_getBandSkipRatio(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    int nAnalysedBands = pData->nAnalysedBands;
+    return nAnalysedBands > 0 ? (float)pData->nSkippedBands/(float)nAnalysedBands : 0.0f;
+}
+
+float hcropaclib_getDiffuseSlotRatio(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    int nAnalysedSlots = pData->nAnalysedSlots;
+    return nAnalysedSlots > 0 ? (float)pData->nDiffuseSlots/(float)nAnalysedSlots : 0.0f;
+}
+
+float hcropaclib_getDiffuseBandRatio(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    int nBands = pData->nAnalysedBands - pData->nSkippedBands;
+    return nBands > 0 ? (float)pData->nDiffuseBands/(float)nBands : 0.0f;
+}
+
+int hcropaclib_getEnableProfiling(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->enableProfiling;
+}
+
+void hcropaclib_getProfile
+(
+    void* const hCroPaC,
+    hcropaclib_profile* profile
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    int stage;
+
+    profile->nFrames = pData->profile_nFrames;
+    profile->frameMean_us = pData->profile_frameMean_us;
+    profile->frameMax_us = pData->profile_frameMax_us;
+    profile->cpuLoad = pData->profile_cpuLoad;
+    for(stage=0; stage<HCROPAC_PROFILE_NUM_STAGES; stage++)
+        profile->stageMean_us[stage] = pData->profile_stageMean_us[stage];
+}
+
+const char* hcropaclib_getProfileStageName(int stage)
+{
+    switch(stage){
+        case HCROPAC_PROFILE_INPUT:        return "input";
+        case HCROPAC_PROFILE_TFT_FORWARD:  return "tft_forward";
+        case HCROPAC_PROFILE_ROTATION:     return "rotation";
+        case HCROPAC_PROFILE_DECODING:     return "decoding";
+        case HCROPAC_PROFILE_COVARIANCES:  return "covariances";
+        case HCROPAC_PROFILE_ANALYSIS:     return "analysis";
+        case HCROPAC_PROFILE_SYNTHESIS:    return "synthesis";
+        case HCROPAC_PROFILE_MIXING:       return "mixing";
+        case HCROPAC_PROFILE_TFT_BACKWARD: return "tft_backward";
+        case HCROPAC_PROFILE_OUTPUT:       return "output";
+        default:                           return "unknown";
+    }
+}
+
+int hcropaclib_getEnableLatencyStats(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->enableLatencyStats;
+}
+
+float hcropaclib_getDeadlineFraction(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->deadlineFraction;
+}
+
+void hcropaclib_getLatencyStats
+(
+    void* const hCroPaC,
+    hcropaclib_latency* stats
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+
+    stats->nFrames = pData->latency_nFrames;
+    stats->nDeadlineMisses = pData->latency_nMisses;
+    stats->deadline_us = pData->fs > 0 ? pData->deadlineFraction*1e6f*(float)pData->frameSize/(float)pData->fs : 0.0f;
+    stats->p50_us = hcropaclib_getLatencyPercentile(hCroPaC, 50.0f);
+    stats->p99_us = hcropaclib_getLatencyPercentile(hCroPaC, 99.0f);
+    stats->p999_us = hcropaclib_getLatencyPercentile(hCroPaC, 99.9f);
+    stats->max_us = pData->latency_max_us;
+}
+
+int hcropaclib_getEnableTracing(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->enableTracing;
+}
+
+int hcropaclib_writeTrace
+(
+    void* const hCroPaC,
+    const char* path
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    static const char* trackNames[] = { "", "process", "initCodec", "codec status" };
+    traceEvent event;
+    FILE* file;
+    int i, track, nRecorded, nEvents, first;
+    
+    file = fopen(path, "w");
+    if(file == NULL)
+        return -1;
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    for(track=TRACE_TRACK_PROCESS; track<=TRACE_TRACK_STATUS; track++)
+        fprintf(file, "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}},\n", track, trackNames[track]);
+    fprintf(file, "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"hcropaclib\"}}");
+
+    /* oldest to newest */
+    nEvents = 0;
+    if(pData->traceEvents != NULL){
+        nRecorded = pData->traceWriteIdx;
+        first = SAF_MAX(0, nRecorded - TRACE_NUM_EVENTS);
+        for(i=first; i<nRecorded; i++){
+            event = pData->traceEvents[(unsigned int)i % TRACE_NUM_EVENTS];
+            if(event.name == NULL || event.track < TRACE_TRACK_PROCESS || event.track > TRACE_TRACK_STATUS)
+                continue;
+            if(event.dur_us < 0.0f)
+                fprintf(file, ",\n  {\"name\": \"%s\", \"cat\": \"hcropaclib\", \"ph\": \"i\", \"s\": \"p\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d}",
+                        event.name, event.ts_us, event.track);
+            else
+                fprintf(file, ",\n  {\"name\": \"%s\", \"cat\": \"hcropaclib\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %d}",
+                        event.name, event.ts_us, event.dur_us, event.track);
+            nEvents++;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    if(fclose(file) != 0)
+        return -1;
+    return nEvents;
+}
+
+HCROPAC_RECORDER_STATES hcropaclib_getRecorderState(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return (HCROPAC_RECORDER_STATES)pData->recorderState;
+}
+
+float hcropaclib_getRecordingLength(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    return pData->recordingLength_s;
+}
+
+int hcropaclib_writeRecording
+(
+    void* const hCroPaC,
+    const char* path
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    recEvent event;
+    recFrame frame;
+    FILE* file;
+    int i, ok, len, nPaths, nEvents, nFrames, header[6];
+    
+    file = fopen(path, "wb");
+    if(file == NULL)
+        return -1;
+    nPaths = nEvents = nFrames = 0;
+    if(pData->recEvents != NULL){
+        nPaths = SAF_MIN(pData->recNPaths, REC_MAX_PATHS);
+        nEvents = SAF_MIN(pData->recNEvents, REC_NUM_EVENTS);
+        nFrames = pData->recNFrames;
+    }
+    
+    /* header */
+    header[0] = HCROPAC_RECORDING_VERSION;
+    header[1] = pData->recFs;
+    header[2] = nPaths;
+    header[3] = nEvents;
+    header[4] = nFrames;
+    header[5] = pData->recorderState == HCROPAC_RECORDER_FULL ? 1 : 0;
+    ok = fwrite(HCROPAC_RECORDING_MAGIC, 1, 8, file) == 8;
+    ok = ok && fwrite(header, sizeof(int), 6, file) == 6;
+    
+    /* SOFA file paths */
+    for(i=0; i<nPaths && ok; i++){
+        len = pData->recPaths[i] == NULL ? 0 : (int)strlen(pData->recPaths[i]);
+        ok = fwrite(&len, sizeof(int), 1, file) == 1;
+        ok = ok && (len == 0 || fwrite(pData->recPaths[i], 1, len, file) == (size_t)len);
+    }
+    
+    /* parameter events; written field by field, as the structs may be padded */
+    for(i=0; i<nEvents && ok; i++){
+        event = pData->recEvents[i];
+        ok = fwrite(&event.frame, sizeof(int), 1, file) == 1;
+        ok = ok && fwrite(&event.param, sizeof(int), 1, file) == 1;
+        ok = ok && fwrite(&event.index, sizeof(int), 1, file) == 1;
+        ok = ok && fwrite(&event.value, sizeof(float), 1, file) == 1;
+        ok = ok && fwrite(&event.ts_us, sizeof(double), 1, file) == 1;
+    }
+    
+    /* frames */
+    for(i=0; i<nFrames && ok; i++){
+        frame = pData->recFrames[i];
+        ok = fwrite(&frame.ts_us, sizeof(double), 1, file) == 1;
+        ok = ok && fwrite(&frame.nInputs, sizeof(int), 1, file) == 1;
+        ok = ok && fwrite(&frame.nOutputs, sizeof(int), 1, file) == 1;
+        ok = ok && fwrite(&frame.nSamples, sizeof(int), 1, file) == 1;
+        ok = ok && fwrite(&frame.outputHash, sizeof(unsigned long long), 1, file) == 1;
+        ok = ok && fwrite(&(pData->recSamples[frame.sampleOffset]), sizeof(float), frame.nInputs*frame.nSamples, file) == (size_t)(frame.nInputs*frame.nSamples);
+    }
+    if(fclose(file) != 0 || !ok)
+        return -1;
+    return nFrames;
+}
+
+float hcropaclib_getLatencyPercentile
+(
+    void* const hCroPaC,
+    float percentile
+)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    int i, bucket, nFrames, cumulative, hist[LATENCY_NUM_BUCKETS];
+    float target;
+
+    /* snapshot, so that the total is consistent with the counts */
+    nFrames = 0;
+    for(i=0; i<LATENCY_NUM_BUCKETS; i++){
+        hist[i] = pData->latencyHist[i];
+        nFrames += hist[i];
+    }
+    if(nFrames == 0)
+        return 0.0f;
+    target = SAF_CLAMP(percentile, 0.0f, 100.0f)/100.0f * (float)nFrames;
+    cumulative = 0;
+    for(bucket=0; bucket<LATENCY_NUM_BUCKETS-1; bucket++){
+        cumulative += hist[bucket];
+        if((float)cumulative >= target && cumulative > 0)
+            break;
+    }
+
+    /* upper edge of the bucket; the last bucket has none */
+    if(bucket == LATENCY_NUM_BUCKETS-1)
+        return pData->latency_max_us;
+    return SAF_MIN(powf(2.0f, (float)bucket/(float)LATENCY_BUCKETS_PER_OCTAVE), (float)pData->latency_max_us);
+}
+
 int hcropaclib_getNDirs(void* const hCroPaC)
 {
     hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
@@ -1089,7 +2087,19 @@ int hcropaclib_getDAWsamplerate(void* const hCroPaC)
     return pData->fs;
 }
 
-int hcropaclib_getProcessingDelay()
+int hcropaclib_getProcessingDelay(void* const hCroPaC)
+{
+    hcropaclib_data *pData = (hcropaclib_data*)(hCroPaC);
+    if(pData->linearDecoderMode == LINEAR_DECODER_FIR)
+        return pData->firLength/2; /* the modelling delay; independent of enableCroPaC, which may be automated */
+    return hcropaclib_tftGetDelay(pData->tftBackend);
+}
+
+int hcropaclib_getResidualStreamEnabled(void)
 {
-    return 12*HOP_SIZE;
+#ifdef ENABLE_RESIDUAL_STREAM
+    return 1;
+#else
+    return 0;
+#endif
 }
@@ -0,0 +1,405 @@
+/*
+ ==============================================================================
+
+ This file is part of the CroPaC-Binaural
+ Copyright (c) 2018 - Leo McCormack.
+
+ CroPaC-Binaural is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ CroPaC-Binaural is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with CroPaC-Binaural.  If not, see <http://www.gnu.org/licenses/>.
+
+ ==============================================================================
+*/
+
+/**
+ * @file hcropaclib_golden.c
+ * @brief Golden-output equivalence check of hcropaclib_process()
+ *
+ * Each of the synthetic scenes (see bench_common.h) is rendered with every
+ * combination of rotation, input channel order/normalisation, and CroPaC
+ * on/off. With '--generate', the binaural outputs are written to a reference
+ * file; with '--check', they are rendered again and compared against that
+ * reference, both sample-by-sample and per octave band (ear levels, ILDs and
+ * interaural coherence). Returns non-zero if any configuration exceeds the
+ * tolerances. The intended use is to generate a reference with a known-good
+ * build, and then check an optimised build (or processing path) against it:
+ *
+ *   hcropaclib_golden --generate golden.bin
+ *   hcropaclib_golden --check golden.bin [--decoder fir] [--tol-db -40]
+ *
+ * The FIR linear decoder has its own (modelling) delay in place of the
+ * transform delay, so its output is shifted to align with the reference; as
+ * that mode disables CroPaC, only the linear configurations are checked with
+ * '--decoder fir'.
+ *
+ * The residual stream is a build option (HCROPAC_ENABLE_RESIDUAL_STREAM), so a
+ * reference may only be checked by a build of the same variant.
+ *
+ * @note The reference file uses the byte order of the machine that wrote it.
+ *
+ * @author Leo McCormack
+ * @date 12.01.2018
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "saf.h"
+#include "hcropaclib.h"
+#include "bench_common.h"
+#include "tools_common.h"
+
+#define GOLDEN_MAGIC "HCGOLDEN"
+#define GOLDEN_VERSION ( 2 )                       /* 2: the FuMa input has a -3dB omni */
+#define GOLDEN_DEFAULT_FRAMES ( 32 )
+#define GOLDEN_DEFAULT_SAMPLERATE ( 48000 )
+#define GOLDEN_SEED ( 12345 )
+#define GOLDEN_ENERGY_FLOOR ( 1e-12 )              /* bands/signals quieter than this (per sample) are not compared */
+#define GOLDEN_DEFAULT_TOL_DB ( -60.0f )           /* max. error-to-reference energy ratio, dB */
+#define GOLDEN_DEFAULT_TOL_BAND_DB ( 0.1f )        /* max. ear level and ILD errors, dB */
+#define GOLDEN_DEFAULT_TOL_IC ( 0.01f )            /* max. interaural coherence error */
+
+/** Input channel order/normalisation configurations */
+typedef struct _golden_format {
+    HCROPAC_CH_ORDER chOrder;
+    HCROPAC_NORM_TYPES norm;
+    const char* name;
+} golden_format;
+
+static const golden_format golden_formats[] = {
+    { CH_ACN,  NORM_SN3D, "acn_sn3d" },
+    { CH_ACN,  NORM_N3D,  "acn_n3d"  },
+    { CH_FUMA, NORM_FUMA, "fuma"     }
+};
+#define GOLDEN_NUM_FORMATS ( (int)(sizeof(golden_formats)/sizeof(golden_formats[0])) )
+#define GOLDEN_NUM_CONFIGS ( BENCH_NUM_SCENES*2*GOLDEN_NUM_FORMATS*2 )
+
+/** One rendered configuration */
+typedef struct _golden_config {
+    int32_t scene;    /**< see 'BENCH_SCENES' enum */
+    int32_t rotation; /**< 0: off, 1: on (the head moves with every frame) */
+    int32_t format;   /**< index into golden_formats */
+    int32_t cropac;   /**< 0: linear decoding only, 1: CroPaC */
+} golden_config;
+
+/** Reference file header */
+typedef struct _golden_header {
+    char magic[8];
+    int32_t version;
+    int32_t residualStream; /**< 1: the reference was rendered with the residual stream */
+    int32_t fs;
+    int32_t frameSize;
+    int32_t nFrames;
+    int32_t nEars;
+    int32_t nConfigs;
+} golden_header;
+
+typedef struct _golden_options {
+    int generate;
+    const char* path;
+    int nFrames;
+    int fs;
+    int frameSize;
+    int decoderMode;
+    float tol_dB;
+    float tolBand_dB;
+    float tolIC;
+} golden_options;
+
+static void golden_usage(const char* name)
+{
+    printf("Usage: %s (--generate PATH | --check PATH) [options]\n"
+           "  --frames N        frames per configuration, --generate only (default %d)\n"
+           "  --fs N            sampling rate, Hz, --generate only (default %d)\n"
+           "  --framesize N     processing frame size, --generate only (default %d)\n"
+           "  --decoder MODE    linear decoder: stft or fir, --check only (default stft)\n"
+           "  --tol-db X        max. error-to-reference energy ratio, dB (default %.0f)\n"
+           "  --tol-band-db X   max. octave band ear level and ILD errors, dB (default %.2f)\n"
+           "  --tol-ic X        max. octave band interaural coherence error (default %.2f)\n",
+           name, GOLDEN_DEFAULT_FRAMES, GOLDEN_DEFAULT_SAMPLERATE, HCROPAC_FRAME_SIZE_DEFAULT,
+           GOLDEN_DEFAULT_TOL_DB, GOLDEN_DEFAULT_TOL_BAND_DB, GOLDEN_DEFAULT_TOL_IC);
+}
+
+static int golden_parseOptions(int argc, char** argv, golden_options* opts)
+{
+    int i;
+
+    memset(opts, 0, sizeof(golden_options));
+    opts->nFrames = GOLDEN_DEFAULT_FRAMES;
+    opts->fs = GOLDEN_DEFAULT_SAMPLERATE;
+    opts->frameSize = HCROPAC_FRAME_SIZE_DEFAULT;
+    opts->decoderMode = LINEAR_DECODER_STFT;
+    opts->tol_dB = GOLDEN_DEFAULT_TOL_DB;
+    opts->tolBand_dB = GOLDEN_DEFAULT_TOL_BAND_DB;
+    opts->tolIC = GOLDEN_DEFAULT_TOL_IC;
+    for(i=1; i<argc; i++){
+        if(i+1 < argc && (!strcmp(argv[i], "--generate") || !strcmp(argv[i], "--check"))){
+            opts->generate = !strcmp(argv[i], "--generate");
+            opts->path = argv[++i];
+        }
+        else if(i+1 < argc && !strcmp(argv[i], "--frames"))
+            opts->nFrames = atoi(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--fs"))
+            opts->fs = atoi(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--framesize"))
+            opts->frameSize = atoi(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--decoder")){
+            i++;
+            if(!strcmp(argv[i], "stft"))
+                opts->decoderMode = LINEAR_DECODER_STFT;
+            else if(!strcmp(argv[i], "fir"))
+                opts->decoderMode = LINEAR_DECODER_FIR;
+            else
+                return 0;
+        }
+        else if(i+1 < argc && !strcmp(argv[i], "--tol-db"))
+            opts->tol_dB = (float)atof(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--tol-band-db"))
+            opts->tolBand_dB = (float)atof(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--tol-ic"))
+            opts->tolIC = (float)atof(argv[++i]);
+        else
+            return 0;
+    }
+    if(opts->generate && opts->decoderMode == LINEAR_DECODER_FIR)
+        return 0; /* the reference must also hold the CroPaC configurations */
+    return opts->path != NULL && opts->nFrames > 0 && opts->fs > 0;
+}
+
+static void golden_configName(const golden_config* cfg, char* name, int nameSize)
+{
+    snprintf(name, nameSize, "%s/rot%d/%s/cropac%d", bench_sceneName((BENCH_SCENES)cfg->scene),
+             cfg->rotation, golden_formats[cfg->format].name, cfg->cropac);
+}
+
+/* converts the ACN/SN3D scene into the input format of the configuration */
+static void golden_convertInput(float** foa, int format, int nSamples)
+{
+    int ch, n;
+    float tmp;
+
+    switch(golden_formats[format].norm){
+        case NORM_N3D:
+            for(ch=1; ch<BENCH_NUM_FOA_CHANNELS; ch++)
+                for(n=0; n<nSamples; n++)
+                    foa[ch][n] *= sqrtf(3.0f);
+            break;
+        case NORM_SN3D:
+            break;
+        case NORM_FUMA: /* SN3D, but with the omni attenuated by 3dB (see 'HCROPAC_NORM_TYPES' enum) */
+            for(n=0; n<nSamples; n++)
+                foa[0][n] *= 1.0f/sqrtf(2.0f);
+            break;
+    }
+    if(golden_formats[format].chOrder == CH_FUMA){
+        /* WYZX -> WXYZ */
+        for(n=0; n<nSamples; n++){
+            tmp = foa[3][n];
+            foa[3][n] = foa[2][n];
+            foa[2][n] = foa[1][n];
+            foa[1][n] = tmp;
+        }
+    }
+}
+
+/* renders one configuration; out: nEars x (nFrames*frameSize) */
+static int golden_render
+(
+    void* hCroPaC,
+    const golden_config* cfg,
+    int fs,
+    int nFrames,
+    float** foa,
+    float** frameOut,
+    float** out
+)
+{
+    bench_scene scene;
+    int ear, frame, frameSize;
+
+    hcropaclib_setChOrder(hCroPaC, golden_formats[cfg->format].chOrder);
+    hcropaclib_setNormType(hCroPaC, golden_formats[cfg->format].norm);
+    hcropaclib_setEnableCroPaC(hCroPaC, cfg->cropac);
+    hcropaclib_setEnableRotation(hCroPaC, cfg->rotation);
+    hcropaclib_setYaw(hCroPaC, 0.0f);
+    hcropaclib_setPitch(hCroPaC, 0.0f);
+    hcropaclib_setRoll(hCroPaC, 0.0f);
+    hcropaclib_initCodec(hCroPaC); /* e.g. the FIR decoder depends on the input format */
+    if(hcropaclib_getCodecStatus(hCroPaC) != CODEC_STATUS_INITIALISED)
+        return 0;
+    hcropaclib_init(hCroPaC, fs); /* resets the processing state */
+
+    frameSize = hcropaclib_getFrameSize(hCroPaC);
+    bench_scene_init(&scene, (BENCH_SCENES)cfg->scene, fs, GOLDEN_SEED);
+    for(frame=0; frame<nFrames; frame++){
+        bench_scene_render(&scene, foa, frameSize);
+        golden_convertInput(foa, cfg->format, frameSize);
+        if(cfg->rotation){
+            hcropaclib_setYaw(hCroPaC, (float)(frame % 72) * 5.0f - 180.0f);
+            hcropaclib_setPitch(hCroPaC, 30.0f * sinf(0.1f*(float)frame));
+            hcropaclib_setRoll(hCroPaC, 15.0f * cosf(0.1f*(float)frame));
+        }
+        hcropaclib_process(hCroPaC, foa, frameOut, BENCH_NUM_FOA_CHANNELS, TOOLS_NUM_EARS, frameSize);
+        for(ear=0; ear<TOOLS_NUM_EARS; ear++)
+            memcpy(&out[ear][frame*frameSize], frameOut[ear], frameSize*sizeof(float));
+    }
+    return 1;
+}
+
+int main(int argc, char** argv)
+{
+    golden_options opts;
+    golden_header header;
+    golden_config cfg, refCfg;
+    tools_comparison result;
+    FILE* file;
+    void *hCroPaC, *hFFT;
+    float **foa, **frameOut, **out, **ref;
+    char name[64];
+    int ear, scene, rot, format, cropac, c, len, cmpLen, nFailed, failed, alignDelay;
+
+    if(!golden_parseOptions(argc, argv, &opts)){
+        golden_usage(argv[0]);
+        return 2;
+    }
+
+    /* header */
+    file = fopen(opts.path, opts.generate ? "wb" : "rb");
+    if(file == NULL){
+        fprintf(stderr, "Unable to open '%s'\n", opts.path);
+        return 2;
+    }
+    if(opts.generate){
+        memset(&header, 0, sizeof(golden_header));
+        memcpy(header.magic, GOLDEN_MAGIC, sizeof(header.magic));
+        header.version = GOLDEN_VERSION;
+        header.residualStream = hcropaclib_getResidualStreamEnabled();
+        header.fs = opts.fs;
+        header.frameSize = opts.frameSize;
+        header.nFrames = opts.nFrames;
+        header.nEars = TOOLS_NUM_EARS;
+        header.nConfigs = GOLDEN_NUM_CONFIGS;
+        fwrite(&header, sizeof(golden_header), 1, file);
+    }
+    else{
+        if(fread(&header, sizeof(golden_header), 1, file) != 1 || memcmp(header.magic, GOLDEN_MAGIC, sizeof(header.magic)) ||
+           header.version != GOLDEN_VERSION || header.nEars != TOOLS_NUM_EARS || header.nFrames < 1 || header.fs < 1){
+            fprintf(stderr, "'%s' is not a (compatible) reference file\n", opts.path);
+            fclose(file);
+            return 2;
+        }
+        if(header.residualStream != hcropaclib_getResidualStreamEnabled()){
+            fprintf(stderr, "'%s' was rendered %s the residual stream; rebuild with HCROPAC_ENABLE_RESIDUAL_STREAM=%s\n",
+                    opts.path, header.residualStream ? "with" : "without", header.residualStream ? "ON" : "OFF");
+            fclose(file);
+            return 2;
+        }
+    }
+
+    /* set-up */
+    hcropaclib_create(&hCroPaC);
+    hcropaclib_setFrameSize(hCroPaC, header.frameSize);
+    alignDelay = hcropaclib_getProcessingDelay(hCroPaC); /* that of the reference */
+    hcropaclib_setLinearDecoderMode(hCroPaC, opts.decoderMode);
+    hcropaclib_init(hCroPaC, header.fs);
+    hcropaclib_initCodec(hCroPaC);
+    alignDelay -= hcropaclib_getProcessingDelay(hCroPaC); /* that of the FIR decoder depends on the HRIR length */
+    if(hcropaclib_getCodecStatus(hCroPaC) != CODEC_STATUS_INITIALISED || hcropaclib_getFrameSize(hCroPaC) != header.frameSize){
+        fprintf(stderr, "Unable to initialise the codec with a frame size of %d\n", header.frameSize);
+        hcropaclib_destroy(&hCroPaC);
+        fclose(file);
+        return 2;
+    }
+    len = header.nFrames*header.frameSize;
+    foa = (float**)malloc2d(BENCH_NUM_FOA_CHANNELS, header.frameSize, sizeof(float));
+    frameOut = (float**)malloc2d(TOOLS_NUM_EARS, header.frameSize, sizeof(float));
+    out = (float**)malloc2d(TOOLS_NUM_EARS, len, sizeof(float));
+    ref = (float**)malloc2d(TOOLS_NUM_EARS, len, sizeof(float));
+    saf_rfft_create(&hFFT, TOOLS_FFT_SIZE);
+
+    /* render (and compare) every configuration */
+    if(!opts.generate)
+        printf("%-32s %10s %10s %10s %10s %10s\n", "configuration", "err_dB", "maxAbsErr", "level_dB", "ild_dB", "ic");
+    nFailed = c = 0;
+    for(scene=0; scene<BENCH_NUM_SCENES; scene++){
+        for(rot=0; rot<2; rot++){
+            for(format=0; format<GOLDEN_NUM_FORMATS; format++){
+                for(cropac=0; cropac<2; cropac++, c++){
+                    cfg.scene = scene;
+                    cfg.rotation = rot;
+                    cfg.format = format;
+                    cfg.cropac = cropac;
+                    golden_configName(&cfg, name, (int)sizeof(name));
+                    if(!opts.generate){
+                        if(c >= header.nConfigs || fread(&refCfg, sizeof(golden_config), 1, file) != 1 ||
+                           memcmp(&refCfg, &cfg, sizeof(golden_config))){
+                            printf("%-32s missing from the reference\n", name);
+                            nFailed++;
+                            continue;
+                        }
+                        for(ear=0; ear<TOOLS_NUM_EARS; ear++)
+                            if(fread(ref[ear], sizeof(float), len, file) != (size_t)len)
+                                memset(ref[ear], 0, len*sizeof(float));
+                    }
+                    if(cropac && opts.decoderMode == LINEAR_DECODER_FIR){
+                        printf("%-32s skipped (CroPaC is disabled with the FIR decoder)\n", name);
+                        continue;
+                    }
+                    if(!golden_render(hCroPaC, &cfg, header.fs, header.nFrames, foa, frameOut, out)){
+                        fprintf(stderr, "Unable to initialise the codec for %s\n", name);
+                        nFailed++;
+                        continue;
+                    }
+                    for(ear=0; ear<TOOLS_NUM_EARS && alignDelay > 0 && alignDelay < len; ear++){
+                        memmove(&out[ear][alignDelay], out[ear], (len - alignDelay)*sizeof(float));
+                        memset(out[ear], 0, alignDelay*sizeof(float));
+                    }
+                    for(ear=0; ear<TOOLS_NUM_EARS && alignDelay < 0 && -alignDelay < len; ear++)
+                        memmove(out[ear], &out[ear][-alignDelay], (len + alignDelay)*sizeof(float));
+                    cmpLen = alignDelay < 0 && -alignDelay < len ? len + alignDelay : len; /* the end of the reference has no counterpart */
+                    if(opts.generate){
+                        fwrite(&cfg, sizeof(golden_config), 1, file);
+                        for(ear=0; ear<TOOLS_NUM_EARS; ear++)
+                            fwrite(out[ear], sizeof(float), len, file);
+                        continue;
+                    }
+                    tools_compare(hFFT, ref, out, cmpLen, header.fs, GOLDEN_ENERGY_FLOOR, &result);
+                    failed = result.err_dB > (double)opts.tol_dB || result.levelErr_dB > (double)opts.tolBand_dB ||
+                             result.ildErr_dB > (double)opts.tolBand_dB || result.icErr > (double)opts.tolIC;
+                    nFailed += failed;
+                    printf("%-32s %10.1f %10.2e %10.3f %10.3f %10.4f %s\n", name, result.err_dB, result.maxAbsErr,
+                           result.levelErr_dB, result.ildErr_dB, result.icErr, failed ? "FAILED" : "ok");
+                }
+            }
+        }
+    }
+
+    /* clean-up */
+    saf_rfft_destroy(&hFFT);
+    hcropaclib_destroy(&hCroPaC);
+    free(foa);
+    free(frameOut);
+    free(out);
+    free(ref);
+    fclose(file);
+
+    if(opts.generate){
+        printf("Wrote %d configurations (%d frames of %d samples at %d Hz, residual stream %s) to '%s'\n", c, header.nFrames,
+               header.frameSize, header.fs, header.residualStream ? "on" : "off", opts.path);
+        return nFailed > 0 ? 1 : 0;
+    }
+    printf("%s: %d of %d configurations outside the tolerances (%.1f dB, %.2f dB, %.3f)\n", nFailed > 0 ? "FAILED" : "PASSED",
+           nFailed, c, opts.tol_dB, opts.tolBand_dB, opts.tolIC);
+    return nFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,390 @@
+/*
+ ==============================================================================
+
+ This file is part of the CroPaC-Binaural
+ Copyright (c) 2018 - Leo McCormack.
+
+ CroPaC-Binaural is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ CroPaC-Binaural is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with CroPaC-Binaural.  If not, see <http://www.gnu.org/licenses/>.
+
+ ==============================================================================
+*/
+
+/**
+ * @file hcropaclib_metacheck.c
+ * @brief Round-trip check of hcropaclib_encodeMetadata() and
+ *        hcropaclib_setRenderMetadata()
+ *
+ * Two instances with identical settings (CroPaC on, rotation off) process the
+ * synthetic scenes (see bench_common.h). The first renders them directly, and
+ * encodes the metadata of every frame; the second is passed that metadata, and
+ * then renders the same frame. The check covers:
+ *  - the metadata frames: every tile must decode to the analysed direction and
+ *    CroPaC gain to within half a quantisation step, and band-skipped tiles
+ *    must coincide with the bands that skipped the analysis;
+ *  - the rendered outputs: these must match the direct rendering, both
+ *    sample-by-sample and per octave band, to within tolerances that allow for
+ *    the quantisation (the renderer also steers towards the decoded directions,
+ *    rather than towards the scanning grid);
+ *  - the header validation: truncated, corrupted and mismatched frames must be
+ *    rejected;
+ *  - band-skipped tiles: frames in which the encoder skipped every other band
+ *    must be accepted, and rendered without errors.
+ *
+ * Each scene is checked with and without band skipping on the encoder. Returns
+ * non-zero if any check fails:
+ *
+ *   hcropaclib_metacheck [--frames 64] [--tol-db -25]
+ *
+ * @author Leo McCormack
+ * @date 12.01.2018
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "saf.h"
+#include "hcropaclib.h"
+#include "bench_common.h"
+#include "tools_common.h"
+
+#define METACHECK_DEFAULT_FRAMES ( 32 )
+#define METACHECK_DEFAULT_SAMPLERATE ( 48000 )
+#define METACHECK_SEED ( 12345 )
+#define METACHECK_ENERGY_FLOOR ( 1e-12 )                           /* bands/signals quieter than this (per sample) are not compared */
+#define METACHECK_AZI_TOL_DEG ( 180.0f/256.0f + 1e-3f )            /* half an azimuth step */
+#define METACHECK_ELEV_TOL_DEG ( 90.0f/254.0f + 1e-3f )            /* half an elevation step */
+#define METACHECK_GAIN_TOL ( 0.5f/255.0f + 1e-5f )                 /* half a gain step */
+#define METACHECK_DEFAULT_TOL_DB ( -25.0f )                        /* max. error-to-direct energy ratio, dB */
+#define METACHECK_DEFAULT_TOL_BAND_DB ( 0.5f )                     /* max. ear level and ILD errors, dB */
+#define METACHECK_DEFAULT_TOL_IC ( 0.05f )                         /* max. interaural coherence error */
+
+typedef struct _metacheck_options {
+    int nFrames;
+    int fs;
+    int frameSize;
+    float tol_dB;
+    float tolBand_dB;
+    float tolIC;
+} metacheck_options;
+
+/** Decoding errors of the metadata frames of one configuration */
+typedef struct _metacheck_tileStats {
+    int nTiles;         /**< number of tiles checked */
+    int nSkipped;       /**< number of band-skipped tiles */
+    int nMismatched;    /**< tiles skipped in one, but not the other, and frames with a mismatched header */
+    int nRejected;      /**< frames rejected by the renderer */
+    float aziErr_deg;   /**< largest azimuth error, degrees */
+    float elevErr_deg;  /**< largest elevation error, degrees */
+    float gainErr;      /**< largest CroPaC gain error */
+} metacheck_tileStats;
+
+static void metacheck_usage(const char* name)
+{
+    printf("Usage: %s [options]\n"
+           "  --frames N        frames per configuration (default %d)\n"
+           "  --fs N            sampling rate, Hz (default %d)\n"
+           "  --framesize N     processing frame size (default %d)\n"
+           "  --tol-db X        max. error-to-direct energy ratio, dB (default %.0f)\n"
+           "  --tol-band-db X   max. octave band ear level and ILD errors, dB (default %.2f)\n"
+           "  --tol-ic X        max. octave band interaural coherence error (default %.2f)\n",
+           name, METACHECK_DEFAULT_FRAMES, METACHECK_DEFAULT_SAMPLERATE, HCROPAC_FRAME_SIZE_DEFAULT,
+           METACHECK_DEFAULT_TOL_DB, METACHECK_DEFAULT_TOL_BAND_DB, METACHECK_DEFAULT_TOL_IC);
+}
+
+static int metacheck_parseOptions(int argc, char** argv, metacheck_options* opts)
+{
+    int i;
+
+    memset(opts, 0, sizeof(metacheck_options));
+    opts->nFrames = METACHECK_DEFAULT_FRAMES;
+    opts->fs = METACHECK_DEFAULT_SAMPLERATE;
+    opts->frameSize = HCROPAC_FRAME_SIZE_DEFAULT;
+    opts->tol_dB = METACHECK_DEFAULT_TOL_DB;
+    opts->tolBand_dB = METACHECK_DEFAULT_TOL_BAND_DB;
+    opts->tolIC = METACHECK_DEFAULT_TOL_IC;
+    for(i=1; i<argc; i++){
+        if(i+1 < argc && !strcmp(argv[i], "--frames"))
+            opts->nFrames = atoi(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--fs"))
+            opts->fs = atoi(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--framesize"))
+            opts->frameSize = atoi(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--tol-db"))
+            opts->tol_dB = (float)atof(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--tol-band-db"))
+            opts->tolBand_dB = (float)atof(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--tol-ic"))
+            opts->tolIC = (float)atof(argv[++i]);
+        else
+            return 0;
+    }
+    return opts->nFrames > 0 && opts->fs > 0;
+}
+
+/* configures an instance, and (re)initialises it; returns 0 if the codec could not be initialised */
+static int metacheck_setup
+(
+    void* hCroPaC,
+    int fs,
+    int frameSize,
+    int enableBandSkipping
+)
+{
+    hcropaclib_setFrameSize(hCroPaC, frameSize);
+    hcropaclib_setEnableCroPaC(hCroPaC, 1);
+    hcropaclib_setEnableRotation(hCroPaC, 0); /* applied to the transmitted directions (see hcropaclib_setRenderMetadata()) */
+    hcropaclib_setEnableBandSkipping(hCroPaC, enableBandSkipping);
+    hcropaclib_setBandSkipFloor(hCroPaC, HCROPAC_BAND_FLOOR_MAX_VALUE);
+    hcropaclib_init(hCroPaC, fs);
+    hcropaclib_initCodec(hCroPaC);
+    hcropaclib_init(hCroPaC, fs); /* resets the processing state */
+    return hcropaclib_getCodecStatus(hCroPaC) == CODEC_STATUS_INITIALISED && hcropaclib_getFrameSize(hCroPaC) == frameSize;
+}
+
+/* decodes a metadata frame, and compares it against the analysis it was encoded from */
+static void metacheck_checkTiles
+(
+    const hcropaclib_metadata* md,
+    const unsigned char* buffer,
+    int nBytes,
+    metacheck_tileStats* stats
+)
+{
+    int band, t, skipped;
+    float azi, elev, gain, err;
+    const unsigned char* tile;
+
+    if(nBytes != HCROPAC_METADATA_HEADER_BYTES + HCROPAC_METADATA_BYTES_PER_TILE*(md->nAnalysedBands)*(md->nTimeSlots) ||
+       memcmp(buffer, "HCPM", 4) || buffer[4] != HCROPAC_METADATA_VERSION || (int)buffer[5] != md->nTimeSlots ||
+       (int)buffer[6] != md->nBands || (int)buffer[7] != md->nAnalysedBands){
+        stats->nMismatched++;
+        return;
+    }
+    tile = &buffer[HCROPAC_METADATA_HEADER_BYTES];
+    for(band=0; band<md->nAnalysedBands; band++){
+        for(t=0; t<md->nTimeSlots; t++, tile+=HCROPAC_METADATA_BYTES_PER_TILE){
+            stats->nTiles++;
+            skipped = tile[1] == 255;
+            if(skipped != (md->dirIdx[band][t] < 0))
+                stats->nMismatched++;
+            if(skipped || md->dirIdx[band][t] < 0){
+                stats->nSkipped += skipped;
+                continue;
+            }
+            azi = (float)tile[0]*360.0f/256.0f;
+            elev = (float)tile[1]*180.0f/254.0f - 90.0f;
+            gain = (float)tile[2]/255.0f;
+            err = fabsf(fmodf(azi - md->azi[band][t] + 540.0f, 360.0f) - 180.0f); /* wraps around */
+            stats->aziErr_deg = SAF_MAX(stats->aziErr_deg, err);
+            stats->elevErr_deg = SAF_MAX(stats->elevErr_deg, fabsf(elev - md->elev[band][t]));
+            stats->gainErr = SAF_MAX(stats->gainErr, fabsf(gain - SAF_CLAMP(md->gain[band][t], 0.0f, 1.0f)));
+        }
+    }
+}
+
+/* renders a scene directly and via the metadata; directOut, renderOut: nEars x (nFrames*frameSize) */
+static void metacheck_render
+(
+    void* hDirect,
+    void* hRenderer,
+    BENCH_SCENES type,
+    int fs,
+    int nFrames,
+    int skipOddBands,
+    unsigned char* buffer,
+    float** foa,
+    float** frameOut,
+    float** directOut,
+    float** renderOut,
+    metacheck_tileStats* stats
+)
+{
+    bench_scene scene;
+    int ear, frame, frameSize, nBytes, band, t, nTimeSlots;
+    unsigned char* tile;
+
+    memset(stats, 0, sizeof(metacheck_tileStats));
+    frameSize = hcropaclib_getFrameSize(hDirect);
+    bench_scene_init(&scene, type, fs, METACHECK_SEED);
+    for(frame=0; frame<nFrames; frame++){
+        bench_scene_render(&scene, foa, frameSize);
+
+        /* encoder, rendering directly */
+        hcropaclib_process(hDirect, foa, frameOut, BENCH_NUM_FOA_CHANNELS, TOOLS_NUM_EARS, frameSize);
+        for(ear=0; ear<TOOLS_NUM_EARS; ear++)
+            memcpy(&directOut[ear][frame*frameSize], frameOut[ear], frameSize*sizeof(float));
+        nBytes = hcropaclib_encodeMetadata(hDirect, buffer, HCROPAC_METADATA_MAX_BYTES);
+        if(skipOddBands){
+            /* marks every other band as skipped, as the encoder does */
+            nTimeSlots = (int)buffer[5];
+            for(band=1; band<(int)buffer[7]; band+=2){
+                for(t=0; t<nTimeSlots; t++){
+                    tile = &buffer[HCROPAC_METADATA_HEADER_BYTES + HCROPAC_METADATA_BYTES_PER_TILE*(band*nTimeSlots + t)];
+                    tile[0] = 0; tile[1] = 255; tile[2] = 0;
+                }
+            }
+            stats->nSkipped += ((int)buffer[7]/2)*nTimeSlots;
+        }
+        else
+            metacheck_checkTiles(hcropaclib_getMetadata(hDirect), buffer, nBytes, stats);
+
+        /* renderer */
+        if(!hcropaclib_setRenderMetadata(hRenderer, buffer, nBytes))
+            stats->nRejected++;
+        hcropaclib_process(hRenderer, foa, frameOut, BENCH_NUM_FOA_CHANNELS, TOOLS_NUM_EARS, frameSize);
+        for(ear=0; ear<TOOLS_NUM_EARS; ear++)
+            memcpy(&renderOut[ear][frame*frameSize], frameOut[ear], frameSize*sizeof(float));
+    }
+}
+
+/* returns 0 if any sample is not finite */
+static int metacheck_isFinite(float** sig, int len)
+{
+    int ear, n;
+
+    for(ear=0; ear<TOOLS_NUM_EARS; ear++)
+        for(n=0; n<len; n++)
+            if(!isfinite(sig[ear][n]))
+                return 0;
+    return 1;
+}
+
+/* checks that malformed and mismatched metadata frames are rejected; returns the number of failures */
+static int metacheck_headerRejection(void* hRenderer, const unsigned char* valid, int nBytes)
+{
+    static const char* names[] = { "valid", "truncated_header", "bad_magic", "bad_version", "wrong_time_slots",
+                                   "wrong_bands", "too_many_analysed_bands", "truncated_tiles", "extra_byte" };
+    unsigned char buffer[HCROPAC_METADATA_MAX_BYTES+1];
+    int i, n, accepted, failed, nFailed;
+
+    nFailed = 0;
+    for(i=0; i<(int)(sizeof(names)/sizeof(names[0])); i++){
+        memcpy(buffer, valid, nBytes);
+        n = nBytes;
+        switch(i){
+            case 1: n = HCROPAC_METADATA_HEADER_BYTES-1; break;
+            case 2: buffer[3] = 'X'; break;
+            case 3: buffer[4] = HCROPAC_METADATA_VERSION+1; break;
+            case 4: buffer[5]++; break;
+            case 5: buffer[6]++; break;
+            case 6: buffer[7] = (unsigned char)(hcropaclib_getNumberOfBands(hRenderer)+1); break;
+            case 7: n--; break;
+            case 8: buffer[n] = 0; n++; break;
+        }
+        accepted = hcropaclib_setRenderMetadata(hRenderer, buffer, n);
+        failed = accepted != (i == 0);
+        nFailed += failed;
+        printf("%-32s %10s %s\n", names[i], accepted ? "accepted" : "rejected", failed ? "FAILED" : "ok");
+    }
+    return nFailed; /* the last (rejected) frame also discarded the valid one */
+}
+
+int main(int argc, char** argv)
+{
+    metacheck_options opts;
+    metacheck_tileStats stats;
+    tools_comparison result;
+    void *hDirect, *hRenderer, *hFFT;
+    float **foa, **frameOut, **directOut, **renderOut;
+    unsigned char* buffer;
+    char name[64];
+    int scene, skip, len, nBytes, nFailed, failed, c;
+
+    if(!metacheck_parseOptions(argc, argv, &opts)){
+        metacheck_usage(argv[0]);
+        return 2;
+    }
+
+    /* set-up */
+    hcropaclib_create(&hDirect);
+    hcropaclib_create(&hRenderer);
+    if(!metacheck_setup(hDirect, opts.fs, opts.frameSize, 0) || !metacheck_setup(hRenderer, opts.fs, opts.frameSize, 0)){
+        fprintf(stderr, "Unable to initialise the codec with a frame size of %d\n", opts.frameSize);
+        hcropaclib_destroy(&hDirect);
+        hcropaclib_destroy(&hRenderer);
+        return 2;
+    }
+    len = opts.nFrames*opts.frameSize;
+    foa = (float**)malloc2d(BENCH_NUM_FOA_CHANNELS, opts.frameSize, sizeof(float));
+    frameOut = (float**)malloc2d(TOOLS_NUM_EARS, opts.frameSize, sizeof(float));
+    directOut = (float**)malloc2d(TOOLS_NUM_EARS, len, sizeof(float));
+    renderOut = (float**)malloc2d(TOOLS_NUM_EARS, len, sizeof(float));
+    buffer = (unsigned char*)malloc1d(HCROPAC_METADATA_MAX_BYTES);
+    saf_rfft_create(&hFFT, TOOLS_FFT_SIZE);
+    nFailed = c = 0;
+
+    /* header validation, using a frame of the plane wave scene */
+    printf("%-32s %10s\n", "metadata frame", "renderer");
+    metacheck_render(hDirect, hRenderer, BENCH_SCENE_PLANE_WAVE, opts.fs, 1, 0, buffer, foa, frameOut, directOut, renderOut, &stats);
+    nBytes = hcropaclib_encodeMetadata(hDirect, buffer, HCROPAC_METADATA_MAX_BYTES);
+    nFailed += metacheck_headerRejection(hRenderer, buffer, nBytes);
+
+    /* round-trip against direct rendering */
+    printf("\n%-32s %8s %8s %8s %8s %8s %10s %10s %10s %10s\n", "configuration", "tiles", "skipped", "azi_deg",
+           "elev_deg", "gain", "err_dB", "level_dB", "ild_dB", "ic");
+    for(scene=0; scene<BENCH_NUM_SCENES; scene++){
+        for(skip=0; skip<2; skip++, c++){
+            snprintf(name, sizeof(name), "%s/skip%d", bench_sceneName((BENCH_SCENES)scene), skip);
+            if(!metacheck_setup(hDirect, opts.fs, opts.frameSize, skip) || !metacheck_setup(hRenderer, opts.fs, opts.frameSize, 0)){
+                fprintf(stderr, "Unable to initialise the codec for %s\n", name);
+                nFailed++;
+                continue;
+            }
+            metacheck_render(hDirect, hRenderer, (BENCH_SCENES)scene, opts.fs, opts.nFrames, 0, buffer, foa, frameOut, directOut, renderOut, &stats);
+            tools_compare(hFFT, directOut, renderOut, len, opts.fs, METACHECK_ENERGY_FLOOR, &result);
+            failed = stats.nMismatched > 0 || stats.nRejected > 0 || stats.aziErr_deg > METACHECK_AZI_TOL_DEG ||
+                     stats.elevErr_deg > METACHECK_ELEV_TOL_DEG || stats.gainErr > METACHECK_GAIN_TOL || !metacheck_isFinite(renderOut, len) ||
+                     result.err_dB > (double)opts.tol_dB || result.levelErr_dB > (double)opts.tolBand_dB ||
+                     result.ildErr_dB > (double)opts.tolBand_dB || result.icErr > (double)opts.tolIC;
+            nFailed += failed;
+            printf("%-32s %8d %8d %8.3f %8.3f %8.4f %10.1f %10.3f %10.3f %10.4f %s\n", name, stats.nTiles, stats.nSkipped,
+                   stats.aziErr_deg, stats.elevErr_deg, stats.gainErr, result.err_dB, result.levelErr_dB, result.ildErr_dB,
+                   result.icErr, failed ? "FAILED" : "ok");
+            if(stats.nMismatched > 0 || stats.nRejected > 0)
+                printf("%-32s %d mismatched tiles/headers, %d rejected frames\n", "", stats.nMismatched, stats.nRejected);
+        }
+    }
+
+    /* band-skipped tiles; the renderer keeps the previous mixing matrices of those bands, so only the validity is checked */
+    printf("\n%-32s %8s %8s %10s\n", "band-skipped tiles", "skipped", "rejected", "finite");
+    for(scene=0; scene<BENCH_NUM_SCENES; scene++, c++){
+        snprintf(name, sizeof(name), "%s/skip_odd_bands", bench_sceneName((BENCH_SCENES)scene));
+        if(!metacheck_setup(hDirect, opts.fs, opts.frameSize, 0) || !metacheck_setup(hRenderer, opts.fs, opts.frameSize, 0)){
+            fprintf(stderr, "Unable to initialise the codec for %s\n", name);
+            nFailed++;
+            continue;
+        }
+        metacheck_render(hDirect, hRenderer, (BENCH_SCENES)scene, opts.fs, opts.nFrames, 1, buffer, foa, frameOut, directOut, renderOut, &stats);
+        failed = stats.nRejected > 0 || !metacheck_isFinite(renderOut, len);
+        nFailed += failed;
+        printf("%-32s %8d %8d %10s %s\n", name, stats.nSkipped, stats.nRejected, metacheck_isFinite(renderOut, len) ? "yes" : "no",
+               failed ? "FAILED" : "ok");
+    }
+
+    /* clean-up */
+    saf_rfft_destroy(&hFFT);
+    hcropaclib_destroy(&hDirect);
+    hcropaclib_destroy(&hRenderer);
+    free(foa);
+    free(frameOut);
+    free(directOut);
+    free(renderOut);
+    free(buffer);
+
+    printf("%s: %d failures over %d configurations and the header checks (tolerances: %.1f dB, %.2f dB, %.3f; "
+           "half a quantisation step for the tiles)\n", nFailed > 0 ? "FAILED" : "PASSED", nFailed, c, opts.tol_dB,
+           opts.tolBand_dB, opts.tolIC);
+    return nFailed > 0 ? 1 : 0;
+}
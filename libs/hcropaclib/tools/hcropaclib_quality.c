@@ -0,0 +1,534 @@
+/*
+ ==============================================================================
+
+ This file is part of the CroPaC-Binaural
+ Copyright (c) 2018 - Leo McCormack.
+
+ CroPaC-Binaural is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ CroPaC-Binaural is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with CroPaC-Binaural.  If not, see <http://www.gnu.org/licenses/>.
+
+ ==============================================================================
+*/
+
+/**
+ * @file hcropaclib_quality.c
+ * @brief Quality-versus-cost evaluation of the hcropaclib settings and
+ *        approximate processing modes
+ *
+ * The synthetic plane wave, diffuse and moving source scenes (see
+ * bench_common.h) are rendered with a high-quality reference configuration,
+ * and then with each of the evaluated configurations: the analysis limit,
+ * covariance averaging, scanning grid density, HRIR pre-processing, and the
+ * approximate modes (uniform STFT, band skipping, silence gate, and linear
+ * decoding with STFT or FIR filters). By default, these are varied one at a
+ * time from the reference; '--factorial' instead sweeps every combination of
+ * the analysis limit, grid density, transform and band skipping.
+ *
+ * For each configuration, the octave band ILD, ITD/IPD and interaural
+ * coherence errors relative to the reference, the DoA error relative to the
+ * true source directions, and the measured CPU time are reported; along with
+ * whether the configuration lies on the Pareto front (i.e. no other
+ * configuration is both cheaper and at least as accurate in every metric), e.g.:
+ *
+ *   hcropaclib_quality --frames 300 --out quality.json
+ *
+ * @author Leo McCormack
+ * @date 12.01.2018
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "saf.h"
+#include "hcropaclib.h"
+#include "bench_common.h"
+#include "tools_common.h"
+
+#define QUALITY_DEFAULT_FRAMES ( 300 )
+#define QUALITY_DEFAULT_WARMUP_FRAMES ( 50 )
+#define QUALITY_DEFAULT_SAMPLERATE ( 48000 )
+#define QUALITY_SEED ( 12345 )
+#define QUALITY_MAX_CONFIGS ( 128 )
+#define QUALITY_MAX_ITD_FREQ ( 1500.0f )       /* ITDs are only evaluated in the octave bands up to this frequency */
+#define QUALITY_ENERGY_FLOOR ( 1e-12 )         /* per sample */
+
+static const BENCH_SCENES quality_scenes[] = { BENCH_SCENE_PLANE_WAVE, BENCH_SCENE_DIFFUSE, BENCH_SCENE_MOVING };
+#define QUALITY_NUM_SCENES ( (int)(sizeof(quality_scenes)/sizeof(quality_scenes[0])) )
+
+/** One evaluated configuration */
+typedef struct _quality_config {
+    char name[48];
+    float anaLimit_hz;
+    float covAvg;
+    int gridDensity;
+    HRIR_PREPROC_OPTIONS preProc;
+    HCROPAC_TFT_BACKENDS transform;
+    HCROPAC_LINEAR_DECODER_MODES decoder;
+    int cropac;
+    int bandSkipping;
+    int silenceGate;
+} quality_config;
+
+/** Metrics of one configuration; the band errors are averaged over the scenes */
+typedef struct _quality_result {
+    int valid;                                 /**< 0: the codec could not be initialised */
+    double ildErr_dB[TOOLS_NUM_OCTAVES];       /**< absolute ILD error, dB */
+    double ipdErr_rad[TOOLS_NUM_OCTAVES];      /**< absolute (wrapped) IPD error, radians */
+    double icErr[TOOLS_NUM_OCTAVES];           /**< absolute interaural coherence error */
+    double meanIldErr_dB;                      /**< mean over the bands */
+    double meanItdErr_us;                      /**< mean over the bands up to QUALITY_MAX_ITD_FREQ */
+    double meanIcErr;                          /**< mean over the bands */
+    double doaErr_deg;                         /**< energy-weighted mean DoA error */
+    double ns_per_frame;                       /**< mean processing time per frame */
+    double rtf;                                /**< real-time factor (processing time/audio duration) */
+    int pareto;                                /**< 1: on the Pareto front */
+} quality_result;
+
+typedef struct _quality_options {
+    int nFrames;
+    int nWarmupFrames;
+    int fs;
+    int frameSize;
+    int factorial;
+    const char* sofaPath;
+    const char* outPath;
+} quality_options;
+
+static void quality_usage(const char* name)
+{
+    printf("Usage: %s [options]\n"
+           "  --frames N      evaluated frames per scene (default %d)\n"
+           "  --warmup N      frames per scene excluded from the metrics (default %d)\n"
+           "  --fs N          sampling rate, Hz (default %d)\n"
+           "  --framesize N   processing frame size, samples (default %d)\n"
+           "  --factorial     sweep every combination of the analysis limit, grid\n"
+           "                  density, transform and band skipping\n"
+           "  --sofa PATH     use the HRIRs of this SOFA file\n"
+           "  --out PATH      also write the per-band results as JSON to PATH\n",
+           name, QUALITY_DEFAULT_FRAMES, QUALITY_DEFAULT_WARMUP_FRAMES, QUALITY_DEFAULT_SAMPLERATE, HCROPAC_FRAME_SIZE_DEFAULT);
+}
+
+static int quality_parseOptions(int argc, char** argv, quality_options* opts)
+{
+    int i;
+
+    memset(opts, 0, sizeof(quality_options));
+    opts->nFrames = QUALITY_DEFAULT_FRAMES;
+    opts->nWarmupFrames = QUALITY_DEFAULT_WARMUP_FRAMES;
+    opts->fs = QUALITY_DEFAULT_SAMPLERATE;
+    opts->frameSize = HCROPAC_FRAME_SIZE_DEFAULT;
+    for(i=1; i<argc; i++){
+        if(i+1 < argc && !strcmp(argv[i], "--frames"))
+            opts->nFrames = atoi(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--warmup"))
+            opts->nWarmupFrames = atoi(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--fs"))
+            opts->fs = atoi(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--framesize"))
+            opts->frameSize = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--factorial"))
+            opts->factorial = 1;
+        else if(i+1 < argc && !strcmp(argv[i], "--sofa"))
+            opts->sofaPath = argv[++i];
+        else if(i+1 < argc && !strcmp(argv[i], "--out"))
+            opts->outPath = argv[++i];
+        else
+            return 0;
+    }
+    return opts->nFrames > 0 && opts->nWarmupFrames >= 0 && opts->fs > 0;
+}
+
+/* The reference: the densest grid and widest analysis, with the library defaults otherwise */
+static quality_config quality_reference(void)
+{
+    quality_config cfg;
+
+    memset(&cfg, 0, sizeof(quality_config));
+    snprintf(cfg.name, sizeof(cfg.name), "reference");
+    cfg.anaLimit_hz = HCROPAC_ANA_LIMIT_MAX_VALUE;
+    cfg.covAvg = 0.75f;
+    cfg.gridDensity = HCROPAC_GRID_DENSITY_MAX_VALUE;
+    cfg.preProc = HRIR_PREPROC_ALL;
+    cfg.transform = TFT_AFSTFT_HYBRID;
+    cfg.decoder = LINEAR_DECODER_STFT;
+    cfg.cropac = 1;
+    return cfg;
+}
+
+/* Fills in the evaluated configurations (the first is always the reference); returns their number */
+static int quality_buildConfigs(int factorial, quality_config* configs)
+{
+    static const float anaLimits[] = { 4000.0f, 8000.0f, 12000.0f, 16000.0f, 18000.0f };
+    static const float covAvgs[] = { 0.0f, 0.5f, 0.9f };
+    static const int gridDensities[] = { 1, 2, 4, 8, 12 };
+    static const HRIR_PREPROC_OPTIONS preProcs[] = { HRIR_PREPROC_OFF, HRIR_PREPROC_EQ, HRIR_PREPROC_PHASE };
+    static const float factorialAnaLimits[] = { 4000.0f, 8000.0f, 12000.0f, HCROPAC_ANA_LIMIT_MAX_VALUE };
+    static const int factorialGridDensities[] = { 2, 4, 8, HCROPAC_GRID_DENSITY_MAX_VALUE };
+    quality_config ref;
+    int i, j, k, l, n;
+
+    ref = quality_reference();
+    configs[0] = ref;
+    n = 1;
+    if(factorial){
+        for(i=0; i<(int)(sizeof(factorialAnaLimits)/sizeof(float)); i++){
+            for(j=0; j<(int)(sizeof(factorialGridDensities)/sizeof(int)); j++){
+                for(k=0; k<2; k++){
+                    for(l=0; l<2; l++){
+                        if(i == (int)(sizeof(factorialAnaLimits)/sizeof(float))-1 &&
+                           j == (int)(sizeof(factorialGridDensities)/sizeof(int))-1 && k == 0 && l == 0)
+                            continue; /* the reference */
+                        configs[n] = ref;
+                        configs[n].anaLimit_hz = factorialAnaLimits[i];
+                        configs[n].gridDensity = factorialGridDensities[j];
+                        configs[n].transform = k ? TFT_STFT : TFT_AFSTFT_HYBRID;
+                        configs[n].bandSkipping = l;
+                        snprintf(configs[n].name, sizeof(configs[n].name), "ana%.0f/grid%d/%s%s", factorialAnaLimits[i],
+                                 factorialGridDensities[j], k ? "stft" : "hybrid", l ? "/skip" : "");
+                        n++;
+                    }
+                }
+            }
+        }
+        return n;
+    }
+
+    /* one setting at a time */
+    for(i=0; i<(int)(sizeof(anaLimits)/sizeof(float)); i++, n++){
+        configs[n] = ref;
+        configs[n].anaLimit_hz = anaLimits[i];
+        snprintf(configs[n].name, sizeof(configs[n].name), "anaLimit=%.0f", anaLimits[i]);
+    }
+    for(i=0; i<(int)(sizeof(covAvgs)/sizeof(float)); i++, n++){
+        configs[n] = ref;
+        configs[n].covAvg = covAvgs[i];
+        snprintf(configs[n].name, sizeof(configs[n].name), "covAvg=%.2f", covAvgs[i]);
+    }
+    for(i=0; i<(int)(sizeof(gridDensities)/sizeof(int)); i++, n++){
+        configs[n] = ref;
+        configs[n].gridDensity = gridDensities[i];
+        snprintf(configs[n].name, sizeof(configs[n].name), "gridDensity=%d", gridDensities[i]);
+    }
+    for(i=0; i<(int)(sizeof(preProcs)/sizeof(HRIR_PREPROC_OPTIONS)); i++, n++){
+        configs[n] = ref;
+        configs[n].preProc = preProcs[i];
+        snprintf(configs[n].name, sizeof(configs[n].name), "hrirPreProc=%s",
+                 preProcs[i] == HRIR_PREPROC_OFF ? "off" : preProcs[i] == HRIR_PREPROC_EQ ? "eq" : "phase");
+    }
+    configs[n] = ref;
+    configs[n].transform = TFT_STFT;
+    snprintf(configs[n++].name, sizeof(configs[0].name), "transform=stft");
+    configs[n] = ref;
+    configs[n].bandSkipping = 1;
+    snprintf(configs[n++].name, sizeof(configs[0].name), "bandSkipping");
+    configs[n] = ref;
+    configs[n].silenceGate = 1;
+    snprintf(configs[n++].name, sizeof(configs[0].name), "silenceGate");
+    configs[n] = ref;
+    configs[n].cropac = 0;
+    snprintf(configs[n++].name, sizeof(configs[0].name), "linear/stft");
+    configs[n] = ref;
+    configs[n].cropac = 0;
+    configs[n].decoder = LINEAR_DECODER_FIR;
+    snprintf(configs[n++].name, sizeof(configs[0].name), "linear/fir");
+    return n;
+}
+
+static int quality_apply(void* hCroPaC, const quality_config* cfg)
+{
+    hcropaclib_setAnaLimit(hCroPaC, cfg->anaLimit_hz);
+    hcropaclib_setCovAvg(hCroPaC, cfg->covAvg);
+    hcropaclib_setScanningGridDensity(hCroPaC, cfg->gridDensity);
+    hcropaclib_setHRIRsPreProc(hCroPaC, cfg->preProc);
+    hcropaclib_setTransformBackend(hCroPaC, cfg->transform);
+    hcropaclib_setLinearDecoderMode(hCroPaC, cfg->decoder);
+    hcropaclib_setEnableCroPaC(hCroPaC, cfg->cropac);
+    hcropaclib_setEnableBandSkipping(hCroPaC, cfg->bandSkipping);
+    hcropaclib_setEnableSilenceGate(hCroPaC, cfg->silenceGate);
+    hcropaclib_initCodec(hCroPaC); /* also rebuilds the FIR decoder, if only that is out of date */
+    return hcropaclib_getCodecStatus(hCroPaC) == CODEC_STATUS_INITIALISED;
+}
+
+/* angle between two directions, degrees */
+static double quality_angle_deg(float azi1_deg, float elev1_deg, float azi2_deg, float elev2_deg)
+{
+    float dirs_deg[2][2], xyz[2][3];
+    double dot;
+
+    dirs_deg[0][0] = azi1_deg;  dirs_deg[0][1] = elev1_deg;
+    dirs_deg[1][0] = azi2_deg;  dirs_deg[1][1] = elev2_deg;
+    unitSph2cart((float*)dirs_deg, 2, 1, (float*)xyz);
+    dot = (double)(xyz[0][0]*xyz[1][0] + xyz[0][1]*xyz[1][1] + xyz[0][2]*xyz[1][2]);
+    return acos(SAF_CLAMP(dot, -1.0, 1.0)) * 180.0/SAF_PI;
+}
+
+/*
+ * Renders one scene with the current configuration; out: TOOLS_NUM_EARS x (nFrames*frameSize). The DoA estimates
+ * are compared with the true direction at the centre of each frame, less half of the processing delay (i.e.
+ * approximately the latency of the analysis), and accumulated weighted by the energy of the direct component
+ */
+static void quality_render
+(
+    void* hCroPaC,
+    BENCH_SCENES sceneType,
+    const quality_options* opts,
+    float** foa,
+    float** frameOut,
+    float** out,
+    double* doaErrSum,
+    double* doaWeightSum,
+    double* time_ns
+)
+{
+    bench_scene scene;
+    const hcropaclib_metadata* meta;
+    int ear, frame, frameSize, nFrames, band, slot;
+    long long truthIdx;
+    float truthAzi, truthElev;
+    double start, w;
+
+    frameSize = hcropaclib_getFrameSize(hCroPaC);
+    nFrames = opts->nWarmupFrames + opts->nFrames;
+    hcropaclib_init(hCroPaC, opts->fs); /* resets the processing state */
+    bench_scene_init(&scene, sceneType, opts->fs, QUALITY_SEED);
+    for(frame=0; frame<nFrames; frame++){
+        bench_scene_render(&scene, foa, frameSize);
+        start = bench_now_ns();
+        hcropaclib_process(hCroPaC, foa, frameOut, BENCH_NUM_FOA_CHANNELS, TOOLS_NUM_EARS, frameSize);
+        if(frame < opts->nWarmupFrames)
+            continue;
+        *time_ns += bench_now_ns() - start;
+        for(ear=0; ear<TOOLS_NUM_EARS; ear++)
+            memcpy(&out[ear][(frame-opts->nWarmupFrames)*frameSize], frameOut[ear], frameSize*sizeof(float));
+
+        /* DoA error */
+        truthIdx = (long long)frame*frameSize + frameSize/2 - hcropaclib_getProcessingDelay(hCroPaC)/2;
+        if(!bench_scene_direction(&scene, SAF_MAX(truthIdx, 0), &truthAzi, &truthElev))
+            continue;
+        meta = hcropaclib_getMetadata(hCroPaC);
+        for(band=0; band<meta->nAnalysedBands; band++){
+            for(slot=0; slot<meta->nTimeSlots; slot++){
+                w = (double)meta->directEnergy[band][slot];
+                *doaErrSum += w * quality_angle_deg(meta->azi[band][slot], meta->elev[band][slot], truthAzi, truthElev);
+                *doaWeightSum += w;
+            }
+        }
+    }
+}
+
+/* accumulates the octave band errors of one scene */
+static void quality_compare
+(
+    void* hFFT,
+    float** ref,
+    float** test,
+    int len,
+    int fs,
+    quality_result* result
+)
+{
+    tools_bandSpectra S_ref, S_test;
+    double floor_band, ipdErr;
+    int band;
+
+    tools_bandSpectra_compute(hFFT, ref, len, fs, &S_ref);
+    tools_bandSpectra_compute(hFFT, test, len, fs, &S_test);
+    floor_band = QUALITY_ENERGY_FLOOR*(double)len;
+    for(band=0; band<TOOLS_NUM_OCTAVES; band++){
+        result->ildErr_dB[band] += fabs(tools_bandILD_dB(&S_test, band, floor_band) - tools_bandILD_dB(&S_ref, band, floor_band));
+        ipdErr = tools_bandIPD(&S_test, band) - tools_bandIPD(&S_ref, band);
+        result->ipdErr_rad[band] += fabs(atan2(sin(ipdErr), cos(ipdErr)));
+        result->icErr[band] += fabs(tools_bandIC(&S_test, band, floor_band) - tools_bandIC(&S_ref, band, floor_band));
+    }
+}
+
+/* finalises the means, once all scenes have been compared */
+static void quality_summarise(quality_result* result, double doaErrSum, double doaWeightSum)
+{
+    int band, nItdBands;
+    float fc;
+
+    result->meanIldErr_dB = result->meanItdErr_us = result->meanIcErr = 0.0;
+    nItdBands = 0;
+    for(band=0; band<TOOLS_NUM_OCTAVES; band++){
+        result->ildErr_dB[band] /= (double)QUALITY_NUM_SCENES;
+        result->ipdErr_rad[band] /= (double)QUALITY_NUM_SCENES;
+        result->icErr[band] /= (double)QUALITY_NUM_SCENES;
+        result->meanIldErr_dB += result->ildErr_dB[band]/(double)TOOLS_NUM_OCTAVES;
+        result->meanIcErr += result->icErr[band]/(double)TOOLS_NUM_OCTAVES;
+        fc = tools_octaveCentreFreq(band);
+        if(fc <= QUALITY_MAX_ITD_FREQ){
+            result->meanItdErr_us += 1e6*result->ipdErr_rad[band]/(2.0*SAF_PI*(double)fc);
+            nItdBands++;
+        }
+    }
+    result->meanItdErr_us /= (double)SAF_MAX(nItdBands, 1);
+    result->doaErr_deg = doaWeightSum > 0.0 ? doaErrSum/doaWeightSum : 0.0;
+}
+
+/* a configuration is on the Pareto front if no other is at least as good in every metric, and better in one */
+static void quality_markPareto(quality_result* results, int nConfigs)
+{
+    int i, j, m, allLE, anyLT;
+    double a[5], b[5];
+
+    for(i=0; i<nConfigs; i++){
+        results[i].pareto = results[i].valid;
+        if(!results[i].valid)
+            continue;
+        a[0] = results[i].ns_per_frame;  a[1] = results[i].meanIldErr_dB;  a[2] = results[i].meanItdErr_us;
+        a[3] = results[i].meanIcErr;     a[4] = results[i].doaErr_deg;
+        for(j=0; j<nConfigs && results[i].pareto; j++){
+            if(j == i || !results[j].valid)
+                continue;
+            b[0] = results[j].ns_per_frame;  b[1] = results[j].meanIldErr_dB;  b[2] = results[j].meanItdErr_us;
+            b[3] = results[j].meanIcErr;     b[4] = results[j].doaErr_deg;
+            allLE = 1;
+            anyLT = 0;
+            for(m=0; m<5; m++){
+                allLE &= b[m] <= a[m];
+                anyLT |= b[m] < a[m];
+            }
+            if(allLE && anyLT)
+                results[i].pareto = 0;
+        }
+    }
+}
+
+static void quality_writeJSON(FILE* out, const quality_options* opts, const quality_config* configs, const quality_result* results, int nConfigs)
+{
+    int c, band;
+
+    fprintf(out, "{\n  \"tool\": \"hcropaclib_quality\",\n  \"sampleRate\": %d,\n  \"frames\": %d,\n  \"warmupFrames\": %d,\n  \"octaveCentres_hz\": [",
+            opts->fs, opts->nFrames, opts->nWarmupFrames);
+    for(band=0; band<TOOLS_NUM_OCTAVES; band++)
+        fprintf(out, "%s%.1f", band ? ", " : "", tools_octaveCentreFreq(band));
+    fprintf(out, "],\n  \"results\": [\n");
+    for(c=0; c<nConfigs; c++){
+        fprintf(out, "    {\"config\": \"%s\", \"anaLimit_hz\": %.0f, \"covAvg\": %.2f, \"gridDensity\": %d, \"hrirPreProc\": %d, "
+                "\"transform\": %d, \"decoder\": %d, \"cropac\": %d, \"bandSkipping\": %d, \"silenceGate\": %d, \"valid\": %d",
+                configs[c].name, configs[c].anaLimit_hz, configs[c].covAvg, configs[c].gridDensity, (int)configs[c].preProc,
+                (int)configs[c].transform, (int)configs[c].decoder, configs[c].cropac, configs[c].bandSkipping, configs[c].silenceGate,
+                results[c].valid);
+        if(results[c].valid){
+            fprintf(out, ",\n     \"ns_per_frame\": %.1f, \"rtf\": %.6f, \"ild_err_db\": %.4f, \"itd_err_us\": %.2f, \"ic_err\": %.5f, "
+                    "\"doa_err_deg\": %.3f, \"pareto\": %d,\n     \"band_ild_err_db\": [", results[c].ns_per_frame, results[c].rtf,
+                    results[c].meanIldErr_dB, results[c].meanItdErr_us, results[c].meanIcErr, results[c].doaErr_deg, results[c].pareto);
+            for(band=0; band<TOOLS_NUM_OCTAVES; band++)
+                fprintf(out, "%s%.4f", band ? ", " : "", results[c].ildErr_dB[band]);
+            fprintf(out, "],\n     \"band_ipd_err_rad\": [");
+            for(band=0; band<TOOLS_NUM_OCTAVES; band++)
+                fprintf(out, "%s%.4f", band ? ", " : "", results[c].ipdErr_rad[band]);
+            fprintf(out, "],\n     \"band_ic_err\": [");
+            for(band=0; band<TOOLS_NUM_OCTAVES; band++)
+                fprintf(out, "%s%.5f", band ? ", " : "", results[c].icErr[band]);
+            fprintf(out, "]");
+        }
+        fprintf(out, "}%s\n", c < nConfigs-1 ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+int main(int argc, char** argv)
+{
+    quality_options opts;
+    quality_config* configs;
+    quality_result* results;
+    FILE* out;
+    void *hCroPaC, *hFFT;
+    float **foa, **frameOut, ***refOut, **testOut;
+    int c, s, nConfigs, frameSize, len, status;
+    double doaErrSum, doaWeightSum, time_ns;
+
+    if(!quality_parseOptions(argc, argv, &opts)){
+        quality_usage(argv[0]);
+        return 2;
+    }
+
+    /* set-up */
+    configs = malloc1d(QUALITY_MAX_CONFIGS*sizeof(quality_config));
+    results = calloc1d(QUALITY_MAX_CONFIGS, sizeof(quality_result));
+    nConfigs = quality_buildConfigs(opts.factorial, configs);
+    hcropaclib_create(&hCroPaC);
+    hcropaclib_setFrameSize(hCroPaC, opts.frameSize);
+    if(opts.sofaPath != NULL)
+        hcropaclib_setSofaFilePath(hCroPaC, opts.sofaPath);
+    hcropaclib_init(hCroPaC, opts.fs);
+    if(!quality_apply(hCroPaC, &configs[0])){
+        fprintf(stderr, "Unable to initialise the codec\n");
+        hcropaclib_destroy(&hCroPaC);
+        free(configs);
+        free(results);
+        return 2;
+    }
+    frameSize = hcropaclib_getFrameSize(hCroPaC);
+    len = opts.nFrames*frameSize;
+    foa = (float**)malloc2d(BENCH_NUM_FOA_CHANNELS, frameSize, sizeof(float));
+    frameOut = (float**)malloc2d(TOOLS_NUM_EARS, frameSize, sizeof(float));
+    refOut = (float***)malloc3d(QUALITY_NUM_SCENES, TOOLS_NUM_EARS, len, sizeof(float));
+    testOut = (float**)malloc2d(TOOLS_NUM_EARS, len, sizeof(float));
+    saf_rfft_create(&hFFT, TOOLS_FFT_SIZE);
+
+    /* evaluate; the reference (configs[0]) is rendered first, and kept */
+    printf("%-28s %12s %9s %9s %9s %9s %9s %s\n", "configuration", "ns/frame", "rtf", "ild_dB", "itd_us", "ic", "doa_deg", "pareto");
+    status = 0;
+    for(c=0; c<nConfigs; c++){
+        if(c > 0 && !quality_apply(hCroPaC, &configs[c])){
+            fprintf(stderr, "Unable to initialise the codec for %s\n", configs[c].name);
+            status = 1;
+            continue;
+        }
+        doaErrSum = doaWeightSum = time_ns = 0.0;
+        for(s=0; s<QUALITY_NUM_SCENES; s++){
+            quality_render(hCroPaC, quality_scenes[s], &opts, foa, frameOut, c == 0 ? refOut[s] : testOut,
+                           &doaErrSum, &doaWeightSum, &time_ns);
+            quality_compare(hFFT, refOut[s], c == 0 ? refOut[s] : testOut, len, opts.fs, &results[c]);
+        }
+        results[c].valid = 1;
+        results[c].ns_per_frame = time_ns/(double)(QUALITY_NUM_SCENES*opts.nFrames);
+        results[c].rtf = time_ns/(1e9*(double)(QUALITY_NUM_SCENES*len)/(double)opts.fs);
+        quality_summarise(&results[c], doaErrSum, doaWeightSum);
+    }
+    quality_markPareto(results, nConfigs);
+    for(c=0; c<nConfigs; c++){
+        if(results[c].valid)
+            printf("%-28s %12.0f %9.4f %9.3f %9.1f %9.4f %9.2f %s\n", configs[c].name, results[c].ns_per_frame, results[c].rtf,
+                   results[c].meanIldErr_dB, results[c].meanItdErr_us, results[c].meanIcErr, results[c].doaErr_deg,
+                   results[c].pareto ? "*" : "");
+    }
+
+    /* per-band results */
+    if(opts.outPath != NULL){
+        out = fopen(opts.outPath, "w");
+        if(out != NULL){
+            quality_writeJSON(out, &opts, configs, results, nConfigs);
+            fclose(out);
+        }
+        else{
+            fprintf(stderr, "Unable to open '%s'\n", opts.outPath);
+            status = 1;
+        }
+    }
+
+    /* clean-up */
+    saf_rfft_destroy(&hFFT);
+    hcropaclib_destroy(&hCroPaC);
+    free(foa);
+    free(frameOut);
+    free(refOut);
+    free(testOut);
+    free(configs);
+    free(results);
+    return status;
+}
@@ -0,0 +1,372 @@
+/*
+ ==============================================================================
+
+ This file is part of the CroPaC-Binaural
+ Copyright (c) 2018 - Leo McCormack.
+
+ CroPaC-Binaural is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ CroPaC-Binaural is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with CroPaC-Binaural.  If not, see <http://www.gnu.org/licenses/>.
+
+ ==============================================================================
+*/
+
+/**
+ * @file hcropaclib_rtcheck.c
+ * @brief Real-time safety checker for hcropaclib_process()
+ *
+ * The memory allocation, sleeping and locking functions are interposed at link
+ * time (GNU ld '--wrap'; see CMakeLists.txt), for all code statically linked
+ * into this executable (i.e. hcropaclib and SAF). Any such call made by the
+ * audio thread while it is inside hcropaclib_process() (or the other functions
+ * that must be called from the processing thread) is counted as a violation.
+ * Calls made by shared libraries (e.g. a shared BLAS/LAPACK) are not seen; an
+ * LD_PRELOAD interposer would be required for those. Meanwhile, a control thread keeps calling the setters/getters in
+ * random order, and an initialisation thread re-initialises the codec whenever
+ * required, as a host would. Returns non-zero if any violation occurred, e.g.:
+ *
+ *   hcropaclib_rtcheck --frames 20000 --sofa path/to/hrirs.sofa
+ *
+ * @author Leo McCormack
+ * @date 12.01.2018
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "hcropaclib.h"
+#include "bench_common.h"
+
+#define RTCHECK_DEFAULT_FRAMES ( 20000 )
+#define RTCHECK_DEFAULT_SAMPLERATE ( 48000 )
+#define RTCHECK_SEED ( 12345 )
+#define RTCHECK_NUM_SETTERS ( 32 )
+
+/* ========================================================================== */
+/*                                Interposition                               */
+/* ========================================================================== */
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t nmemb, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+int __real_posix_memalign(void** memptr, size_t alignment, size_t size);
+int __real_usleep(useconds_t usec);
+int __real_nanosleep(const struct timespec* req, struct timespec* rem);
+unsigned int __real_sleep(unsigned int seconds);
+int __real_pthread_mutex_lock(pthread_mutex_t* mutex);
+int __real_pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex);
+
+static _Thread_local int rtcheck_inProcess = 0;       /* 1: the calling thread is inside hcropaclib_process() */
+static atomic_int rtcheck_nViolations = 0;
+static _Atomic(const char*) rtcheck_firstViolation = NULL;
+static atomic_int rtcheck_firstViolationFrame = -1;
+static atomic_int rtcheck_frame = 0;
+
+/* must not allocate, print or block itself */
+static void rtcheck_violation(const char* function)
+{
+    const char* expected = NULL;
+
+    if(atomic_fetch_add(&rtcheck_nViolations, 1) == 0){
+        atomic_compare_exchange_strong(&rtcheck_firstViolation, &expected, function);
+        atomic_store(&rtcheck_firstViolationFrame, atomic_load(&rtcheck_frame));
+    }
+}
+
+void* __wrap_malloc(size_t size)
+{
+    if(rtcheck_inProcess)
+        rtcheck_violation("malloc");
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t nmemb, size_t size)
+{
+    if(rtcheck_inProcess)
+        rtcheck_violation("calloc");
+    return __real_calloc(nmemb, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size)
+{
+    if(rtcheck_inProcess)
+        rtcheck_violation("realloc");
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void* ptr)
+{
+    if(rtcheck_inProcess && ptr != NULL)
+        rtcheck_violation("free");
+    __real_free(ptr);
+}
+
+int __wrap_posix_memalign(void** memptr, size_t alignment, size_t size)
+{
+    if(rtcheck_inProcess)
+        rtcheck_violation("posix_memalign");
+    return __real_posix_memalign(memptr, alignment, size);
+}
+
+int __wrap_usleep(useconds_t usec)
+{
+    if(rtcheck_inProcess)
+        rtcheck_violation("usleep");
+    return __real_usleep(usec);
+}
+
+int __wrap_nanosleep(const struct timespec* req, struct timespec* rem)
+{
+    if(rtcheck_inProcess)
+        rtcheck_violation("nanosleep");
+    return __real_nanosleep(req, rem);
+}
+
+unsigned int __wrap_sleep(unsigned int seconds)
+{
+    if(rtcheck_inProcess)
+        rtcheck_violation("sleep");
+    return __real_sleep(seconds);
+}
+
+int __wrap_pthread_mutex_lock(pthread_mutex_t* mutex)
+{
+    if(rtcheck_inProcess)
+        rtcheck_violation("pthread_mutex_lock");
+    return __real_pthread_mutex_lock(mutex);
+}
+
+int __wrap_pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex)
+{
+    if(rtcheck_inProcess)
+        rtcheck_violation("pthread_cond_wait");
+    return __real_pthread_cond_wait(cond, mutex);
+}
+
+
+/* ========================================================================== */
+/*                                Stress threads                              */
+/* ========================================================================== */
+
+typedef struct _rtcheck_ctx {
+    void* hCroPaC;
+    const char* sofaPath;
+    unsigned int seed;
+    atomic_int stop;
+    atomic_int nSetterCalls;
+    atomic_int nInits;
+    atomic_int metadataRequest;        /* 1: the audio thread is to encode the metadata, 2: and to render the next frame from it */
+} rtcheck_ctx;
+
+/* xorshift32 */
+static unsigned int rtcheck_rand(unsigned int* state)
+{
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static float rtcheck_randf(unsigned int* state, float minValue, float maxValue)
+{
+    return minValue + (maxValue-minValue) * (float)(rtcheck_rand(state) % 10001)/10000.0f;
+}
+
+/* Re-initialises the codec (or rebuilds the FIR decoder) whenever a setter has requested it, as a host's background thread would */
+static void* rtcheck_initThread(void* arg)
+{
+    rtcheck_ctx* ctx = (rtcheck_ctx*)arg;
+
+    while(!atomic_load(&ctx->stop)){
+        if(hcropaclib_getCodecStatus(ctx->hCroPaC) == CODEC_STATUS_NOT_INITIALISED || hcropaclib_getFIRDecoderRebuildPending(ctx->hCroPaC)){
+            hcropaclib_initCodec(ctx->hCroPaC);
+            atomic_fetch_add(&ctx->nInits, 1);
+        }
+        else
+            usleep(1000);
+    }
+    return NULL;
+}
+
+/* Calls the setters (and a few getters) in random order */
+static void* rtcheck_controlThread(void* arg)
+{
+    rtcheck_ctx* ctx = (rtcheck_ctx*)arg;
+    void* hCroPaC = ctx->hCroPaC;
+    unsigned int seed = ctx->seed;
+    hcropaclib_profile profile;
+    hcropaclib_latency latency;
+    int setter, nBands;
+
+    while(!atomic_load(&ctx->stop)){
+        setter = (int)(rtcheck_rand(&seed) % RTCHECK_NUM_SETTERS);
+        nBands = hcropaclib_getNumberOfBands(hCroPaC);
+        switch(setter){
+            /* no re-initialisation required */
+            case 0:  hcropaclib_setYaw(hCroPaC, rtcheck_randf(&seed, -180.0f, 180.0f)); break;
+            case 1:  hcropaclib_setPitch(hCroPaC, rtcheck_randf(&seed, -90.0f, 90.0f)); break;
+            case 2:  hcropaclib_setRoll(hCroPaC, rtcheck_randf(&seed, -90.0f, 90.0f)); break;
+            case 3:  hcropaclib_setEnableRotation(hCroPaC, (int)(rtcheck_rand(&seed) % 2)); break;
+            case 4:  hcropaclib_setFlipYaw(hCroPaC, (int)(rtcheck_rand(&seed) % 2)); break;
+            case 5:  hcropaclib_setRPYflag(hCroPaC, (int)(rtcheck_rand(&seed) % 2)); break;
+            case 6:  hcropaclib_setEnableCroPaC(hCroPaC, (int)(rtcheck_rand(&seed) % 2)); break;
+            case 7:  hcropaclib_setBalanceAllBands(hCroPaC, rtcheck_randf(&seed, 0.0f, 2.0f)); break;
+            case 8:  hcropaclib_setBalance(hCroPaC, rtcheck_randf(&seed, 0.0f, 2.0f), (int)(rtcheck_rand(&seed) % (unsigned int)nBands)); break;
+            case 9:  hcropaclib_setEQAllBands(hCroPaC, rtcheck_randf(&seed, 0.0f, 2.0f)); break;
+            case 10: hcropaclib_setEQ(hCroPaC, rtcheck_randf(&seed, 0.0f, 2.0f), (int)(rtcheck_rand(&seed) % (unsigned int)nBands)); break;
+            case 11: hcropaclib_setCovAvg(hCroPaC, rtcheck_randf(&seed, 0.0f, 0.99f)); break;
+            case 12: hcropaclib_setAnaLimit(hCroPaC, rtcheck_randf(&seed, HCROPAC_ANA_LIMIT_MIN_VALUE, HCROPAC_ANA_LIMIT_MAX_VALUE)); break;
+            case 13: hcropaclib_setChOrder(hCroPaC, (int)(rtcheck_rand(&seed) % 2) ? CH_FUMA : CH_ACN); break;
+            case 14: hcropaclib_setNormType(hCroPaC, NORM_N3D + (int)(rtcheck_rand(&seed) % HCROPAC_NUM_NORM_TYPES)); break;
+            case 15: hcropaclib_setEnableSilenceGate(hCroPaC, (int)(rtcheck_rand(&seed) % 2)); break;
+            case 16: hcropaclib_setSilenceGateThreshold(hCroPaC, rtcheck_randf(&seed, HCROPAC_GATE_THRESHOLD_MIN_VALUE, HCROPAC_GATE_THRESHOLD_MAX_VALUE)); break;
+            case 17: hcropaclib_setEnableBandSkipping(hCroPaC, (int)(rtcheck_rand(&seed) % 2)); break;
+            case 18: hcropaclib_setBandSkipFloor(hCroPaC, rtcheck_randf(&seed, HCROPAC_BAND_FLOOR_MIN_VALUE, HCROPAC_BAND_FLOOR_MAX_VALUE)); break;
+            case 19: hcropaclib_setEnableAnalysisOnly(hCroPaC, (int)(rtcheck_rand(&seed) % 4) == 0); break;
+            case 20: hcropaclib_setEnableProfiling(hCroPaC, (int)(rtcheck_rand(&seed) % 2)); break;
+            case 21: hcropaclib_setEnableLatencyStats(hCroPaC, (int)(rtcheck_rand(&seed) % 2)); break;
+            case 22: hcropaclib_setEnableTracing(hCroPaC, (int)(rtcheck_rand(&seed) % 2)); break;
+            case 23:
+                hcropaclib_getProfile(hCroPaC, &profile);
+                hcropaclib_getLatencyStats(hCroPaC, &latency);
+                hcropaclib_resetProfile(hCroPaC);
+                hcropaclib_resetLatencyStats(hCroPaC);
+                hcropaclib_resetProcessingCounters(hCroPaC);
+                break;
+            case 24: atomic_store(&ctx->metadataRequest, 1 + (int)(rtcheck_rand(&seed) % 2)); break; /* processing thread only */
+
+            /* re-initialisation required; less often, as each takes a while */
+            default:
+                if(rtcheck_rand(&seed) % 8 != 0)
+                    break;
+                switch(setter){
+                    case 25: hcropaclib_setFrameSize(hCroPaC, rtcheck_rand(&seed) % 2 ? HCROPAC_FRAME_SIZE_DEFAULT : HCROPAC_MIN_FRAME_SIZE); break;
+                    case 26: hcropaclib_setScanningGridDensity(hCroPaC, (int)(rtcheck_rand(&seed) % (HCROPAC_GRID_DENSITY_MAX_VALUE+1))); break;
+                    case 27: hcropaclib_setEnableDiffCorrection(hCroPaC, (int)(rtcheck_rand(&seed) % 2)); break;
+                    case 28: hcropaclib_setLinearDecoderMode(hCroPaC, (int)(rtcheck_rand(&seed) % 2) ? LINEAR_DECODER_FIR : LINEAR_DECODER_STFT); break;
+                    case 29: hcropaclib_setHRIRsPreProc(hCroPaC, (HRIR_PREPROC_OPTIONS)(HRIR_PREPROC_OFF + (int)(rtcheck_rand(&seed) % 4))); break;
+                    case 30: hcropaclib_setTransformBackend(hCroPaC, (int)(rtcheck_rand(&seed) % 2) ? TFT_STFT : TFT_AFSTFT_HYBRID); break;
+                    case 31:
+                        if(ctx->sofaPath != NULL && rtcheck_rand(&seed) % 2)
+                            hcropaclib_setSofaFilePath(hCroPaC, ctx->sofaPath);
+                        else
+                            hcropaclib_setUseDefaultHRIRsflag(hCroPaC, 1);
+                        break;
+                }
+                break;
+        }
+        atomic_fetch_add(&ctx->nSetterCalls, 1);
+        usleep(50 + rtcheck_rand(&seed) % 500);
+    }
+    return NULL;
+}
+
+
+/* ========================================================================== */
+/*                                     Main                                   */
+/* ========================================================================== */
+
+int main(int argc, char** argv)
+{
+    rtcheck_ctx ctx;
+    bench_scene scene;
+    pthread_t initThread, controlThread;
+    float **inputs, **outputs;
+    const char* firstViolation;
+    unsigned char metadata[HCROPAC_METADATA_MAX_BYTES];
+    int i, ch, frame, nFrames, fs, frameSize, nViolations, request, nBytes;
+
+    /* options */
+    nFrames = RTCHECK_DEFAULT_FRAMES;
+    fs = RTCHECK_DEFAULT_SAMPLERATE;
+    memset(&ctx, 0, sizeof(rtcheck_ctx));
+    ctx.seed = RTCHECK_SEED;
+    for(i=1; i<argc; i++){
+        if(i+1 < argc && !strcmp(argv[i], "--frames"))
+            nFrames = atoi(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--fs"))
+            fs = atoi(argv[++i]);
+        else if(i+1 < argc && !strcmp(argv[i], "--sofa"))
+            ctx.sofaPath = argv[++i];
+        else if(i+1 < argc && !strcmp(argv[i], "--seed"))
+            ctx.seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        else{
+            printf("Usage: %s [--frames N] [--fs N] [--sofa PATH] [--seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if(nFrames < 1 || fs < 1 || ctx.seed == 0){
+        fprintf(stderr, "Invalid options\n");
+        return 2;
+    }
+
+    /* set-up */
+    hcropaclib_create(&ctx.hCroPaC);
+    hcropaclib_init(ctx.hCroPaC, fs);
+    hcropaclib_initCodec(ctx.hCroPaC);
+    inputs = malloc(BENCH_NUM_FOA_CHANNELS*sizeof(float*));
+    outputs = malloc(hcropaclib_getNumEars()*sizeof(float*));
+    for(ch=0; ch<BENCH_NUM_FOA_CHANNELS; ch++)
+        inputs[ch] = malloc(HCROPAC_MAX_FRAME_SIZE*sizeof(float));
+    for(ch=0; ch<hcropaclib_getNumEars(); ch++)
+        outputs[ch] = malloc(HCROPAC_MAX_FRAME_SIZE*sizeof(float));
+    bench_scene_init(&scene, BENCH_SCENE_MOVING, fs, RTCHECK_SEED);
+    pthread_create(&initThread, NULL, rtcheck_initThread, &ctx);
+    pthread_create(&controlThread, NULL, rtcheck_controlThread, &ctx);
+
+    /* audio thread; runs as fast as possible, to maximise the overlap with the setters */
+    for(frame=0; frame<nFrames; frame++){
+        frameSize = hcropaclib_getFrameSize(ctx.hCroPaC);
+        bench_scene_render(&scene, inputs, frameSize);
+        atomic_store(&rtcheck_frame, frame);
+        rtcheck_inProcess = 1;
+        hcropaclib_process(ctx.hCroPaC, inputs, outputs, BENCH_NUM_FOA_CHANNELS, hcropaclib_getNumEars(), frameSize);
+        request = atomic_exchange(&ctx.metadataRequest, 0);
+        if(request > 0){
+            nBytes = hcropaclib_encodeMetadata(ctx.hCroPaC, metadata, HCROPAC_METADATA_MAX_BYTES);
+            if(nBytes > 0 && request == 2)
+                hcropaclib_setRenderMetadata(ctx.hCroPaC, metadata, nBytes);
+        }
+        rtcheck_inProcess = 0;
+    }
+
+    /* clean-up */
+    atomic_store(&ctx.stop, 1);
+    pthread_join(controlThread, NULL);
+    pthread_join(initThread, NULL);
+    hcropaclib_destroy(&ctx.hCroPaC);
+    for(ch=0; ch<BENCH_NUM_FOA_CHANNELS; ch++)
+        free(inputs[ch]);
+    for(ch=0; ch<hcropaclib_getNumEars(); ch++)
+        free(outputs[ch]);
+    free(inputs);
+    free(outputs);
+
+    /* report */
+    nViolations = atomic_load(&rtcheck_nViolations);
+    printf("frames: %d, setter calls: %d, codec initialisations: %d\n", nFrames, atomic_load(&ctx.nSetterCalls), atomic_load(&ctx.nInits));
+    if(nViolations > 0){
+        firstViolation = atomic_load(&rtcheck_firstViolation);
+        printf("FAILED: %d real-time safety violation(s); the first was a call to %s() during frame %d\n",
+               nViolations, firstViolation != NULL ? firstViolation : "?", atomic_load(&rtcheck_firstViolationFrame));
+        return 1;
+    }
+    printf("PASSED: no allocation, sleeping or locking inside hcropaclib_process() (or the metadata functions)\n");
+    return 0;
+}
@@ -0,0 +1,155 @@
+/*
+ ==============================================================================
+
+ This file is part of the CroPaC-Binaural
+ Copyright (c) 2018 - Leo McCormack.
+
+ CroPaC-Binaural is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ CroPaC-Binaural is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with CroPaC-Binaural.  If not, see <http://www.gnu.org/licenses/>.
+
+ ==============================================================================
+*/
+
+/**
+ * @file tools_common.c
+ * @brief Utilities shared by the hcropaclib validation tools: octave band
+ *        analysis of binaural signals
+ *
+ * @author Leo McCormack
+ * @date 12.01.2018
+ */
+
+#include <math.h>
+#include <string.h>
+#include "saf.h"
+#include "tools_common.h"
+
+#define TOOLS_LOWEST_OCTAVE_HZ ( 62.5f )
+
+float tools_octaveCentreFreq(int band)
+{
+    return TOOLS_LOWEST_OCTAVE_HZ * powf(2.0f, (float)band);
+}
+
+void tools_bandSpectra_compute
+(
+    void* hFFT,
+    float** sig,
+    int len,
+    int fs,
+    tools_bandSpectra* spectra
+)
+{
+    int ear, n, k, band, start;
+    float centre, freq;
+    float frame[TOOLS_FFT_SIZE];
+    float_complex cross, spec[TOOLS_NUM_EARS][TOOLS_FFT_SIZE/2+1];
+
+    memset(spectra, 0, sizeof(tools_bandSpectra));
+    for(start=0; start+TOOLS_FFT_SIZE<=len; start+=TOOLS_FFT_SIZE/2){
+        for(ear=0; ear<TOOLS_NUM_EARS; ear++){
+            for(n=0; n<TOOLS_FFT_SIZE; n++)
+                frame[n] = sig[ear][start+n] * (0.5f - 0.5f*cosf(2.0f*SAF_PI*(float)n/(float)TOOLS_FFT_SIZE));
+            saf_rfft_forward(hFFT, frame, spec[ear]);
+        }
+        for(k=1; k<TOOLS_FFT_SIZE/2+1; k++){
+            freq = (float)k*(float)fs/(float)TOOLS_FFT_SIZE;
+            for(band=0; band<TOOLS_NUM_OCTAVES; band++){
+                centre = tools_octaveCentreFreq(band);
+                if(freq >= centre/sqrtf(2.0f) && freq < centre*sqrtf(2.0f)){
+                    for(ear=0; ear<TOOLS_NUM_EARS; ear++)
+                        spectra->energy[ear][band] += (double)(crealf(spec[ear][k])*crealf(spec[ear][k]) + cimagf(spec[ear][k])*cimagf(spec[ear][k]));
+                    cross = ccmulf(spec[0][k], conjf(spec[1][k]));
+                    spectra->crossRe[band] += (double)crealf(cross);
+                    spectra->crossIm[band] += (double)cimagf(cross);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+double tools_bandILD_dB
+(
+    const tools_bandSpectra* spectra,
+    int band,
+    double energyFloor
+)
+{
+    return 10.0*log10((spectra->energy[0][band]+energyFloor)/(spectra->energy[1][band]+energyFloor));
+}
+
+double tools_bandIPD
+(
+    const tools_bandSpectra* spectra,
+    int band
+)
+{
+    return atan2(spectra->crossIm[band], spectra->crossRe[band]);
+}
+
+double tools_bandIC
+(
+    const tools_bandSpectra* spectra,
+    int band,
+    double energyFloor
+)
+{
+    return sqrt(spectra->crossRe[band]*spectra->crossRe[band] + spectra->crossIm[band]*spectra->crossIm[band]) /
+           sqrt((spectra->energy[0][band]+energyFloor)*(spectra->energy[1][band]+energyFloor));
+}
+
+void tools_compare
+(
+    void* hFFT,
+    float** ref,
+    float** test,
+    int len,
+    int fs,
+    double energyFloor,
+    tools_comparison* result
+)
+{
+    int ear, n, band;
+    double refEnergy, errEnergy, diff, floor_band;
+    tools_bandSpectra S_ref, S_test;
+
+    memset(result, 0, sizeof(tools_comparison));
+
+    /* sample-by-sample */
+    refEnergy = errEnergy = 0.0;
+    for(ear=0; ear<TOOLS_NUM_EARS; ear++){
+        for(n=0; n<len; n++){
+            diff = (double)test[ear][n] - (double)ref[ear][n];
+            refEnergy += (double)ref[ear][n]*(double)ref[ear][n];
+            errEnergy += diff*diff;
+            result->maxAbsErr = SAF_MAX(result->maxAbsErr, fabs(diff));
+        }
+    }
+    /* a silent reference is compared against the energy floor instead */
+    result->err_dB = 10.0*log10((errEnergy + energyFloor)/SAF_MAX(refEnergy, energyFloor*(double)len));
+
+    /* per octave band */
+    tools_bandSpectra_compute(hFFT, ref, len, fs, &S_ref);
+    tools_bandSpectra_compute(hFFT, test, len, fs, &S_test);
+    floor_band = energyFloor*(double)len;
+    for(band=0; band<TOOLS_NUM_OCTAVES; band++){
+        if(S_ref.energy[0][band] < floor_band && S_ref.energy[1][band] < floor_band &&
+           S_test.energy[0][band] < floor_band && S_test.energy[1][band] < floor_band)
+            continue;
+        for(ear=0; ear<TOOLS_NUM_EARS; ear++)
+            result->levelErr_dB = SAF_MAX(result->levelErr_dB, fabs(10.0*log10((S_test.energy[ear][band]+floor_band)/(S_ref.energy[ear][band]+floor_band))));
+        result->ildErr_dB = SAF_MAX(result->ildErr_dB, fabs(tools_bandILD_dB(&S_test, band, floor_band) - tools_bandILD_dB(&S_ref, band, floor_band)));
+        result->icErr = SAF_MAX(result->icErr, fabs(tools_bandIC(&S_test, band, floor_band) - tools_bandIC(&S_ref, band, floor_band)));
+    }
+}
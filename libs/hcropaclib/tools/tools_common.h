@@ -0,0 +1,144 @@
+/*
+ ==============================================================================
+
+ This file is part of the CroPaC-Binaural
+ Copyright (c) 2018 - Leo McCormack.
+
+ CroPaC-Binaural is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ CroPaC-Binaural is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with CroPaC-Binaural.  If not, see <http://www.gnu.org/licenses/>.
+
+ ==============================================================================
+*/
+
+/**
+ * @file tools_common.h
+ * @brief Utilities shared by the hcropaclib validation tools: octave band
+ *        analysis of binaural signals
+ *
+ * @author Leo McCormack
+ * @date 12.01.2018
+ */
+
+#ifndef __TOOLS_COMMON_H_INCLUDED__
+#define __TOOLS_COMMON_H_INCLUDED__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* ========================================================================== */
+/*                             Presets + Constants                            */
+/* ========================================================================== */
+
+#define TOOLS_NUM_EARS ( 2 )
+#define TOOLS_FFT_SIZE ( 1024 )         /* Hann windowed, 50% overlap */
+#define TOOLS_NUM_OCTAVES ( 9 )         /* octave bands centred at 62.5 Hz ... 16 kHz */
+
+/** Octave band ear energies and interaural cross-spectra of a binaural signal */
+typedef struct _tools_bandSpectra {
+    double energy[TOOLS_NUM_EARS][TOOLS_NUM_OCTAVES]; /**< ear energies */
+    double crossRe[TOOLS_NUM_OCTAVES];                /**< real part of the left-right cross-spectra */
+    double crossIm[TOOLS_NUM_OCTAVES];                /**< imaginary part of the left-right cross-spectra */
+} tools_bandSpectra;
+
+/** Comparison of a binaural signal against a reference */
+typedef struct _tools_comparison {
+    double err_dB;       /**< error-to-reference energy ratio over both ears, dB */
+    double maxAbsErr;    /**< largest absolute sample error */
+    double levelErr_dB;  /**< largest ear level error over the octave bands, dB */
+    double ildErr_dB;    /**< largest ILD error over the octave bands, dB */
+    double icErr;        /**< largest interaural coherence error over the octave bands */
+} tools_comparison;
+
+
+/* ========================================================================== */
+/*                               Main Functions                               */
+/* ========================================================================== */
+
+/**
+ * Returns the centre frequency of an octave band, Hz
+ */
+float tools_octaveCentreFreq(int band);
+
+/**
+ * Accumulates the octave band ear energies and interaural cross-spectra of a
+ * binaural signal
+ *
+ * @param[in]  hFFT    saf_rfft handle, of length TOOLS_FFT_SIZE
+ * @param[in]  sig     Binaural signal; TOOLS_NUM_EARS x len
+ * @param[in]  len     Signal length, samples
+ * @param[in]  fs      Sampling rate, Hz
+ * @param[out] spectra Band spectra
+ */
+void tools_bandSpectra_compute(void* hFFT,
+                               float** sig,
+                               int len,
+                               int fs,
+                               tools_bandSpectra* spectra);
+
+/**
+ * Returns the interaural level difference (left/right) of a band, dB
+ *
+ * @param[in] spectra     Band spectra
+ * @param[in] band        Octave band index
+ * @param[in] energyFloor Energy added to both ears, to avoid dividing by zero
+ */
+double tools_bandILD_dB(const tools_bandSpectra* spectra,
+                        int band,
+                        double energyFloor);
+
+/**
+ * Returns the interaural phase difference (left relative to right) of a band,
+ * radians
+ */
+double tools_bandIPD(const tools_bandSpectra* spectra,
+                     int band);
+
+/**
+ * Returns the interaural coherence (0..1) of a band
+ *
+ * @param[in] spectra     Band spectra
+ * @param[in] band        Octave band index
+ * @param[in] energyFloor Energy added to both ears, to avoid dividing by zero
+ */
+double tools_bandIC(const tools_bandSpectra* spectra,
+                    int band,
+                    double energyFloor);
+
+/**
+ * Compares a binaural signal against a reference, both sample-by-sample and per
+ * octave band (ear levels, ILDs and interaural coherence)
+ *
+ * @param[in]  hFFT        saf_rfft handle, of length TOOLS_FFT_SIZE
+ * @param[in]  ref         Reference signal; TOOLS_NUM_EARS x len
+ * @param[in]  test        Signal under test; TOOLS_NUM_EARS x len
+ * @param[in]  len         Signal length, samples
+ * @param[in]  fs          Sampling rate, Hz
+ * @param[in]  energyFloor Per sample energy; bands/signals quieter than this
+ *                         are not compared
+ * @param[out] result      Comparison
+ */
+void tools_compare(void* hFFT,
+                   float** ref,
+                   float** test,
+                   int len,
+                   int fs,
+                   double energyFloor,
+                   tools_comparison* result);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif /* __cplusplus */
+
+#endif /* __TOOLS_COMMON_H_INCLUDED__ */